@@ -0,0 +1,124 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Classify dimin.test one instance at a time, and in batches, both with
+// Classify() and classify_to_JSON(). The neighbors of a batch are
+// searched together, but the answers must be the same as for a single
+// instance.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+using namespace nlohmann;
+
+static json used_neighbors( json result ){
+  // after a Tie the BestArray keeps an extra, empty, record, which is shown
+  // as a trailing null in the neighbors. So their number depends on the
+  // instances that were classified before. Leave them out
+  if ( result.contains( "neighbors" ) && result["neighbors"].is_array() ){
+    json& neighbors = result["neighbors"];
+    while ( !neighbors.empty() && neighbors.back().is_null() ){
+      neighbors.erase( neighbors.size()-1 );
+    }
+  }
+  return result;
+}
+
+static int compare( const vector<string>& lines,
+		    const string& options,
+		    size_t batch_size ){
+  TimblAPI api( options, "batch_test" );
+  if ( !api.isValid()
+       || !api.Learn( demo_file( "dimin.train" ) ) ){
+    cerr << options << ": learning failed" << endl;
+    return 1;
+  }
+  TimblExperiment *exp = api.grabAndDisconnectExp();
+  vector<string> single;
+  json single_json = json::array();
+  for ( const auto& line : lines ){
+    string cls;
+    string dist;
+    double distance;
+    if ( !exp->Classify( line, cls, dist, distance ) ){
+      cls.clear();
+    }
+    single.push_back( cls );
+    single_json.push_back( used_neighbors( exp->classify_to_JSON( line ) ) );
+  }
+  int diffs = 0;
+  for ( size_t start=0; start < lines.size(); start += batch_size ){
+    size_t end = min( lines.size(), start + batch_size );
+    vector<string> batch( lines.begin() + start, lines.begin() + end );
+    vector<string> answers;
+    exp->Classify( batch, answers );
+    json batch_json = exp->classify_to_JSON( batch );
+    for ( size_t i=0; i < batch.size(); ++i ){
+      if ( answers[i] != single[start+i]
+	   || used_neighbors( batch_json[i] ) != single_json[start+i] ){
+	if ( diffs == 0 ){
+	  cerr << options << " batches of " << batch_size << ": "
+	       << batch[i] << endl
+	       << "  single: " << single[start+i] << " "
+	       << single_json[start+i] << endl
+	       << "  batch:  " << answers[i] << " "
+	       << batch_json[i] << endl;
+	}
+	++diffs;
+      }
+    }
+  }
+  delete exp;
+  return diffs;
+}
+
+int main(){
+  vector<string> lines;
+  string line;
+  ifstream is( demo_file( "dimin.test" ) );
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  if ( lines.empty() ){
+    return EXIT_FAILURE;
+  }
+  int diffs = compare( lines, "-a IB1 -k3 -mM -G0 +vdb+di+n+cf", 16 )
+    + compare( lines, "-a IB1 -k1 -dIL +vdb+di", 100 )
+    + compare( lines, "-a IB1 -k5 -mO +vdb+di+n", lines.size() );
+  if ( diffs > 0 ){
+    cerr << diffs << " batch answers differ from the single ones" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Test dimin.test with the value difference metrics, with and without
+// --bestfirst. Visiting the nearest values first may only change the
+// speed of the search, not the output. Not even the order of the
+// neighbors at equal distances (+vn), or which of them are kept when
+// there are more than MaxBests (-M). And it must find the neighbors with
+// fewer visits.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "compare_runs.h"
+
+using namespace std;
+
+int main(){
+  int diffs = compare_option( "-a IB1 -k3 -mM +vdb+di", "--bestfirst" )
+    + compare_option( "-a IB1 -k1 -mJ +vdb+di", "--bestfirst" )
+    + compare_option( "-a IB1 -k5 -mS -dID +vdb+di", "--bestfirst" )
+    + compare_option( "-a IB1 -k3 -mM -L2 +vdb+di", "--bestfirst" )
+    + compare_option( "-a IB1 -k3 -mM +vdb+di", "--bestfirst --freeze" )
+    + compare_option( "-a IB1 -k3 -mM +vn+di+db", "--bestfirst" )
+    + compare_option( "-a IB1 -k5 -mJ -L10 -M10 +vn+di", "--bestfirst" )
+    + compare_option( "-a IB1 -k5 -mJ -L10 -M10 +vn", "--bestfirst --freeze" )
+    + compare_option( "-a TRIBL -q2 -k3 -mM +vn+di", "--bestfirst" );
+  vector<string> output;
+  string plain_log;
+  string best_log;
+  const string options = "-a IB1 -k3 -mM +vdb+di";
+  string train = demo_file( "dimin.train" );
+  string test = demo_file( "dimin.test" );
+  if ( !run_logged( options, train, test, output, plain_log )
+       || !run_logged( options + " --bestfirst", train, test, output, best_log ) ){
+    return EXIT_FAILURE;
+  }
+  const string visited = "Nodes visited: ";
+  long long int plain = number_after( plain_log, visited );
+  long long int best = number_after( best_log, visited );
+  if ( plain <= 0 || best <= 0 || best >= plain ){
+    cerr << options << ": --bestfirst visited " << best
+	 << " nodes, without it " << plain << endl;
+    ++diffs;
+  }
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ with --bestfirst" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
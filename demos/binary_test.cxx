@@ -0,0 +1,186 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Learn dimin.train and save the InstanceBase, both in the text and in
+// the binary (--binary) format. Experiments that read them back (with
+// the same weights and arrays) must give the same output on dimin.test.
+// Not the output of the experiment that learned it: the weights file
+// is less precise.
+// A truncated binary file, or one with another revision of the format,
+// must be refused with an error, not crash.
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static bool read_and_test( const string& options,
+			   const string& tree,
+			   const string& weights,
+			   const string& arrays,
+			   vector<string>& output ){
+  TimblAPI exp( options, "binary_test" );
+  if ( !exp.isValid()
+       || !exp.GetInstanceBase( tree )
+       || !exp.GetWeights( weights )
+       || !exp.GetArrays( arrays ) ){
+    cerr << options << ": reading " << tree << " failed" << endl;
+    return false;
+  }
+  return test_output( exp, demo_file( "dimin.test" ), output );
+}
+
+static bool learn_and_save( const string& options,
+			    const string& tree,
+			    const string& weights,
+			    const string& arrays ){
+  TimblAPI exp( options, "binary_test" );
+  return exp.isValid()
+    && exp.Learn( demo_file( "dimin.train" ) )
+    && exp.WriteInstanceBase( tree )
+    && exp.SaveWeights( weights )
+    && exp.WriteArrays( arrays );
+}
+
+static bool refused( const string& options,
+		     const string& file,
+		     const string& contents,
+		     const string& error ){
+  // an InstanceBase file with these contents must give the error
+  {
+    ofstream os( file, ios::binary );
+    os << contents;
+  }
+  bool ok;
+  string log;
+  {
+    capture_log capture;
+    TimblAPI exp( options, "binary_test" );
+    ok = exp.isValid() && exp.GetInstanceBase( file );
+    log = capture.str();
+  }
+  remove( file.c_str() );
+  if ( ok || log.find( error ) == string::npos ){
+    cerr << options << ": a " << contents.size() << " byte file was "
+	 << ( ok ? "accepted" : "refused with another error" ) << endl;
+    return false;
+  }
+  return true;
+}
+
+static int bad_files( const string& options, const string& binary_tree ){
+  ifstream is( binary_tree, ios::binary );
+  const string good( (istreambuf_iterator<char>( is )),
+		     istreambuf_iterator<char>() );
+  const string::size_type block = good.find( "TiMBLbin" );
+  if ( block == string::npos ){
+    cerr << binary_tree << " has no binary block" << endl;
+    return 1;
+  }
+  const string bad_file = binary_tree + ".bad";
+  int wrong = 0;
+  // cut off at the start of the block, in its header, and in every
+  // eighth of the rest
+  vector<size_t> cuts = { block, block + 12 };
+  for ( size_t i=1; i < 8; ++i ){
+    cuts.push_back( block + ( good.size() - block ) * i / 8 );
+  }
+  cuts.push_back( good.size() - 1 );
+  for ( const auto cut : cuts ){
+    if ( !refused( options, bad_file, good.substr( 0, cut ),
+		   "binary Instance Base file is truncated" ) ){
+      ++wrong;
+    }
+  }
+  // the revision follows the magic string
+  string other = good;
+  uint32_t revision;
+  memcpy( &revision, &other[block+8], sizeof(revision) );
+  ++revision;
+  memcpy( &other[block+8], &revision, sizeof(revision) );
+  if ( !refused( options, bad_file, other,
+		 "unsupported revision of the binary Instance Base format" ) ){
+    ++wrong;
+  }
+  other = good;
+  other[block] = 't';
+  if ( !refused( options, bad_file, other,
+		 "missing binary header in Instance Base file" ) ){
+    ++wrong;
+  }
+  return wrong;
+}
+
+static int compare_formats( const string& options ){
+  // --binary is only used when the experiment is created
+  string base = "binary_test." + to_string( getpid() );
+  string text_tree = base + ".tree";
+  string binary_tree = base + ".bin";
+  string weights = base + ".wgt";
+  string arrays = base + ".arr";
+  vector<string> text;
+  vector<string> binary;
+  bool ok = learn_and_save( options, text_tree, weights, arrays )
+    && learn_and_save( options + " --binary", binary_tree, weights, arrays )
+    && read_and_test( options, text_tree, weights, arrays, text )
+    && read_and_test( options, binary_tree, weights, arrays, binary );
+  int wrong = ok ? bad_files( options, binary_tree ) : 0;
+  // IGTREE saves the weights next to the tree too
+  for ( const auto& file : { text_tree, text_tree + ".wgt",
+			     binary_tree, binary_tree + ".wgt",
+			     weights, arrays } ){
+    remove( file.c_str() );
+  }
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+    return 1;
+  }
+  return wrong + count_diffs( text, binary, options + " --binary" );
+}
+
+int main(){
+  int diffs = compare_formats( "-a IB1 -k3 -mM +vdb+di" )
+    + compare_formats( "-a IB1 -k1 -mO +vdb+di" )
+    + compare_formats( "-a IGTREE +D +vdb" )
+    + compare_formats( "-a TRIBL -q2 -k3 +vdb+di" );
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ after reading the InstanceBase"
+	 << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
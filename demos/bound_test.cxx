@@ -0,0 +1,120 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Replace one feature of dimin.test by a value that never occurs in
+// training. It adds the same distance to every neighbor, so the search may
+// prune with it, but the neighbors must be those of the same run that
+// ignores the feature, which prunes nothing. The distances differ, so we
+// compare the answers without them.
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "compare_runs.h"
+
+using namespace std;
+
+static const size_t num_features = 12;
+
+static bool write_unseen( const string& name, size_t feature ){
+  // write dimin.test with value "#" for the feature (counted from 1)
+  ifstream is( demo_file( "dimin.test" ) );
+  ofstream os( name );
+  string line;
+  size_t lines = 0;
+  while ( getline( is, line ) ){
+    size_t pos = 0;
+    for ( size_t f=1; f < feature; ++f ){
+      pos = line.find( ',', pos ) + 1;
+    }
+    line.replace( pos, line.find( ',', pos ) - pos, "#" );
+    os << line << endl;
+    ++lines;
+  }
+  return lines > 0;
+}
+
+static vector<string> answers( const vector<string>& output ){
+  // strip the features and the given class from every output line
+  vector<string> result;
+  for ( const auto& line : output ){
+    size_t pos = 0;
+    for ( size_t f=0; f <= num_features && pos != string::npos; ++f ){
+      pos = line.find( ',', pos );
+      if ( pos != string::npos ){
+	++pos;
+      }
+    }
+    result.push_back( pos == string::npos ? line : line.substr( pos ) );
+  }
+  return result;
+}
+
+static int compare_bound( const string& options,
+			  const string& extra,
+			  size_t feature ){
+  // options + extra with an unseen feature, against options that ignore it
+  const string train = demo_file( "dimin.train" );
+  const string unseen = "bound_test." + to_string( getpid() );
+  const string metric = options.substr( options.find( "-m" ) + 2, 1 );
+  const string ignore = options + " -m" + metric + ":I" + to_string( feature );
+  const string what = options + extra + ", unseen feature "
+    + to_string( feature );
+  vector<string> expected;
+  vector<string> got;
+  bool ok = write_unseen( unseen, feature )
+    && run_experiment( ignore, train, demo_file( "dimin.test" ), expected )
+    && run_experiment( options + extra, train, unseen, got );
+  remove( unseen.c_str() );
+  if ( !ok ){
+    cerr << what << ": failed" << endl;
+    return 1;
+  }
+  return count_diffs( answers( expected ), answers( got ), what );
+}
+
+int main(){
+  int diffs = 0;
+  for ( size_t f=1; f <= num_features; ++f ){
+    diffs += compare_bound( "-a IB1 -k3 -mM +vdb", "", f );
+  }
+  for ( size_t f=1; f <= num_features; f += 3 ){
+    diffs += compare_bound( "-a IB1 -k3 -mJ +vdb", "", f )
+      + compare_bound( "-a IB1 -k1 -mO +vdb", "", f )
+      + compare_bound( "-a IB1 -k3 -mO +vdb", " --freeze", f )
+      + compare_bound( "-a IB1 -k3 -mM +vdb", " --freeze", f );
+  }
+  if ( diffs > 0 ){
+    cerr << diffs << " answers change with an unseen feature" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
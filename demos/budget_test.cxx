@@ -0,0 +1,104 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Test dimin.test with a --budget. A budget that is never used up must
+// give the output of the exact search, without '# approximate' marks.
+// A small budget must mark the neighbor sets it cut off, and visit far
+// fewer nodes of the InstanceBase. Every test instance still gets an answer.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "compare_runs.h"
+
+using namespace std;
+
+static const string approx_mark = "# approximate";
+
+static size_t count_marks( const vector<string>& output ){
+  size_t marks = 0;
+  for ( const auto& line : output ){
+    if ( line == approx_mark ){
+      ++marks;
+    }
+  }
+  return marks;
+}
+
+static size_t count_answers( const vector<string>& output ){
+  size_t answers = 0;
+  for ( const auto& line : output ){
+    if ( line.compare( 0, 1, "#" ) != 0 ){
+      ++answers;
+    }
+  }
+  return answers;
+}
+
+int main(){
+  string train = demo_file( "dimin.train" );
+  string test = demo_file( "dimin.test" );
+  int diffs = compare_option( "-a IB1 -k3 -mM +vdb+di", "--budget=100000000" )
+    + compare_option( "-a IB1 -k1 -mO +vdb+di+n", "--budget=100000000" );
+  vector<string> exact;
+  vector<string> approx;
+  string exact_log;
+  string approx_log;
+  const string options = "-a IB1 -k3 -mO +vdb+di+n";
+  if ( !run_logged( options, train, test, exact, exact_log )
+       || !run_logged( options + " --budget=20", train, test,
+		       approx, approx_log ) ){
+    return EXIT_FAILURE;
+  }
+  const string visited = "Nodes visited: ";
+  long long int all = number_after( exact_log, visited );
+  long long int cut = number_after( approx_log, visited );
+  if ( all <= 0 || cut <= 0 || cut * 4 > all ){
+    cerr << "--budget=20 visited " << cut << " nodes, without it "
+	 << all << endl;
+    ++diffs;
+  }
+  if ( count_marks( exact ) != 0 ){
+    cerr << "the exact search is marked " << approx_mark << endl;
+    ++diffs;
+  }
+  if ( count_marks( approx ) == 0 ){
+    cerr << "--budget=20 gave no " << approx_mark << " marks" << endl;
+    ++diffs;
+  }
+  if ( count_answers( approx ) != count_answers( exact ) ){
+    cerr << "--budget=20 gave " << count_answers( approx )
+	 << " answers instead of " << count_answers( exact ) << endl;
+    ++diffs;
+  }
+  if ( diffs > 0 ){
+    cerr << diffs << " differences with --budget" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Test a file with every instance of dimin.test twice, with and without
+// a --cache. The cached answers must be the same, and the second time
+// the instances must be found in the cache. The cache must be emptied
+// when the settings or the InstanceBase change, so a Test after a change
+// doesn't find the results of the one before.
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static bool fresh_cache( const string& log, size_t expected_reports ){
+  // every "Result cache" line in the log must show that each lookup either
+  // found a result, or added one. When there are more hits, the cache held
+  // results of an earlier Test. And each instance is tested twice, so at
+  // least half of the lookups must be hits
+  istringstream is( log );
+  string line;
+  size_t reports = 0;
+  while ( getline( is, line ) ){
+    long long int hits;
+    long long int lookups;
+    long long int entries;
+    if ( sscanf( line.c_str(),
+		 "Result cache : %lld hits on %lld lookups (%*[^)]), %lld entries",
+		 &hits, &lookups, &entries ) == 3 ){
+      ++reports;
+      if ( hits + entries != lookups || 2 * hits < lookups ){
+	cerr << line << endl;
+	return false;
+      }
+    }
+  }
+  return reports == expected_reports;
+}
+
+static bool change_test( const string& options,
+			 const string& test,
+			 vector<string>& output,
+			 string& log ){
+  // Test, change a setting, Test, Increment, and Test again.
+  // output gets all results, log what the experiment reported
+  capture_log capture;
+  TimblAPI exp( options, "cache_test" );
+  vector<string> result;
+  bool ok = exp.isValid()
+    && exp.Learn( demo_file( "dimin.train" ) )
+    && test_output( exp, test, output )
+    && exp.SetOptions( "-k5" )
+    && test_output( exp, test, result );
+  output.insert( output.end(), result.begin(), result.end() );
+  // add the test instances to the InstanceBase, with another class
+  ifstream is( test );
+  string line;
+  while ( ok && getline( is, line ) ){
+    ok = exp.Increment( line.substr( 0, line.rfind( ',' ) ) + ",P" );
+  }
+  ok = ok && test_output( exp, test, result );
+  output.insert( output.end(), result.begin(), result.end() );
+  log = capture.str();
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+  }
+  return ok;
+}
+
+int main(){
+  // every instance twice, the second time in reverse order
+  vector<string> lines;
+  string line;
+  ifstream is( demo_file( "dimin.test" ) );
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  string test = "cache_test." + to_string( getpid() ) + ".test";
+  {
+    ofstream os( test );
+    for ( const auto& l : lines ){
+      os << l << endl;
+    }
+    for ( auto it = lines.rbegin(); it != lines.rend(); ++it ){
+      os << *it << endl;
+    }
+  }
+  string train = demo_file( "dimin.train" );
+  int diffs = 0;
+  for ( const auto& options : { "-a IB1 -k3 -mM +vdb+di",
+				"-a IB1 -k1 -mO +x +vdb+di",
+				"-a TRIBL2 -k3 +vdb+di",
+				"-a IGTREE +D +vdb" } ){
+    vector<string> expected;
+    vector<string> got;
+    string log;
+    if ( !run_experiment( options, train, test, expected )
+	 || !run_logged( string(options) + " --cache=2000", train, test,
+			 got, log ) ){
+      ++diffs;
+      continue;
+    }
+    diffs += count_diffs( expected, got, string(options) + " --cache=2000" );
+    if ( string(options).find( "IB1" ) != string::npos
+	 && !fresh_cache( log, 1 ) ){
+      cerr << options << " --cache=2000: wrong number of hits" << endl;
+      ++diffs;
+    }
+  }
+  vector<string> expected;
+  vector<string> got;
+  string log;
+  string cache_log;
+  const string options = "-a IB1 -k3 -mM +vdb+di";
+  if ( !change_test( options, test, expected, log )
+       || !change_test( options + " --cache=2000", test, got, cache_log ) ){
+    ++diffs;
+  }
+  else {
+    diffs += count_diffs( expected, got, options + " --cache=2000, changes" );
+    if ( !fresh_cache( cache_log, 3 ) ){
+      cerr << options << " --cache=2000: the cache is not emptied after"
+	   << " a change" << endl;
+      ++diffs;
+    }
+  }
+  remove( test.c_str() );
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ with --cache" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,305 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Change the InstanceBase after learning half of dimin.train. Expanding
+// it with the other half must give the same InstanceBase as Incrementing
+// those instances one by one. Removing them again must give the same
+// output on dimin.test as Decrementing them, and so on. Every change
+// reuses, copies or adds nodes of the InstanceBase.
+// Equal distributions of leaves are shared. Decrementing an instance may
+// not change the distribution of any other leaf, which we see when we
+// test the training data with exact matching.
+// Most leaves hold only one or two classes. Leaves that get more classes
+// through Increment must end up like learning them at once, and must
+// shrink back through Decrement.
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static vector<string> read_lines( const string& name ){
+  vector<string> result;
+  ifstream is( name );
+  string line;
+  while ( getline( is, line ) ){
+    result.push_back( line );
+  }
+  return result;
+}
+
+static void write_lines( const string& name,
+			 const vector<string>& lines,
+			 size_t from,
+			 size_t to ){
+  ofstream os( name );
+  for ( size_t n=from; n < to; ++n ){
+    os << lines[n] << endl;
+  }
+}
+
+static bool save_tree( TimblAPI& exp,
+		       const string& tree,
+		       vector<string>& lines ){
+  bool ok = exp.WriteInstanceBase( tree );
+  lines = read_lines( tree );
+  remove( tree.c_str() );
+  return ok;
+}
+
+static bool expand_remove( const string& options,
+			   const string& first,
+			   const string& second,
+			   vector<string>& tree,
+			   vector<string>& output ){
+  // Learn first, Expand with second, and Remove it again. Then Increment
+  // every line of second, and Decrement and Increment some lines of first.
+  // output gets the results of testing after every change
+  const string tree_file = first + ".tree";
+  const vector<string> lines = read_lines( first );
+  TimblAPI exp( options, "change_test" );
+  vector<string> result;
+  bool ok = exp.isValid()
+    && exp.Learn( first )
+    && test_output( exp, demo_file( "dimin.test" ), output )
+    && exp.Expand( second )
+    && save_tree( exp, tree_file, tree )
+    && test_output( exp, demo_file( "dimin.test" ), result );
+  output.insert( output.end(), result.begin(), result.end() );
+  ok = ok && exp.Remove( second )
+    && test_output( exp, demo_file( "dimin.test" ), result );
+  output.insert( output.end(), result.begin(), result.end() );
+  for ( const auto& line : read_lines( second ) ){
+    if ( !ok ){
+      break;
+    }
+    ok = exp.Increment( line );
+  }
+  for ( size_t n=0; n < lines.size() && ok; n += 3 ){
+    ok = exp.Decrement( lines[n] )
+      && exp.Increment( lines[n] );
+  }
+  ok = ok && test_output( exp, demo_file( "dimin.test" ), result );
+  output.insert( output.end(), result.begin(), result.end() );
+  return ok;
+}
+
+static bool increment_decrement( const string& options,
+				 const string& first,
+				 const string& second,
+				 vector<string>& tree,
+				 vector<string>& output ){
+  // the same changes as expand_remove(), one instance at a time
+  const string tree_file = first + ".tree";
+  const vector<string> lines = read_lines( second );
+  TimblAPI exp( options, "change_test" );
+  vector<string> result;
+  bool ok = exp.isValid()
+    && exp.Learn( first )
+    && test_output( exp, demo_file( "dimin.test" ), output );
+  for ( size_t n=0; n < lines.size() && ok; ++n ){
+    ok = exp.Increment( lines[n] );
+  }
+  ok = ok && save_tree( exp, tree_file, tree )
+    && test_output( exp, demo_file( "dimin.test" ), result );
+  output.insert( output.end(), result.begin(), result.end() );
+  for ( size_t n=0; n < lines.size() && ok; ++n ){
+    ok = exp.Decrement( lines[n] );
+  }
+  ok = ok && test_output( exp, demo_file( "dimin.test" ), result );
+  output.insert( output.end(), result.begin(), result.end() );
+  for ( size_t n=0; n < lines.size() && ok; ++n ){
+    ok = exp.Increment( lines[n] );
+  }
+  const vector<string> first_lines = read_lines( first );
+  for ( size_t n=0; n < first_lines.size() && ok; n += 3 ){
+    ok = exp.Decrement( first_lines[n] )
+      && exp.Increment( first_lines[n] );
+  }
+  ok = ok && test_output( exp, demo_file( "dimin.test" ), result );
+  output.insert( output.end(), result.begin(), result.end() );
+  return ok;
+}
+
+static int compare_changes( const string& options ){
+  const string base = "change_test." + to_string( getpid() );
+  const string first = base + ".first";
+  const string second = base + ".second";
+  const vector<string> train = read_lines( demo_file( "dimin.train" ) );
+  const size_t half = train.size() / 2;
+  write_lines( first, train, 0, half );
+  write_lines( second, train, half, train.size() );
+  vector<string> expected_tree;
+  vector<string> expected;
+  vector<string> tree;
+  vector<string> got;
+  bool ok = increment_decrement( options, first, second,
+				 expected_tree, expected )
+    && expand_remove( options, first, second, tree, got );
+  remove( first.c_str() );
+  remove( second.c_str() );
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+    return 1;
+  }
+  return count_diffs( expected_tree, tree, options + ", Expand tree" )
+    + count_diffs( expected, got, options + ", Expand and Remove" );
+}
+
+static int shared_distributions( const string& options ){
+  // Learn dimin.train, and test it. Decrement every 10th line, and test it
+  // again: only the lines with the same features as a Decremented one may
+  // change. After Incrementing them again, nothing may have changed.
+  const vector<string> train = read_lines( demo_file( "dimin.train" ) );
+  vector<string> before;
+  vector<string> decremented;
+  vector<string> incremented;
+  set<string> changed;
+  TimblAPI exp( options, "change_test" );
+  bool ok = exp.isValid()
+    && exp.Learn( demo_file( "dimin.train" ) )
+    && test_output( exp, demo_file( "dimin.train" ), before );
+  for ( size_t n=0; n < train.size() && ok; n += 10 ){
+    ok = exp.Decrement( train[n] );
+    changed.insert( train[n].substr( 0, train[n].rfind( ',' ) ) );
+  }
+  ok = ok && test_output( exp, demo_file( "dimin.train" ), decremented );
+  for ( size_t n=0; n < train.size() && ok; n += 10 ){
+    ok = exp.Increment( train[n] );
+  }
+  ok = ok && test_output( exp, demo_file( "dimin.train" ), incremented );
+  if ( !ok || before.size() != train.size() ){
+    cerr << options << ": failed" << endl;
+    return 1;
+  }
+  vector<string> expected;
+  vector<string> got;
+  for ( size_t n=0; n < train.size(); ++n ){
+    if ( changed.find( train[n].substr( 0, train[n].rfind( ',' ) ) )
+	 == changed.end() ){
+      expected.push_back( before[n] );
+      got.push_back( decremented[n] );
+    }
+  }
+  return count_diffs( expected, got, options + ", other leaves" )
+    + count_diffs( before, incremented, options + ", Decrement and Increment" );
+}
+
+static void many_classes_data( vector<string>& seed,
+			       vector<string>& rest,
+			       vector<string>& keys ){
+  // key k gets 1 + k%7 classes, added in a scrambled order, some of them
+  // more than once. seed holds the first instance of every key
+  const size_t num_keys = 30;
+  for ( size_t k=0; k < num_keys; ++k ){
+    const string key = "f" + to_string( k ) + ",g" + to_string( k % 5 );
+    keys.push_back( key + ",c0" );
+    const size_t classes = 1 + k % 7;
+    for ( size_t j=0; j < classes; ++j ){
+      const string line = key + ",c" + to_string( (j*3 + k) % classes );
+      for ( size_t n=0; n <= j % 3; ++n ){
+	if ( j == 0 && n == 0 ){
+	  seed.push_back( line );
+	}
+	else {
+	  rest.push_back( line );
+	}
+      }
+    }
+  }
+}
+
+static int many_classes( const string& options ){
+  // Learn one instance per key, Increment the other classes, and Decrement
+  // them again
+  const string base = "change_test." + to_string( getpid() );
+  const string seed_file = base + ".seed";
+  const string all_file = base + ".all";
+  const string keys_file = base + ".keys";
+  vector<string> seed;
+  vector<string> rest;
+  vector<string> keys;
+  many_classes_data( seed, rest, keys );
+  vector<string> all = seed;
+  all.insert( all.end(), rest.begin(), rest.end() );
+  write_lines( seed_file, seed, 0, seed.size() );
+  write_lines( all_file, all, 0, all.size() );
+  write_lines( keys_file, keys, 0, keys.size() );
+  vector<string> expected;
+  vector<string> learned;
+  vector<string> incremented;
+  vector<string> decremented;
+  TimblAPI exp_all( options, "change_test" );
+  bool ok = exp_all.isValid()
+    && exp_all.Learn( all_file )
+    && test_output( exp_all, keys_file, expected );
+  TimblAPI exp( options, "change_test" );
+  ok = ok && exp.isValid()
+    && exp.Learn( seed_file )
+    && test_output( exp, keys_file, learned );
+  for ( size_t n=0; n < rest.size() && ok; ++n ){
+    ok = exp.Increment( rest[n] );
+  }
+  ok = ok && test_output( exp, keys_file, incremented );
+  for ( size_t n=rest.size(); n > 0 && ok; --n ){
+    ok = exp.Decrement( rest[n-1] );
+  }
+  ok = ok && test_output( exp, keys_file, decremented );
+  remove( seed_file.c_str() );
+  remove( all_file.c_str() );
+  remove( keys_file.c_str() );
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+    return 1;
+  }
+  return count_diffs( expected, incremented, options + ", many classes" )
+    + count_diffs( learned, decremented, options + ", fewer classes" );
+}
+
+int main(){
+  int diffs = compare_changes( "-a IB1 -k3 -mM +vdb+di" )
+    + compare_changes( "-a IB1 -k1 -mO +vdb+di" )
+    + compare_changes( "-a IB1 -k3 -mM +vdb+di --freeze" )
+    + shared_distributions( "-a IB1 +x -k1 +vdb" )
+    + shared_distributions( "-a IB1 +x -k1 +vdb --freeze" )
+    + many_classes( "-a IB1 +x -k1 +vdb" )
+    + many_classes( "-a IB1 +x -k1 +vdb --freeze" );
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ after changing the InstanceBase" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
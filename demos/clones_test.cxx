@@ -0,0 +1,131 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Learn dimin.train with and without --clones=4, which builds the
+// partitions of IB1 and TRIBL in parallel, and assigns the defaults and
+// prunes the tree of IGTREE in parallel. The saved InstanceBases must be
+// the same, and so must be the output on dimin.test. The value difference
+// matrices are computed by as many threads, and must be the same too.
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static bool learn_and_save( const string& options,
+			    const string& tree,
+			    vector<string>& lines ){
+  bool ok;
+  {
+    TimblAPI exp( options, "clones_test" );
+    ok = exp.isValid()
+      && exp.Learn( demo_file( "dimin.train" ) )
+      && exp.WriteInstanceBase( tree );
+  }
+  ifstream is( tree );
+  string line;
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  remove( tree.c_str() );
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+  }
+  return ok;
+}
+
+static int compare_trees( const string& options ){
+  string tree = "clones_test." + to_string( getpid() ) + ".tree";
+  vector<string> expected;
+  vector<string> got;
+  if ( !learn_and_save( options, tree, expected )
+       || !learn_and_save( options + " --clones=4", tree, got ) ){
+    return 1;
+  }
+  return count_diffs( expected, got, options + " --clones=4, saved" )
+    + compare_option( options, "--clones=4" );
+}
+
+static bool test_and_write( const string& options,
+			    const string& matrices,
+			    vector<string>& lines ){
+  bool ok;
+  {
+    TimblAPI exp( options, "clones_test" );
+    ok = exp.isValid()
+      && exp.Learn( demo_file( "dimin.train" ) )
+      && test_output( exp, demo_file( "dimin.test" ), lines )
+      && exp.WriteMatrices( matrices );
+  }
+  ifstream is( matrices );
+  string line;
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  remove( matrices.c_str() );
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+  }
+  return ok;
+}
+
+static int compare_matrices( const string& options ){
+  // the output on dimin.test, followed by the --matrixout file
+  string matrices = "clones_test." + to_string( getpid() ) + ".matrices";
+  vector<string> expected;
+  vector<string> got;
+  if ( !test_and_write( options + " --clones=1", matrices, expected )
+       || !test_and_write( options + " --clones=4", matrices, got ) ){
+    return 1;
+  }
+  return count_diffs( expected, got, options + " --clones=4, matrices" );
+}
+
+int main(){
+  int diffs = compare_trees( "-a IB1 -k3 -mM +vdb+di" )
+    + compare_trees( "-a IB1 -k1 -mO +D +vdb+di" )
+    + compare_trees( "-a TRIBL -q2 -k3 +vdb+di" )
+    + compare_trees( "-a TRIBL2 -k3 +vdb+di" )
+    + compare_trees( "-a IGTREE" )
+    + compare_trees( "-a IGTREE +D +vdb" )
+    + compare_matrices( "-a IB1 -k3 -mM" )
+    + compare_matrices( "-a IB1 -k3 -mJ" )
+    + compare_matrices( "-a IB1 -k3 -mS -L2" );
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ with --clones" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
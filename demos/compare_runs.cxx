@@ -0,0 +1,154 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+string demo_file( const string& name ){
+  const char *top = getenv( "topsrcdir" );
+  return string( top ? top : ".." ) + "/demos/" + name;
+}
+
+bool test_output( TimblAPI& exp,
+		  const string& test,
+		  vector<string>& output ){
+  // the tests may run in parallel, so every process has its own file
+  string out = "compare_runs." + to_string( getpid() ) + ".out";
+  output.clear();
+  if ( !exp.Test( test, out ) ){
+    remove( out.c_str() );
+    return false;
+  }
+  ifstream is( out );
+  string line;
+  while ( getline( is, line ) ){
+    output.push_back( line );
+  }
+  remove( out.c_str() );
+  return !output.empty();
+}
+
+bool run_experiment( const string& options,
+		     const string& train,
+		     const string& test,
+		     vector<string>& output ){
+  TimblAPI exp( options, "compare_runs" );
+  if ( !exp.isValid() || !exp.Learn( train ) ){
+    cerr << options << ": learning " << train << " failed" << endl;
+    return false;
+  }
+  if ( !test_output( exp, test, output ) ){
+    cerr << options << ": testing " << test << " failed" << endl;
+    return false;
+  }
+  return true;
+}
+
+int count_diffs( const vector<string>& expected,
+		 const vector<string>& got,
+		 const string& what ){
+  if ( expected.size() != got.size() ){
+    cerr << what << ": " << got.size() << " lines instead of "
+	 << expected.size() << endl;
+    return 1;
+  }
+  int diffs = 0;
+  for ( size_t n=0; n < expected.size(); ++n ){
+    if ( expected[n] != got[n] ){
+      if ( diffs == 0 ){
+	cerr << what << ": line " << n+1 << endl
+	     << "  expected: " << expected[n] << endl
+	     << "  got:      " << got[n] << endl;
+      }
+      ++diffs;
+    }
+  }
+  return diffs;
+}
+
+int compare_option( const string& options, const string& option ){
+  vector<string> expected;
+  vector<string> got;
+  string train = demo_file( "dimin.train" );
+  string test = demo_file( "dimin.test" );
+  if ( !run_experiment( options, train, test, expected )
+       || !run_experiment( options + " " + option, train, test, got ) ){
+    return 1;
+  }
+  return count_diffs( expected, got, options + " " + option );
+}
+
+bool run_logged( const string& options,
+		 const string& train,
+		 const string& test,
+		 vector<string>& output,
+		 string& log ){
+  bool ok;
+  {
+    capture_log capture;
+    ok = run_experiment( options, train, test, output );
+    log = capture.str();
+  }
+  if ( !ok ){
+    cerr << log;
+  }
+  return ok;
+}
+
+size_t count_lines( const string& log, const string& what ){
+  size_t count = 0;
+  istringstream is( log );
+  string line;
+  while ( getline( is, line ) ){
+    if ( line.find( what ) != string::npos ){
+      ++count;
+    }
+  }
+  return count;
+}
+
+long long int number_after( const string& log, const string& what ){
+  istringstream is( log );
+  string line;
+  while ( getline( is, line ) ){
+    if ( line.compare( 0, what.size(), what ) == 0 ){
+      return strtoll( line.c_str() + what.size(), 0, 10 );
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,97 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Shared by the tests that run an experiment with some option, and
+// compare the output with the same experiment without it.
+
+#ifndef TIMBL_COMPARE_RUNS_H
+#define TIMBL_COMPARE_RUNS_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "timbl/TimblAPI.h"
+
+// the full name of a file in the demos directory
+std::string demo_file( const std::string& );
+
+// Test the file with exp, and return the lines of the output
+bool test_output( Timbl::TimblAPI&,
+		  const std::string&,
+		  std::vector<std::string>& );
+
+// Learn the train file and Test the test file with the options, and
+// return the lines of the output
+bool run_experiment( const std::string&,
+		     const std::string&,
+		     const std::string&,
+		     std::vector<std::string>& );
+
+// count the lines that differ, and show the first one
+int count_diffs( const std::vector<std::string>&,
+		 const std::vector<std::string>&,
+		 const std::string& );
+
+// run dimin with the options, with and without the extra option(s), and
+// count the differences
+int compare_option( const std::string&, const std::string& );
+
+// collects what is written to std::cout and std::cerr while it exists, so
+// a test can check what an experiment reports
+class capture_log {
+ public:
+  capture_log():
+    keep_out( std::cout.rdbuf( buffer.rdbuf() ) ),
+    keep_err( std::cerr.rdbuf( buffer.rdbuf() ) )
+  {};
+  ~capture_log(){
+    std::cout.rdbuf( keep_out );
+    std::cerr.rdbuf( keep_err );
+  };
+  std::string str() const { return buffer.str(); };
+ private:
+  std::stringstream buffer;
+  std::streambuf *keep_out;
+  std::streambuf *keep_err;
+};
+
+// run_experiment(), and return what the experiment reported in log
+bool run_logged( const std::string&,
+		 const std::string&,
+		 const std::string&,
+		 std::vector<std::string>&,
+		 std::string& log );
+
+// the number of lines of log that contain 'what'
+size_t count_lines( const std::string& log, const std::string& what );
+
+// the number in the line of the log that starts with 'what', after it.
+// -1 when there is no such line
+long long int number_after( const std::string& log, const std::string& what );
+
+#endif // TIMBL_COMPARE_RUNS_H
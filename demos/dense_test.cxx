@@ -0,0 +1,102 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// --dense needs numeric data, so we make some: random points with a
+// class that depends on their position. Test them with the numeric and
+// the similarity metrics, with and without --dense. The brute force
+// search must give the output of the tree search, and the experiment must
+// report that it uses it. With the Overlap metric --dense is ignored, with
+// a warning.
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "compare_runs.h"
+
+using namespace std;
+
+static void make_data( const string& name, size_t lines, uint32_t& seed ){
+  // a simple LCG, so the data is the same on every platform
+  ofstream os( name );
+  const size_t features = 6;
+  for ( size_t l=0; l < lines; ++l ){
+    int sum = 0;
+    for ( size_t f=0; f < features; ++f ){
+      seed = seed * 1664525U + 1013904223U;
+      int value = ( seed >> 16 ) % 100;
+      sum += ( f % 2 == 0 ) ? value : -value;
+      os << value << ",";
+    }
+    os << ( sum > 20 ? "A" : ( sum < -20 ? "B" : "C" ) ) << endl;
+  }
+}
+
+int main(){
+  string base = "dense_test." + to_string( getpid() );
+  string train = base + ".train";
+  string test = base + ".test";
+  uint32_t seed = 12345;
+  make_data( train, 1000, seed );
+  make_data( test, 300, seed );
+  int diffs = 0;
+  for ( const auto& options : { "-a IB1 -k3 -mN +vdb+di",
+				"-a IB1 -k1 -mE +vdb+di",
+				"-a IB1 -k5 -mN -dIL +vdb+di",
+				"-a IB1 -k3 -mC +vdb+di",
+				"-a IB1 -k3 -mD +vdb+di",
+				"-a IB1 -k3 -mO +vdb+di" } ){
+    vector<string> expected;
+    vector<string> got;
+    string log;
+    if ( !run_experiment( options, train, test, expected )
+	 || !run_logged( string(options) + " --dense", train, test,
+			 got, log ) ){
+      ++diffs;
+      continue;
+    }
+    diffs += count_diffs( expected, got, string(options) + " --dense" );
+    bool ignored = string(options).find( "-mO" ) != string::npos;
+    if ( count_lines( log, "Dense InstanceBase" ) != ( ignored ? 0 : 1 )
+	 || count_lines( log, "--dense is ignored" ) != ( ignored ? 1 : 0 ) ){
+      cerr << options << " --dense: "
+	   << ( ignored ? "not ignored" : "not used" ) << endl;
+      ++diffs;
+    }
+  }
+  remove( train.c_str() );
+  remove( test.c_str() );
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ with --dense" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Test dimin.test with exact matching (+x), with and without
+// --exactindex. Also after Incrementing and Decrementing, which have to
+// keep the index up to date: the same exact matches must be found, with
+// the same number of visited nodes, also when testing the instances that
+// were Decremented.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static vector<long long int> numbers_after( const string& log,
+					    const string& start,
+					    const string& what ){
+  // the number after 'what' in every line of the log that starts with
+  // 'start'. 0 when 'what' is missing
+  vector<long long int> result;
+  istringstream is( log );
+  string line;
+  while ( getline( is, line ) ){
+    if ( line.compare( 0, start.size(), start ) == 0 ){
+      string::size_type pos = line.find( what );
+      if ( pos == string::npos ){
+	result.push_back( 0 );
+      }
+      else {
+	result.push_back( strtoll( line.c_str() + pos + what.size(), 0, 10 ) );
+      }
+    }
+  }
+  return result;
+}
+
+static bool learn_change_test( const string& options,
+			       vector<string>& output,
+			       string& log ){
+  // Learn half of dimin.train, and Test. Then Increment the other half,
+  // and Test. Decrement the first quarter, and Test again, also on that
+  // quarter.
+  // output gets all results, log what the experiment reported
+  vector<string> train;
+  string line;
+  ifstream is( demo_file( "dimin.train" ) );
+  while ( getline( is, line ) ){
+    train.push_back( line );
+  }
+  const size_t half = train.size() / 2;
+  const string part = "exactindex_test.train";
+  {
+    ofstream os( part );
+    for ( size_t n=0; n < half; ++n ){
+      os << train[n] << endl;
+    }
+  }
+  const string removed = "exactindex_test.removed";
+  {
+    ofstream os( removed );
+    for ( size_t n=0; n < half / 2; ++n ){
+      os << train[n] << endl;
+    }
+  }
+  capture_log capture;
+  TimblAPI exp( options, "exactindex_test" );
+  bool ok = exp.isValid() && exp.Learn( part );
+  remove( part.c_str() );
+  ok = ok && test_output( exp, demo_file( "dimin.test" ), output );
+  for ( size_t n=half; n < train.size() && ok; ++n ){
+    ok = exp.Increment( train[n] );
+  }
+  vector<string> second;
+  ok = ok && test_output( exp, demo_file( "dimin.test" ), second );
+  output.insert( output.end(), second.begin(), second.end() );
+  for ( size_t n=0; n < half / 2 && ok; ++n ){
+    ok = exp.Decrement( train[n] );
+  }
+  ok = ok && test_output( exp, demo_file( "dimin.test" ), second );
+  output.insert( output.end(), second.begin(), second.end() );
+  ok = ok && test_output( exp, removed, second );
+  remove( removed.c_str() );
+  output.insert( output.end(), second.begin(), second.end() );
+  log = capture.str();
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+  }
+  return ok;
+}
+
+int main(){
+  int diffs = compare_option( "-a IB1 +x -k1 +vdb+di", "--exactindex" )
+    + compare_option( "-a IB1 +x -k3 -mM +vdb+di", "--exactindex" )
+    + compare_option( "-a IB1 +x -k3 -mM +vdb+di", "--exactindex --freeze" );
+  vector<string> expected;
+  vector<string> got;
+  string expected_log;
+  string log;
+  const string options = "-a IB1 +x -k3 +vdb+di";
+  if ( !learn_change_test( options, expected, expected_log )
+       || !learn_change_test( options + " --exactindex", got, log ) ){
+    return EXIT_FAILURE;
+  }
+  diffs += count_diffs( expected, got, options + " --exactindex, Increment" );
+  if ( count_lines( log, "Indexed InstanceBase" ) == 0
+       || count_lines( expected_log, "Indexed InstanceBase" ) != 0 ){
+    cerr << "the InstanceBase is not indexed with --exactindex only" << endl;
+    ++diffs;
+  }
+  // an exact match that is not found in the index, is found by searching
+  // the neighbors. That gives the same answer, but visits more nodes
+  vector<long long int> exact
+    = numbers_after( expected_log, "overall accuracy", "of which " );
+  vector<long long int> visits
+    = numbers_after( expected_log, "Nodes visited", ": " );
+  if ( exact.size() != 4
+       || exact[3] == 0
+       || numbers_after( log, "overall accuracy", "of which " ) != exact
+       || numbers_after( log, "Nodes visited", ": " ) != visits ){
+    cerr << "--exactindex found other exact matches" << endl;
+    ++diffs;
+  }
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ with --exactindex" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Test dimin.test with every algorithm, with and without --freeze. The
+// frozen layout must give the same output. Also after the InstanceBase
+// has changed, which makes the next test rebuild the layout. But not every
+// Classify after a change: the layout is built (and reported) only once.
+// IGTree lookups that stop early on an unseen value answer with the
+// default of the node they reached, which the layout keeps itself.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static bool learn_change_test( const string& options,
+			       vector<string>& output,
+			       string& log ){
+  // Learn half of dimin.train, Test, Increment the other half, with a
+  // Classify after every 10 of them, and Test again. output gets both
+  // results, log what the experiment reported
+  vector<string> train;
+  string line;
+  ifstream is( demo_file( "dimin.train" ) );
+  while ( getline( is, line ) ){
+    train.push_back( line );
+  }
+  const string part = "freeze_test.train";
+  {
+    ofstream os( part );
+    for ( size_t n=0; n < train.size() / 2; ++n ){
+      os << train[n] << endl;
+    }
+  }
+  vector<string> second;
+  bool ok;
+  {
+    capture_log capture;
+    TimblAPI exp( options, "freeze_test" );
+    ok = exp.isValid() && exp.Learn( part );
+    ok = ok && test_output( exp, demo_file( "dimin.test" ), output );
+    for ( size_t n=train.size() / 2; n < train.size() && ok; ++n ){
+      ok = exp.Increment( train[n] );
+      if ( ok && n % 10 == 0 ){
+	ok = exp.Classify( train[n] ) != 0;
+      }
+    }
+    ok = ok && test_output( exp, demo_file( "dimin.test" ), second );
+    log = capture.str();
+  }
+  remove( part.c_str() );
+  output.insert( output.end(), second.begin(), second.end() );
+  if ( !ok ){
+    cerr << options << ": failed" << endl;
+  }
+  return ok;
+}
+
+static bool ib2_test( const string& options,
+		      vector<string>& output,
+		      string& log ){
+  // IB2 adds an instance after every misclassified one, so the tree
+  // changes all the time. It needs a Prepare() to take the -b option
+  bool ok;
+  {
+    capture_log capture;
+    TimblAPI exp( options, "freeze_test" );
+    ok = exp.isValid()
+      && exp.Prepare( demo_file( "dimin.train" ) )
+      && exp.Learn( demo_file( "dimin.train" ) )
+      && test_output( exp, demo_file( "dimin.test" ), output );
+    log = capture.str();
+  }
+  if ( !ok ){
+    cerr << log;
+  }
+  return ok;
+}
+
+static int unseen_test( const string& options ){
+  // replace the values of every line of dimin.test by unseen ones, from
+  // a different position onward, so the lookups stop on every level
+  vector<string> lines;
+  string line;
+  ifstream is( demo_file( "dimin.test" ) );
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  const string unseen = "freeze_test.unseen";
+  {
+    ofstream os( unseen );
+    for ( size_t n=0; n < lines.size(); ++n ){
+      size_t pos = 0;
+      for ( size_t f=0; f < n % 13; ++f ){
+	pos = lines[n].find( ',', pos ) + 1;
+      }
+      string result = lines[n].substr( 0, pos );
+      for ( size_t f=n % 13; f < 12; ++f ){
+	result += "#u,";
+      }
+      os << result << lines[n].substr( lines[n].rfind( ',' ) + 1 ) << endl;
+    }
+  }
+  vector<string> expected;
+  vector<string> got;
+  const string train = demo_file( "dimin.train" );
+  bool ok = run_experiment( options, train, unseen, expected )
+    && run_experiment( options + " --freeze", train, unseen, got );
+  remove( unseen.c_str() );
+  if ( !ok ){
+    cerr << options << " --freeze, unseen values: failed" << endl;
+    return 1;
+  }
+  return count_diffs( expected, got, options + " --freeze, unseen values" );
+}
+
+int main(){
+  int diffs = compare_option( "-a IB1 -k3 -mM +vdb+di", "--freeze" )
+    + compare_option( "-a IB1 -mO -k1 +vdb+di", "--freeze" )
+    + compare_option( "-a IGTREE +D +vdb", "--freeze" )
+    + compare_option( "-a TRIBL -q2 -k3 +vdb+di", "--freeze" )
+    + compare_option( "-a TRIBL2 -k3 +vdb+di", "--freeze" )
+    + unseen_test( "-a IGTREE" )
+    + unseen_test( "-a IGTREE +D +vdb" )
+    + unseen_test( "-a TRIBL -q2 -k1 +vdb" );
+  vector<string> expected;
+  vector<string> got;
+  string log;
+  const string options = "-a IB1 -k3 -mM +vdb+di";
+  if ( !learn_change_test( options, expected, log )
+       || !learn_change_test( options + " --freeze", got, log ) ){
+    return EXIT_FAILURE;
+  }
+  diffs += count_diffs( expected, got, options + " --freeze, Increment" );
+  const string froze = "Froze InstanceBase";
+  if ( count_lines( log, froze ) != 1 ){
+    cerr << options << " --freeze, Increment: '" << froze << "' reported "
+	 << count_lines( log, froze ) << " times instead of once" << endl;
+    ++diffs;
+  }
+  const string ib2 = "-a IB2 -b100 -k1 +vdb+di";
+  if ( !ib2_test( ib2, expected, log )
+       || !ib2_test( ib2 + " --freeze", got, log ) ){
+    cerr << ib2 << ": failed" << endl;
+    return EXIT_FAILURE;
+  }
+  diffs += count_diffs( expected, got, ib2 + " --freeze" );
+  if ( count_lines( log, froze ) != 1 ){
+    cerr << ib2 << " --freeze: '" << froze << "' reported "
+	 << count_lines( log, froze ) << " times instead of once" << endl;
+    ++diffs;
+  }
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ with --freeze" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Classify dimin.test with classify_to_JSON(), and check the shape of the
+// neighbors in the result: an object for each of the k nearest neighbors,
+// in order. Only for k=1 it is a single object. When a Tie is resolved with
+// an extra neighbor, that one is shown too. After that, the array may end
+// with records that are not used, which are null.
+// Without +vn there are no neighbors at all.
+// Without distance weighting, the distribution of the answer is the sum of
+// the distributions of all the neighbors shown.
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+using namespace nlohmann;
+
+static bool check_record( const json& record, size_t k ){
+  return record.is_object()
+    && record.value( "k", 0 ) == k
+    && record.contains( "distance" )
+    && record.contains( "total" )
+    && record.contains( "neighbor" );
+}
+
+static int check_shape( const vector<string>& lines,
+			const string& options,
+			size_t k ){
+  TimblAPI api( options, "json_test" );
+  if ( !api.isValid()
+       || !api.Learn( demo_file( "dimin.train" ) ) ){
+    cerr << options << ": learning failed" << endl;
+    return 1;
+  }
+  TimblExperiment *exp = api.grabAndDisconnectExp();
+  int wrong = 0;
+  for ( const auto& line : lines ){
+    json result = exp->classify_to_JSON( line );
+    bool ok = result.contains( "category" )
+      && result.contains( "distance" );
+    if ( ok && options.find( "+vn" ) == string::npos ){
+      ok = !result.contains( "neighbors" );
+    }
+    else if ( ok ){
+      json neighbors = result["neighbors"];
+      if ( k == 1 && neighbors.is_object() ){
+	neighbors = json::array( { neighbors } );
+      }
+      ok = neighbors.is_array() && neighbors.size() >= k;
+      for ( size_t i=0; ok && i < neighbors.size(); ++i ){
+	if ( i < k ){
+	  ok = check_record( neighbors[i], i+1 );
+	}
+	else if ( i == k && !neighbors[i].is_null() ){
+	  // the neighbor that resolved a Tie
+	  ok = check_record( neighbors[i], i+1 );
+	}
+	else {
+	  ok = neighbors[i].is_null();
+	}
+      }
+    }
+    if ( !ok ){
+      if ( wrong == 0 ){
+	cerr << options << ": " << line << endl
+	     << "  unexpected: " << result << endl;
+      }
+      ++wrong;
+    }
+  }
+  delete exp;
+  return wrong;
+}
+
+static map<string,double> parse_distribution( const string& dist ){
+  // "{ E 3.00000, P 2.00000 }"
+  map<string,double> result;
+  istringstream is( dist );
+  string brace;
+  is >> brace;
+  string cls;
+  string freq;
+  while ( is >> cls >> freq ){
+    result[cls] += stod( freq );
+  }
+  return result;
+}
+
+static bool add_neighbor( const json& neighbor, map<string,double>& sum ){
+  if ( !neighbor.is_object() || !neighbor.contains( "distribution" ) ){
+    return false;
+  }
+  for ( const auto& it : parse_distribution( neighbor["distribution"] ) ){
+    sum[it.first] += it.second;
+  }
+  return true;
+}
+
+static bool same_distribution( const map<string,double>& d1,
+			       const map<string,double>& d2 ){
+  if ( d1.size() != d2.size() ){
+    return false;
+  }
+  for ( const auto& it : d1 ){
+    auto it2 = d2.find( it.first );
+    if ( it2 == d2.end() || fabs( it.second - it2->second ) > 1.0e-4 ){
+      return false;
+    }
+  }
+  return true;
+}
+
+static int check_sum( const vector<string>& lines,
+		      const string& options ){
+  TimblAPI api( options, "json_test" );
+  if ( !api.isValid()
+       || !api.Learn( demo_file( "dimin.train" ) ) ){
+    cerr << options << ": learning failed" << endl;
+    return 1;
+  }
+  TimblExperiment *exp = api.grabAndDisconnectExp();
+  int wrong = 0;
+  size_t checked = 0;
+  for ( const auto& line : lines ){
+    json result = exp->classify_to_JSON( line );
+    json neighbors = result["neighbors"];
+    if ( neighbors.is_object() ){
+      neighbors = json::array( { neighbors } );
+    }
+    bool ok = result.contains( "distribution" ) && neighbors.is_array();
+    bool limited = false;
+    map<string,double> sum;
+    for ( size_t i=0; ok && i < neighbors.size(); ++i ){
+      const json& record = neighbors[i];
+      if ( record.is_null() ){
+	continue;
+      }
+      limited = limited || record.contains( "limited" );
+      const json& neighbor = record["neighbor"];
+      if ( neighbor.is_array() ){
+	for ( const auto& one : neighbor ){
+	  ok = ok && add_neighbor( one, sum );
+	}
+      }
+      else {
+	ok = add_neighbor( neighbor, sum );
+      }
+    }
+    if ( limited ){
+      // not every neighbor is shown
+      continue;
+    }
+    ++checked;
+    if ( !ok
+	 || !same_distribution( sum,
+				parse_distribution( result["distribution"] ) ) ){
+      if ( wrong == 0 ){
+	cerr << options << ": " << line << endl
+	     << "  the neighbors don't add up to: " << result << endl;
+      }
+      ++wrong;
+    }
+  }
+  delete exp;
+  if ( checked < lines.size() / 2 ){
+    cerr << options << ": only " << checked << " results checked" << endl;
+    ++wrong;
+  }
+  return wrong;
+}
+
+int main(){
+  vector<string> lines;
+  string line;
+  ifstream is( demo_file( "dimin.test" ) );
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  if ( lines.empty() ){
+    return EXIT_FAILURE;
+  }
+  int wrong = check_shape( lines, "-a IB1 -k1 +vn+di", 1 )
+    + check_shape( lines, "-a IB1 -k3 -mM +vn+di+db", 3 )
+    + check_shape( lines, "-a IB1 -k3 -dIL +vn+di", 3 )
+    + check_shape( lines, "-a IB1 -k3 -mM +vdb+di", 3 )
+    + check_sum( lines, "-a IB1 -k3 -mM +vn+db" )
+    + check_sum( lines, "-a IB1 -k5 -mO +vn+db" )
+    + check_sum( lines, "-a IB1 -k3 -mM +vn+db --freeze" );
+  if ( wrong > 0 ){
+    cerr << wrong << " results have the wrong neighbors" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// The children of a node are looked up with a scan, a binary search or a
+// hash table, depending on how many there are. So we make data with a few,
+// some hundreds and thousands of values per feature, where every
+// instance is unique and its class follows from its values. Testing the
+// training data itself must then find every instance, and give its class,
+// also after half of it was added with Increment(). With +x the exact
+// matches must be found without searching the neighbors.
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static vector<string> make_data( size_t lines ){
+  // a simple LCG, so the data is the same on every platform
+  const uint32_t sizes[] = { 3, 40, 300, 2000 };
+  uint32_t seed = 4711;
+  set<string> seen;
+  vector<string> result;
+  while ( result.size() < lines ){
+    string line;
+    uint32_t sum = 0;
+    for ( const auto size : sizes ){
+      seed = seed * 1664525U + 1013904223U;
+      uint32_t value = ( seed >> 8 ) % size;
+      sum += value;
+      line += "v" + to_string( value ) + ",";
+    }
+    if ( seen.insert( line ).second ){
+      result.push_back( line + string( 1, 'A' + sum % 4 ) );
+    }
+  }
+  return result;
+}
+
+static size_t count_correct( const vector<string>& output ){
+  // the lines where the answer is the class of the instance
+  size_t correct = 0;
+  for ( const auto& line : output ){
+    string::size_type pos = line.rfind( ',' );
+    string answer = line.substr( pos + 1 );
+    string::size_type prev = line.rfind( ',', pos - 1 );
+    if ( line.substr( prev + 1, pos - prev - 1 ) == answer ){
+      ++correct;
+    }
+  }
+  return correct;
+}
+
+static bool learn_increment_test( const string& options,
+				  const vector<string>& data,
+				  const string& train,
+				  vector<string>& output,
+				  string& log ){
+  // Learn the first half of the data and Test it, so the lookups are
+  // indexed. Then Increment the rest, and Test it all
+  const string half = train + ".half";
+  {
+    ofstream os( half );
+    for ( size_t n=0; n < data.size() / 2; ++n ){
+      os << data[n] << endl;
+    }
+  }
+  capture_log capture;
+  TimblAPI exp( options, "lookup_test" );
+  bool ok = exp.isValid()
+    && exp.Learn( half )
+    && test_output( exp, half, output );
+  remove( half.c_str() );
+  for ( size_t n=data.size() / 2; n < data.size() && ok; ++n ){
+    ok = exp.Increment( data[n] );
+  }
+  ok = ok && test_output( exp, train, output );
+  log = capture.str();
+  return ok;
+}
+
+int main(){
+  const vector<string> data = make_data( 6000 );
+  const string train = "lookup_test." + to_string( getpid() ) + ".train";
+  {
+    ofstream os( train );
+    for ( const auto& line : data ){
+      os << line << endl;
+    }
+  }
+  int wrong = 0;
+  for ( const auto& options : { "-a IB1 +x -k1",
+				"-a IB1 +x -k1 --freeze",
+				"-a IGTREE",
+				"-a IGTREE --freeze",
+				"-a TRIBL -q2 -k1",
+				"-a TRIBL2 -k1",
+				"-a TRIBL2 -k1 --freeze" } ){
+    vector<string> output;
+    if ( !run_experiment( options, train, train, output ) ){
+      ++wrong;
+      continue;
+    }
+    size_t correct = count_correct( output );
+    if ( correct != data.size() ){
+      cerr << options << ": " << correct << " of the " << data.size()
+	   << " training instances found" << endl;
+      ++wrong;
+    }
+  }
+  for ( const auto& options : { "-a IB1 +x -k1", "-a IB1 +x -k1 --freeze" } ){
+    vector<string> output;
+    string log;
+    if ( !learn_increment_test( options, data, train, output, log ) ){
+      cerr << options << ": Increment failed" << endl;
+      ++wrong;
+      continue;
+    }
+    size_t correct = count_correct( output );
+    if ( correct != data.size() ){
+      cerr << options << ", Increment: " << correct << " of the "
+	   << data.size() << " training instances found" << endl;
+      ++wrong;
+    }
+    // every instance is an exact match, so there is nothing to search
+    if ( count_lines( log, "Nodes visited" ) != 0 ){
+      cerr << options << ", Increment: not all exact matches were looked up"
+	   << endl;
+      ++wrong;
+    }
+  }
+  remove( train.c_str() );
+  if ( wrong > 0 ){
+    cerr << wrong << " experiments didn't find the training instances"
+	 << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
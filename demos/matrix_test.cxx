@@ -0,0 +1,155 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Learn dimin.train with the value difference metrics, and write the
+// matrices (--matrixout). Read them back (--matrixin), and write them
+// again. That file has the same values, and also lists the pairs that
+// were never computed, with a 0. Reading that file must give the output
+// of the first read. The first file must look like Timbl has always
+// written it: the same values, in the same order.
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sstream>
+#include "timbl/TimblAPI.h"
+#include "timbl/Matrices.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+// the start of the file for -mM, as written before the matrices were
+// packed
+static const vector<string> mvdm_start = {
+  "Feature 1",
+  "[+,\t=] 0.192069",
+  "[-,\t=] 0.140616",
+  "[-,\t+] 0.30115",
+  "",
+  "Feature 2",
+  "[r,\t=] 0.109871",
+  "[b,\t=] 0.133208",
+  "[b,\tr] 0.126496",
+  "[p,\t=] 0.0793152",
+  "[p,\tr] 0.0305556",
+  "[p,\tb] 0.115385"
+};
+
+static vector<string> read_lines( const string& name ){
+  // the lines of the file, without the pairs with a 0
+  vector<string> lines;
+  ifstream is( name );
+  string line;
+  while ( getline( is, line ) ){
+    if ( line.size() < 3
+	 || line.compare( line.size()-3, 3, "] 0" ) != 0 ){
+      lines.push_back( line );
+    }
+  }
+  return lines;
+}
+
+static bool learn_and_test( const string& options,
+			    const string& matrix_in,
+			    const string& matrix_out,
+			    vector<string>& output ){
+  TimblAPI exp( options, "matrix_test" );
+  bool ok = exp.isValid()
+    && exp.Learn( demo_file( "dimin.train" ) );
+  if ( ok && !matrix_in.empty() ){
+    ok = exp.GetMatrices( matrix_in );
+  }
+  return ok
+    && test_output( exp, demo_file( "dimin.test" ), output )
+    && exp.WriteMatrices( matrix_out );
+}
+
+static int round_trip( const string& options ){
+  string base = "matrix_test." + to_string( getpid() );
+  string first = base + ".1";
+  string second = base + ".2";
+  string third = base + ".3";
+  vector<string> computed;
+  vector<string> read;
+  vector<string> read_again;
+  bool ok = learn_and_test( options, "", first, computed )
+    && learn_and_test( options, first, second, read )
+    && learn_and_test( options, second, third, read_again );
+  vector<string> first_lines = read_lines( first );
+  vector<string> second_lines = read_lines( second );
+  vector<string> third_lines = read_lines( third );
+  for ( const auto& file : { first, second, third } ){
+    remove( file.c_str() );
+  }
+  if ( !ok || first_lines.empty() ){
+    cerr << options << ": failed" << endl;
+    return 1;
+  }
+  int diffs = count_diffs( read, read_again, options + " --matrixin" )
+    + count_diffs( first_lines, second_lines, options + " --matrixout" )
+    + count_diffs( second_lines, third_lines, options + " --matrixout" );
+  if ( options.find( "-mM" ) != string::npos ){
+    vector<string> start( first_lines.begin(),
+			  first_lines.begin()
+			  + min( first_lines.size(), mvdm_start.size() ) );
+    diffs += count_diffs( mvdm_start, start, options + " matrix file" );
+  }
+  return diffs;
+}
+
+static int old_matrix(){
+  // the map based SparseSymetricMatrix is still there for other users
+  SparseSymetricMatrix<int> m;
+  m.Assign( 1, 2, 0.5 );
+  m.Assign( 3, 1, 0.25 );
+  ostringstream os;
+  os << m;
+  if ( m.Extract( 2, 1 ) != 0.5
+       || m.Extract( 1, 1 ) != 0.0
+       || os.str() != "[2,\t1] 0.5\n[3,\t1] 0.25\n" ){
+    cerr << "SparseSymetricMatrix is broken: " << os.str() << endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(){
+  int diffs = old_matrix()
+    + round_trip( "-a IB1 -k3 -mM +vdb+di" )
+    + round_trip( "-a IB1 -k1 -mJ +vdb+di" )
+    + round_trip( "-a IB1 -k3 -mS -L2 +vdb+di" );
+  if ( diffs > 0 ){
+    cerr << diffs << " lines differ after reading the matrices" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Classify instances with unseen feature values, once in file order and
+// once in reverse order, and some of them each in a fresh experiment. An
+// unseen value reuses the placeholder of the previous instance, which must
+// not leak into the answer for the next one. Neither may the partition
+// that TRIBL and TRIBL2 search for the previous instance. Numeric values
+// are parsed when the placeholder gets them, so the same holds for
+// numeric data. The distances from the query values are remembered
+// during a search, but not for the next query, nor after the metric has
+// been changed.
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static vector<string> read_lines( const string& name ){
+  vector<string> result;
+  ifstream is( name );
+  string line;
+  while ( getline( is, line ) ){
+    result.push_back( line );
+  }
+  return result;
+}
+
+static vector<string> with_unseen( const vector<string>& lines ){
+  // replace one feature of every other line by a value that is not in
+  // dimin.train. The names differ in length and letters, as they matter
+  // to the Levenshtein distance
+  vector<string> result;
+  for ( size_t n=0; n < lines.size(); ++n ){
+    string line = lines[n];
+    if ( n % 2 == 0 ){
+      size_t pos = 0;
+      for ( size_t f=0; f < (n/2) % 12; ++f ){
+	pos = line.find( ',', pos ) + 1;
+      }
+      size_t end = line.find( ',', pos );
+      line.replace( pos, end - pos,
+		    "#" + string( n % 3, static_cast<char>( 'a' + n % 5 ) ) );
+    }
+    result.push_back( line );
+  }
+  return result;
+}
+
+static void numeric_data( const string& train, vector<string>& lines ){
+  // 4 numeric features with integer values from 0 to 99. Only the test
+  // lines have fractions, or values outside that range
+  ofstream os( train );
+  unsigned int seed = 4711;
+  for ( size_t n=0; n < 2000; ++n ){
+    int sum = 0;
+    for ( size_t f=0; f < 4; ++f ){
+      seed = seed * 1103515245 + 12345;
+      int val = ( seed >> 16 ) % 100;
+      sum += val * ( f + 1 );
+      os << val << ",";
+    }
+    os << static_cast<char>( 'A' + ( sum / 50 ) % 5 ) << endl;
+  }
+  for ( size_t n=0; n < 500; ++n ){
+    string line;
+    for ( size_t f=0; f < 4; ++f ){
+      seed = seed * 1103515245 + 12345;
+      double val = ( ( seed >> 16 ) % 1400 ) / 10.0 - 20.0;
+      ostringstream ss;
+      ss << val;
+      line += ss.str() + ",";
+    }
+    lines.push_back( line + "A" );
+  }
+}
+
+static bool classify_lines( TimblAPI& exp,
+			    const vector<string>& lines,
+			    const vector<size_t>& order,
+			    vector<string>& answers ){
+  answers.resize( lines.size() );
+  for ( const auto n : order ){
+    string cls;
+    string dist;
+    double distance;
+    if ( !exp.Classify( lines[n], cls, dist, distance ) ){
+      return false;
+    }
+    ostringstream os;
+    os << cls << " " << dist << " " << setprecision(10) << distance;
+    answers[n] = os.str();
+  }
+  return true;
+}
+
+static bool classify_all( const string& options,
+			  const string& train,
+			  const vector<string>& lines,
+			  const vector<size_t>& order,
+			  vector<string>& answers ){
+  TimblAPI exp( options, "order_test" );
+  return exp.isValid()
+    && exp.Learn( train )
+    && classify_lines( exp, lines, order, answers );
+}
+
+static int compare_orders( const string& options,
+			   const string& train,
+			   const vector<string>& lines ){
+  vector<size_t> forward;
+  for ( size_t n=0; n < lines.size(); ++n ){
+    forward.push_back( n );
+  }
+  const vector<size_t> backward( forward.rbegin(), forward.rend() );
+  vector<string> expected;
+  vector<string> got;
+  if ( lines.empty()
+       || !classify_all( options, train, lines, forward, expected )
+       || !classify_all( options, train, lines, backward, got ) ){
+    cerr << options << ": failed" << endl;
+    return 1;
+  }
+  int diffs = count_diffs( expected, got, options + ", reverse order" );
+  vector<string> single;
+  vector<string> fresh;
+  for ( size_t n=0; n < lines.size(); n += 97 ){
+    vector<string> answer;
+    if ( !classify_all( options, train, lines, { n }, answer ) ){
+      cerr << options << ": failed" << endl;
+      return diffs + 1;
+    }
+    single.push_back( expected[n] );
+    fresh.push_back( answer[n] );
+  }
+  return diffs + count_diffs( single, fresh, options + ", fresh experiment" );
+}
+
+static int compare_switch( const string& options,
+			   const string& metric,
+			   const string& train,
+			   const vector<string>& lines ){
+  // classify with options, then change to metric, and classify again. That
+  // must give the answers of an experiment that used metric from the start
+  vector<size_t> forward;
+  for ( size_t n=0; n < lines.size(); ++n ){
+    forward.push_back( n );
+  }
+  vector<string> first;
+  vector<string> expected;
+  vector<string> got;
+  TimblAPI exp( options, "order_test" );
+  bool ok = exp.isValid()
+    && exp.Learn( train )
+    && classify_lines( exp, lines, forward, first )
+    && exp.SetOptions( metric )
+    && classify_lines( exp, lines, forward, got )
+    && classify_all( options + " " + metric, train, lines, forward, expected );
+  if ( !ok ){
+    cerr << options << ", then " << metric << ": failed" << endl;
+    return 1;
+  }
+  if ( first == got ){
+    cerr << options << ", then " << metric << ": nothing changed" << endl;
+    return 1;
+  }
+  return count_diffs( expected, got, options + ", then " + metric );
+}
+
+int main(){
+  const string train = demo_file( "dimin.train" );
+  const vector<string> lines
+    = with_unseen( read_lines( demo_file( "dimin.test" ) ) );
+  int diffs = compare_orders( "-a IB1 -k3 -mO", train, lines )
+    + compare_orders( "-a IB1 -k3 -mL", train, lines )
+    + compare_orders( "-a IB1 -k3 -mM", train, lines )
+    + compare_orders( "-a IB1 -k3 -mJ -L2", train, lines )
+    + compare_orders( "-a IB1 -k1 -mS", train, lines )
+    + compare_switch( "-a IB1 -k3 -mM", "-mJ", train, lines )
+    + compare_switch( "-a IB1 -k3 -mM", "-mL", train, lines )
+    + compare_switch( "-a IB1 -k3 -mL", "-mO", train, lines )
+    + compare_orders( "-a IB1 -k1 -mO", train, lines )
+    + compare_orders( "-a IGTREE", train, lines )
+    + compare_orders( "-a TRIBL -q2 -k3", train, lines )
+    + compare_orders( "-a TRIBL -q4 -k1 -mO", train, lines )
+    + compare_orders( "-a TRIBL2 -k3", train, lines )
+    + compare_orders( "-a TRIBL2 -k1 -mL", train, lines );
+  const string numeric = "order_test." + to_string( getpid() );
+  vector<string> numeric_lines;
+  numeric_data( numeric, numeric_lines );
+  diffs += compare_orders( "-a IB1 -k3 -mN", numeric, numeric_lines )
+    + compare_orders( "-a IB1 -k1 -mE", numeric, numeric_lines )
+    + compare_orders( "-a IB1 -k3 -mC", numeric, numeric_lines )
+    + compare_orders( "-a IB1 -k3 -mO:N1:N3", numeric, numeric_lines );
+  remove( numeric.c_str() );
+  if ( diffs > 0 ){
+    cerr << diffs << " instances depend on the test order" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
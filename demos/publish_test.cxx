@@ -0,0 +1,182 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Learn half of dimin.train and Publish it. Readers of that version must
+// keep giving the same answers on dimin.test, while the writer goes on
+// Incrementing, Decrementing and Publishing in parallel. A reader of the
+// last version must answer exactly like the writer itself.
+
+#include <cstdlib>
+#include <cstdio>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static const string options = "-a IB1 -mM -k3";
+
+static bool classify_all( TimblAPI& exp,
+			  const vector<string>& lines,
+			  vector<string>& answers ){
+  answers.resize( lines.size() );
+  for ( size_t n=0; n < lines.size(); ++n ){
+    string cls;
+    string dist;
+    double distance;
+    if ( !exp.Classify( lines[n], cls, dist, distance ) ){
+      return false;
+    }
+    answers[n] = cls + " " + dist + " " + to_string( distance );
+  }
+  return true;
+}
+
+int main(){
+  vector<string> train;
+  vector<string> test;
+  string line;
+  ifstream is( demo_file( "dimin.train" ) );
+  while ( getline( is, line ) ){
+    train.push_back( line );
+  }
+  ifstream ts( demo_file( "dimin.test" ) );
+  while ( getline( ts, line ) ){
+    test.push_back( line );
+  }
+  if ( train.size() < 3 || test.empty() ){
+    return EXIT_FAILURE;
+  }
+  const size_t half = train.size() / 2;
+  const string part = "publish_test." + to_string( getpid() ) + ".train";
+  {
+    ofstream os( part );
+    for ( size_t n=0; n < half; ++n ){
+      os << train[n] << endl;
+    }
+  }
+  TimblAPI writer( options, "publish_test" );
+  bool ok = writer.isValid()
+    && writer.Learn( part )
+    && writer.Publish();
+  remove( part.c_str() );
+  if ( !ok ){
+    return EXIT_FAILURE;
+  }
+  TimblAPI *first = writer.NewReader();
+  vector<string> expected;
+  if ( !first || !classify_all( *first, test, expected ) ){
+    return EXIT_FAILURE;
+  }
+  atomic<int> diffs( 0 );
+  atomic<bool> done( false );
+  vector<thread> readers;
+  for ( int t=0; t < 3; ++t ){
+    // readers that stay with the first version
+    TimblAPI *reader = writer.NewReader();
+    if ( !reader ){
+      return EXIT_FAILURE;
+    }
+    readers.emplace_back( [&,reader](){
+	do {
+	  vector<string> answers;
+	  if ( !classify_all( *reader, test, answers ) ){
+	    ++diffs;
+	    break;
+	  }
+	  diffs += count_diffs( expected, answers, "reader" );
+	} while ( !done );
+	delete reader;
+      } );
+  }
+  // and one that moves on to every new version
+  TimblAPI *mover = writer.NewReader();
+  if ( !mover ){
+    return EXIT_FAILURE;
+  }
+  readers.emplace_back( [&,mover](){
+      do {
+	mover->Refresh();
+	vector<string> answers;
+	if ( !classify_all( *mover, test, answers ) ){
+	  ++diffs;
+	  break;
+	}
+      } while ( !done );
+      delete mover;
+    } );
+  // learn the rest, and forget the first third, publishing as we go
+  for ( size_t n=half; n < train.size() && ok; ++n ){
+    ok = writer.Increment( train[n] );
+    if ( n % 100 == 0 ){
+      ok = ok && writer.Publish();
+    }
+  }
+  for ( size_t n=0; n < train.size() / 3 && ok; ++n ){
+    ok = writer.Decrement( train[n] );
+    if ( n % 100 == 0 ){
+      ok = ok && writer.Publish();
+    }
+  }
+  ok = ok && writer.Publish();
+  done = true;
+  for ( auto& r : readers ){
+    r.join();
+  }
+  if ( !ok ){
+    cerr << "the writer failed" << endl;
+    return EXIT_FAILURE;
+  }
+  vector<string> answers;
+  if ( !classify_all( *first, test, answers ) ){
+    return EXIT_FAILURE;
+  }
+  diffs += count_diffs( expected, answers, "first reader" );
+  delete first;
+  TimblAPI *last = writer.NewReader();
+  vector<string> own;
+  if ( !last
+       || !classify_all( *last, test, answers )
+       || !classify_all( writer, test, own ) ){
+    return EXIT_FAILURE;
+  }
+  diffs += count_diffs( own, answers, "last reader" );
+  delete last;
+  if ( diffs > 0 ){
+    cerr << diffs << " answers differ from the version that was read"
+	 << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
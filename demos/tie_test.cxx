@@ -0,0 +1,97 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+// Classify dimin.test with -k3 -dIL, once in file order and once in reverse
+// order. Ties are resolved with an extra neighbor, which must not leak into
+// the neighbor set of a later instance. So the answers may not depend on
+// the order in which the instances are tested.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "timbl/TimblAPI.h"
+#include "compare_runs.h"
+
+using namespace std;
+using namespace Timbl;
+
+static bool classify_all( const vector<string>& lines,
+			  bool reverse,
+			  vector<string>& answers ){
+  TimblAPI exp( "-a IB1 -k3 -dIL", "tie_test" );
+  if ( !exp.isValid() ){
+    return false;
+  }
+  exp.Learn( demo_file( "dimin.train" ) );
+  if ( !exp.isValid() ){
+    return false;
+  }
+  answers.resize( lines.size() );
+  for ( size_t i=0; i < lines.size(); ++i ){
+    size_t n = reverse ? lines.size() - 1 - i : i;
+    string cls;
+    string dist;
+    double distance;
+    if ( !exp.Classify( lines[n], cls, dist, distance ) ){
+      return false;
+    }
+    answers[n] = cls + " " + dist;
+  }
+  return true;
+}
+
+int main(){
+  ifstream is( demo_file( "dimin.test" ) );
+  vector<string> lines;
+  string line;
+  while ( getline( is, line ) ){
+    lines.push_back( line );
+  }
+  vector<string> forward;
+  vector<string> backward;
+  if ( lines.empty()
+       || !classify_all( lines, false, forward )
+       || !classify_all( lines, true, backward ) ){
+    return EXIT_FAILURE;
+  }
+  int diffs = 0;
+  for ( size_t n=0; n < lines.size(); ++n ){
+    if ( forward[n] != backward[n] ){
+      cerr << lines[n] << endl
+	   << "  forward:  " << forward[n] << endl
+	   << "  backward: " << backward[n] << endl;
+      ++diffs;
+    }
+  }
+  if ( diffs > 0 ){
+    cerr << diffs << " instances depend on the test order" << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
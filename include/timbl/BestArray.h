@@ -49,8 +49,12 @@ namespace Timbl {
     BestRec& operator=( const BestRec& ) = delete; // forbid copies
     ~BestRec();
     size_t totalBests() const { return aggregateDist.totalSize(); };
+    void mergeLeaves();
     double bestDistance;
     ClassDistribution aggregateDist;
+    // the distributions found at bestDistance, but not yet merged into
+    // aggregateDist. These are NOT owned, they point into the InstanceBase
+    std::vector<const ClassDistribution*> leaves;
     std::vector<ClassDistribution*> bestDistributions;
     std::vector<icu::UnicodeString> bestInstances;
   private:
@@ -67,11 +71,15 @@ namespace Timbl {
 	{};
     ~BestArray();
     void init( unsigned int, unsigned int, bool, bool, bool );
+    void reset(){ init( size, maxBests, _storeInstances, _showDi, _showDb ); };
+    void swap( BestArray& );
     double addResult( double,
 		      const ClassDistribution *,
 		      const icu::UnicodeString& );
-    void initNeighborSet( neighborSet& ) const;
-    void addToNeighborSet( neighborSet& , size_t ) const;
+    void mergeLeaves();
+    void initNeighborSet( neighborSet&, size_t = 0 );
+    void addToNeighborSet( neighborSet& , size_t );
+    void trim( unsigned int );
     xmlNode *toXML() const;
     nlohmann::json to_JSON() const;
     nlohmann::json record_to_json( const BestRec *, size_t ) const;
@@ -31,6 +31,8 @@
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
 #include "timbl/MsgClass.h"
 #include "timbl/Matrices.h"
 #include "ticcutils/Unicode.h"
@@ -72,6 +74,7 @@ namespace Timbl {
   class FeatureValue: public ValueClass {
     friend class Feature;
     friend class Feature_List;
+    friend class Instance;
     friend struct D_D;
   public:
     explicit FeatureValue( const icu::UnicodeString& );
@@ -83,9 +86,19 @@ namespace Timbl {
     };
     bool isUnknown() const { return _index == 0; };
     SparseValueProbClass *valueClassProb() const { return ValueClassProb; };
+    // the value of the name as a number, parsed only once.
+    bool isNumeric() const { return _is_numeric; };
+    double numericValue() const { return _numeric; };
+    // the position of the value in the values of its Feature, a dense id.
+    // values that are not seen in training have none (npos)
+    size_t valueId() const { return _value_id; };
   private:
+    void parse_numeric();
     SparseValueProbClass *ValueClassProb;
     ClassDistribution TargetDist;
+    double _numeric;
+    bool _is_numeric;
+    size_t _value_id;
   };
 
 
@@ -134,6 +147,7 @@ namespace Timbl {
     bool ArrayRead(){ return vcpb_read; };
     bool matrixPresent( bool& ) const;
     size_t matrix_byte_size() const;
+    size_t matrix_values() const;
     bool store_matrix( int = 1 );
     void clear_matrix();
     bool fill_matrix( std::istream& );
@@ -145,7 +159,8 @@ namespace Timbl {
     void NumStatistics( double, const Targets&, int, bool );
     void ClipFreq( size_t f ){ matrix_clip_freq = f; };
     size_t ClipFreq() const { return matrix_clip_freq; };
-    SparseSymetricMatrix<const ValueClass *> *metric_matrix;
+    Feature *Snapshot( Hash::UnicodeHash * );
+    SymetricMatrix<double> *metric_matrix;
   private:
     Feature( const Feature& );
     Feature& operator=( const Feature& );
@@ -181,6 +196,17 @@ namespace Timbl {
     std::vector<FeatureValue *> values_array;
     std::unordered_map< size_t, FeatureValue *> reverse_values;
     bool is_reference;
+    // A Snapshot shares the values with us, but not their statistics,
+    // which we go on changing. Those are copied, as far as they changed
+    // since the last Snapshot. On valueId()
+    using value_stats = std::vector<std::shared_ptr<const FeatureValue>>;
+    std::shared_ptr<const value_stats> published_stats; // our last Snapshot
+    std::shared_ptr<const value_stats> frozen_stats; // in a Snapshot
+    std::unordered_set<size_t> changed_values; // since the last Snapshot
+    bool shared_values; // the values are not ours to delete
+    void value_changed( const FeatureValue * );
+    const FeatureValue *frozen_value( const FeatureValue * ) const;
+    static FeatureValue *copy_stats( const FeatureValue * );
   };
 
   class Feature_List: public MsgClass {
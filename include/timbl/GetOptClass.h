@@ -42,6 +42,7 @@ namespace Timbl {
     GetOptClass& operator=( const GetOptClass& ) = delete; // forbid copies
     virtual ~GetOptClass() override;
     GetOptClass *Clone( std::ostream * = 0 ) const;
+    GetOptClass *Fresh() const;
     bool parse_options( const TiCC::CL_Options&, const int=0 );
     void set_default_options( const int=0 );
     bool definitive_options( TimblExperiment * );
@@ -76,6 +77,9 @@ namespace Timbl {
     int seed;
     int threshold;
     int igThreshold;
+    int search_budget;
+    int search_deadline;
+    int cache_size;
     VerbosityFlags myVerbosity;
     bool opt_init;
     bool opt_changed;
@@ -93,6 +97,11 @@ namespace Timbl {
     bool do_silly;
     bool do_diversify;
     bool do_prune;
+    bool do_freeze;
+    bool do_binary;
+    bool do_best_first;
+    bool do_exact_index;
+    bool do_dense;
     std::vector<MetricType>metricsArray;
     std::ostream *parent_socket_os;
     std::string inPath;
@@ -28,7 +28,10 @@
 #ifndef TIMBL_IBTREE_H
 #define TIMBL_IBTREE_H
 
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "ticcutils/XMLtools.h"
 #include "timbl/MsgClass.h"
@@ -53,6 +56,7 @@ namespace Timbl {
   class TargetValue;
   class ClassDistribution;
   class WClassDistribution;
+  class NodeArena;
 
   class IBtree {
     friend class InstanceBase_base;
@@ -64,6 +68,10 @@ namespace Timbl {
     friend std::ostream &operator<<( std::ostream&, const IBtree * );
     friend xmlNode *to_xml( IBtree *pnt );
     friend int count_next( const IBtree * );
+    friend class FrozenTree;
+    friend class DenseBase;
+    friend class NodeArena;
+    friend class ChildIndex;
   public:
     const TargetValue* targetValue() const { return TValue; };
   private:
@@ -82,33 +90,251 @@ namespace Timbl {
 		    unsigned long&,
 		    long,
 		    bool,
-		    ClassDistribution*&  );
+		    ClassDistribution*&,
+		    NodeArena&,
+		    int = 0 );
 #ifdef IBSTATS
     static inline IBtree *add_feat_val( FeatureValue *,
 					unsigned int&,
 					IBtree *&,
-					unsigned long& );
+					unsigned long&,
+					NodeArena& );
 #else
     static inline IBtree *add_feat_val( FeatureValue *,
 					IBtree *&,
-					unsigned long& );
+					unsigned long&,
+					NodeArena& );
 #endif
     inline ClassDistribution *sum_distributions( bool );
-    inline IBtree *make_unique( const TargetValue *, unsigned long& );
+    inline IBtree *make_unique( const TargetValue *,
+				unsigned long&,
+				NodeArena& );
     void cleanDistributions();
-    void re_assign_defaults( bool, bool );
-    void assign_defaults( bool, bool, size_t );
+    void drop_distribution();
+    ClassDistribution *own_distribution();
+    ClassDistribution *copy_distribution() const;
+    void re_assign_default( bool, bool, int );
+    void re_assign_defaults( bool, bool, int = 0 );
+    void assign_default( bool, bool, size_t, int );
+    void assign_defaults( bool, bool, size_t, int = 0 );
     void redo_distributions();
     void countBranches( unsigned int,
 			std::vector<unsigned int>&,
 			std::vector<unsigned int>& );
-    const ClassDistribution *exact_match( const Instance&  ) const;
-  protected:
-    const IBtree *search_node( const FeatureValue * ) const;
   };
 
   using FI_map = std::unordered_map<size_t, const IBtree*>;
 
+  class ChildIndex {
+    // An index on the sibling lists of an IBtree, for the lists that are
+    // too long for a linear scan. Every list gets its own, the first time
+    // it is searched. Like in the FrozenTree, medium sized sorted lists
+    // get a binary search, and large or unsorted ones a hash table.
+    // The nodes are not followed, so clear() it when the tree changes.
+  public:
+    static const IBtree *scan( const IBtree *, uint32_t );
+    const IBtree *search( const IBtree *, uint32_t );
+    void clear(){ lists.clear(); };
+  private:
+    struct list_index {
+      std::vector<std::pair<uint32_t, const IBtree *>> sorted;
+      FI_map hashed;
+    };
+    void index_list( const IBtree *, list_index& );
+    std::unordered_map<const IBtree *, list_index> lists; // on the first node
+  };
+
+  class PathIndex {
+    // a hash table from the fingerprint of the value ids of a full path
+    // to its leaf. The ids are kept too, so lookup() can check that a hit
+    // is the same path. When two paths share a fingerprint, the first
+    // one keeps the slot, and lookup() can't tell for the other one.
+  public:
+    explicit PathIndex( size_t d ): depth( d ) {};
+    void reserve( size_t n ){ table.reserve( n ); ids.reserve( n * depth ); };
+    size_t size() const { return table.size(); };
+    void insert( const uint32_t *, const IBtree * );
+    bool lookup( const uint32_t *, const IBtree *& ) const;
+  private:
+    struct entry {
+      const IBtree *leaf;
+      size_t pos; // where the ids of the path start
+    };
+    uint64_t fingerprint( const uint32_t * ) const;
+    bool same_path( const entry&, const uint32_t * ) const;
+    size_t depth;
+    std::unordered_map<uint64_t, entry> table;
+    std::vector<uint32_t> ids;
+  };
+
+  class FrozenTree {
+    // A read-only copy of an IBtree, meant for the testing phase.
+    // The nodes are stored breadth-first in parallel arrays, so all
+    // children of a node are contiguous: the children of node n are
+    // the nodes [offsets[n],offsets[n+1]), the top level is [0,root_count).
+    // A leaf has no children.
+    // Distributions are NOT copied. We keep those of the leafs, which are
+    // stable, and a pointer back into the IBtree for the rest.
+    // The default target of every node is copied, so an IGTree lookup
+    // never has to leave these arrays.
+    //
+    // Every sibling range gets its own search strategy, based on its size:
+    // a linear scan for small ranges, binary search over the (sorted) id's
+    // for medium ones, and a compact open-addressing hash for large or
+    // unsorted ones.
+    //
+    // Every node also gets a 64 bit Bloom filter of the (level, value id)
+    // pairs in its subtree. When the value of a test instance is not in
+    // it, no path below the node can match that value.
+    friend class InstanceBase_base;
+    friend class IB_InstanceBase;
+    friend class IG_InstanceBase;
+    friend class TRIBL_InstanceBase;
+    friend class TRIBL2_InstanceBase;
+  public:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr uint32_t LINEAR_LIMIT = 8;
+    static constexpr uint32_t HASH_LIMIT = 256;
+    explicit FrozenTree( IBtree * );
+    FrozenTree( const FrozenTree& ) = delete; // forbid copies
+    FrozenTree& operator=( const FrozenTree& ) = delete; // forbid copies
+    size_t size() const { return ids.size(); };
+    size_t NumBytes() const;
+    static uint64_t filter_bit( size_t level, uint32_t id ){
+      uint32_t h = ( id + static_cast<uint32_t>(level) * 0x9E3779B9U )
+	* 2654435761U;
+      return uint64_t(1) << ( h >> 26 ); };
+    void refresh_defaults();
+    bool replace_distribution( const Instance&, const IBtree * );
+  private:
+    struct child_hash {
+      uint32_t start; // position in hash_pool
+      uint32_t mask;  // table size - 1
+    };
+    uint32_t root_count;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> ids;
+    std::vector<FeatureValue *> values;
+    std::vector<ClassDistribution *> dists;
+    std::vector<const TargetValue *> defaults;
+    std::vector<uint64_t> below; // the Bloom filters
+    std::vector<IBtree *> nodes;
+    std::vector<bool> hashed;  // indexed on the first node of a range
+    std::unordered_map<uint32_t, child_hash> hashes;
+    std::vector<uint32_t> hash_pool;
+    bool is_leaf( uint32_t n ) const { return offsets[n] == offsets[n+1]; };
+    static uint32_t hash_slot( uint32_t id, uint32_t mask ){
+      return ( id * 2654435761U ) & mask; };
+    void index_range( uint32_t, uint32_t );
+    uint32_t search_node( uint32_t, uint32_t, uint32_t ) const;
+    const ClassDistribution *exact_match( const Instance& ) const;
+  };
+
+  class NodeArena {
+    // Storage for the nodes of an IBtree.
+    // Nodes are carved out of large slabs instead of being allocated one
+    // at a time, and they are all destroyed in one linear sweep over the
+    // slabs when the arena dies, so no recursion over the tree is needed.
+    // Nodes that are cut out of the tree (Prune, MergeSub) are recycled.
+    //
+    // After Seal() all nodes so far are shared with a published version,
+    // which refers to the same slabs (see Share()). Those nodes are never
+    // changed or recycled again, a shared slab is destroyed by the last
+    // arena that refers to it.
+  public:
+    static constexpr size_t SLAB_SIZE = 4096;
+    NodeArena(): free_list(0), sealed(false), garbage(0) {};
+    NodeArena( const NodeArena& ) = delete; // forbid copies
+    NodeArena& operator=( const NodeArena& ) = delete; // forbid copies
+    IBtree *alloc( FeatureValue * = 0 );
+    void release( IBtree * );
+    void adopt( NodeArena& );
+    void swap( NodeArena& );
+    void Seal();
+    void Share( const NodeArena& );
+    bool IsShared() const { return sealed; };
+    bool Sealed( const IBtree *node ) const {
+      return sealed && fresh.find( node ) == fresh.end(); };
+    size_t Garbage() const { return garbage; };
+    size_t NumBytes() const { return slabs.size() * SLAB_SIZE * sizeof(IBtree); };
+  private:
+    struct slab {
+      slab();
+      slab( const slab& ) = delete; // forbid copies
+      slab& operator=( const slab& ) = delete; // forbid copies
+      ~slab();
+      IBtree *nodes;
+      size_t used;
+    };
+    std::vector<std::shared_ptr<slab>> slabs;
+    IBtree *free_list;  // chained through the next pointers
+    bool sealed;
+    std::unordered_set<const IBtree *> fresh; // allocated after Seal()
+    size_t garbage; // sealed nodes that we replaced by a copy
+  };
+
+  class DistributionPool {
+    // The tails of an IBtree often have equal distributions, like { A 1 }.
+    // Those are shared, using one copy from this pool.
+    // The pool holds an owner reference on each of its distributions, so
+    // a shared one always has more then 1 owner, and nodes copy it before
+    // changing it.
+  public:
+    DistributionPool() {};
+    DistributionPool( const DistributionPool& ) = delete; // forbid copies
+    DistributionPool& operator=( const DistributionPool& ) = delete; // forbid copies
+    ~DistributionPool();
+    ClassDistribution *share( ClassDistribution * );
+    ClassDistribution *single( const TargetValue *, int );
+    void adopt( DistributionPool& );
+    size_t size() const { return pool.size(); };
+  private:
+    struct dist_hash {
+      size_t operator()( const ClassDistribution * ) const;
+    };
+    struct dist_equal {
+      bool operator()( const ClassDistribution *,
+		       const ClassDistribution * ) const;
+    };
+    std::unordered_set<ClassDistribution *, dist_hash, dist_equal> pool;
+  };
+
+  class DenseBase {
+    // A read-only copy of all full paths of an IBtree, as a matrix of
+    // numbers, for a brute force search on all numeric data.
+    // The numbers are stored per feature (column after column), so the
+    // distances of a whole range of rows are updated with one feature at a
+    // time. That loop is vectorised, and adds the per feature distances in
+    // the same order as the testers do, so the results are identical.
+    // Like in FrozenTree, the distributions are those of the leafs.
+  public:
+    DenseBase( const IBtree *, size_t );
+    DenseBase( const DenseBase& ) = delete; // forbid copies
+    DenseBase& operator=( const DenseBase& ) = delete; // forbid copies
+    size_t rows() const { return dists.size(); };
+    bool allNumeric() const { return all_numeric; };
+    size_t NumBytes() const;
+    const ClassDistribution *distribution( size_t r ) const {
+      return dists[r]; };
+    FeatureValue *value( size_t r, size_t f ) const {
+      return values[r*depth+f]; };
+    // dist[r] += fabs( (q-x)/scale ) * w;
+    void add_numeric( size_t, double, double, double, double * ) const;
+    // dist[r] += sqrt( fabs(q*q-x*x) ) / scale * w;
+    void add_euclidean( size_t, double, double, double, double * ) const;
+    // dist[r] += ( q*x ) * w;
+    void add_product( size_t, double, double, double * ) const;
+    // dist[r] += ( x*x ) * w;
+    void add_square( size_t, double, double * ) const;
+  private:
+    size_t depth;
+    bool all_numeric;
+    std::vector<double> matrix; // the rows() values of feature f start at f*rows()
+    std::vector<FeatureValue *> values; // the paths, row after row
+    std::vector<const ClassDistribution *> dists;
+    void add_rows( const IBtree *, size_t, std::vector<FeatureValue *>& );
+  };
+
   class InstanceBase_base: public MsgClass {
     friend class IG_InstanceBase;
     friend class TRIBL_InstanceBase;
@@ -129,9 +355,15 @@ namespace Timbl {
 			 std::vector<unsigned int>& );
     virtual bool MergeSub( InstanceBase_base * );
     const ClassDistribution *ExactMatch( const Instance& I ) const {
-      return InstBase->exact_match( I ); };
+      if ( ExactIndex ){
+	return indexed_match( I );
+      }
+      if ( FrozenBase ){
+	return FrozenBase->exact_match( I );
+      }
+      return linked_match( I ); };
     virtual const ClassDistribution *InitGraphTest( std::vector<FeatureValue *>&,
-						    const std::vector<FeatureValue *> *,
+						    const Instance *,
 						    const size_t,
 						    const size_t );
     virtual const ClassDistribution *NextGraphTest( std::vector<FeatureValue *>&,
@@ -151,12 +383,19 @@ namespace Timbl {
 		    Hash::UnicodeHash& ) const;
     virtual InstanceBase_base *Copy() const = 0;
     virtual InstanceBase_base *clone() const = 0;
+    virtual InstanceBase_base *clone( unsigned long int& ) const = 0;
     void Save( std::ostream&,
 	       bool=false );
     void Save( std::ostream&,
 	       const Hash::UnicodeHash&,
 	       const Hash::UnicodeHash&,
 	       bool=false );
+    void SaveBinary( std::ostream&,
+		     const Hash::UnicodeHash&,
+		     const Hash::UnicodeHash&,
+		     const Feature_List&,
+		     bool=false );
+    static constexpr int BinaryVersion = 5;
     void toXML( std::ostream& );
     void printStatsTree( std::ostream&, unsigned int startLevel );
     virtual bool ReadIB( std::istream&,
@@ -171,13 +410,36 @@ namespace Timbl {
     bool IsPruned() const { return Pruned; };
     void CleanPartition(  bool );
     unsigned long int GetSizeInfo( unsigned long int&, double & ) const;
+    unsigned long int SharedBytes() const;
     const ClassDistribution *TopDist() const { return TopDistribution; };
     bool HasDistributions() const;
     const TargetValue *TopTarget( bool & );
     bool PersistentD() const { return PersistentDistributions; };
+    int Threads() const { return NumThreads; };
+    void Threads( int n ) { NumThreads = n; };
     unsigned long int nodeCount() const { return ibCount;} ;
     size_t depth() const { return Depth;} ;
     const IBtree *instBase() const { return InstBase; };
+    bool Freeze();
+    void Thaw();
+    bool IsFrozen() const { return FrozenBase != 0; };
+    const FrozenTree *frozenBase() const { return FrozenBase; };
+    bool MakeDense();
+    bool IsDense() const { return DenseRows != 0; };
+    const DenseBase *denseBase() const { return DenseRows; };
+    InstanceBase_base *Share( unsigned long int& );
+    bool IsShared() const { return Arena.IsShared(); };
+    bool IndexExact();
+    bool IsExactIndexed() const { return ExactIndex != 0; };
+    size_t exactIndexSize() const {
+      return ExactIndex ? ExactIndex->size() : 0; };
+    void BestFirst( const std::vector<const Feature *> *, int );
+    bool sortedLevel( size_t l ) const {
+      return l < SortedLevel.size() && SortedLevel[l]; };
+    // during a test on a frozen InstanceBase: per level the Bloom filter
+    // of the subtree of the current node, and the bit of the test value
+    virtual const std::vector<uint64_t> *subtreeFilters() const { return 0; };
+    virtual const std::vector<uint64_t> *queryFilters() const { return 0; };
 
 #ifdef IBSTATS
     std::vector<unsigned int> mismatch;
@@ -192,17 +454,37 @@ namespace Timbl {
     ClassDistribution *TopDistribution;
     WClassDistribution *WTop;
     const TargetValue *TopT;
-    FI_map fast_index;
+    mutable ChildIndex Children; // not used for a partition
     bool tiedTop;
     IBtree *InstBase;
     IBtree *LastInstBasePos;
+    FrozenTree *FrozenBase;
+    DenseBase *DenseRows;
+    PathIndex *ExactIndex; // every full path, to its leaf
+    NodeArena Arena;
+    DistributionPool Pool;
     std::vector<const IBtree *> RestartSearch;
     std::vector<const IBtree *> SkipSearch;
     std::vector<const IBtree *> InstPath;
+    IB_InstanceBase *PartitionView;
+    bool IsPartition;
+    // for best-first testing: the features (in permuted order) on which
+    // the siblings are visited nearest first, and the mvd limit to use
+    const std::vector<const Feature *> *SortFeatures;
+    int SortLimit;
+    std::vector<char> SortedLevel;
     unsigned long int& ibCount;
 
     size_t Depth;
     unsigned long int NumOfTails;
+    int NumThreads;
+    int spawn_levels() const;
+    unsigned long int distribution_bytes( unsigned long int& ) const;
+    void distribution_copied( const Instance&, const IBtree * );
+    IBtree *copy_node( IBtree * );
+    IBtree *copy_tree( const IBtree * );
+    void unshare_path( const Instance& );
+    void Unshare();
     IBtree *read_list( std::istream&,
 		       Feature_List&,
 		       Targets&,
@@ -229,8 +511,14 @@ namespace Timbl {
 			 Feature_List& ,
 			 Targets&,
 			 int );
-    void fill_index();
-    const IBtree *fast_search_node( const FeatureValue * );
+    bool read_IB_binary( std::istream&,
+			 Feature_List& ,
+			 Targets& );
+    void fill_exact_index( const IBtree *, std::vector<uint32_t>& );
+    const ClassDistribution *indexed_match( const Instance& ) const;
+    const ClassDistribution *linked_match( const Instance& ) const;
+    IB_InstanceBase *IBPartition( IBtree * );
+    const IBtree *search_node( const IBtree *, uint32_t ) const;
   };
 
   class IB_InstanceBase: public InstanceBase_base {
@@ -242,20 +530,50 @@ namespace Timbl {
       offSet(0),
       effFeat(0),
       testInst(0)
-	{};
+	{
+	  FrozenPath.resize( size, FrozenTree::NO_NODE );
+	  FrozenRestart.resize( size, FrozenTree::NO_NODE );
+	  FrozenSkip.resize( size, FrozenTree::NO_NODE );
+	  FrozenEnd.resize( size, FrozenTree::NO_NODE );
+	  FrozenBelow.resize( size, 0 );
+	  FrozenWant.resize( size, 0 );
+	  SortedNodes.resize( size );
+	  SortedFrozen.resize( size );
+	  SortPos.resize( size, 0 );
+	};
     IB_InstanceBase *Copy() const override;
     IB_InstanceBase *clone() const override;
+    IB_InstanceBase *clone( unsigned long int& ) const override;
     void Prune( const TargetValue *, bool=false, long = 0 ) override;
     const ClassDistribution *InitGraphTest( std::vector<FeatureValue *>&,
-					    const std::vector<FeatureValue *> *,
+					    const Instance *,
 					    const size_t,
 					    const size_t ) override;
     const ClassDistribution *NextGraphTest( std::vector<FeatureValue *>&,
 					    size_t& ) override;
+    const std::vector<uint64_t> *subtreeFilters() const override {
+      return FrozenBase ? &FrozenBelow : 0; };
+    const std::vector<uint64_t> *queryFilters() const override {
+      return FrozenBase ? &FrozenWant : 0; };
   private:
+    const ClassDistribution *InitFrozenTest( std::vector<FeatureValue *>& );
+    const ClassDistribution *NextFrozenTest( std::vector<FeatureValue *>&,
+					     size_t& );
+    const IBtree *sort_siblings( size_t, const IBtree * );
+    uint32_t sort_frozen( size_t, uint32_t, uint32_t );
     size_t offSet;
     size_t effFeat;
-    const std::vector<FeatureValue *> *testInst;
+    const Instance *testInst;
+    std::vector<uint32_t> FrozenPath;
+    std::vector<uint32_t> FrozenRestart;
+    std::vector<uint32_t> FrozenSkip;
+    std::vector<uint32_t> FrozenEnd;
+    std::vector<uint64_t> FrozenBelow; // the filter of FrozenPath[i]
+    std::vector<uint64_t> FrozenWant;  // the filter bit of the test value
+    // the siblings of every sorted level, nearest first
+    std::vector<std::vector<std::pair<double,const IBtree *>>> SortedNodes;
+    std::vector<std::vector<std::pair<double,uint32_t>>> SortedFrozen;
+    std::vector<size_t> SortPos;
   };
 
   class IG_InstanceBase: public InstanceBase_base {
@@ -264,6 +582,7 @@ namespace Timbl {
 		     bool rand, bool pruned, bool keep_dists ):
       InstanceBase_base( size, cnt, rand, keep_dists ) { Pruned = pruned; };
     IG_InstanceBase *clone() const override;
+    IG_InstanceBase *clone( unsigned long int& ) const override;
     IG_InstanceBase *Copy() const override;
     void Prune( const TargetValue *, bool = false, long = 0 ) override;
     void specialPrune( const TargetValue * );
@@ -288,6 +607,7 @@ namespace Timbl {
 			bool rand, bool keep_dists ):
       InstanceBase_base( size, cnt, rand, keep_dists ), Threshold(0) {};
     TRIBL_InstanceBase *clone() const override;
+    TRIBL_InstanceBase *clone( unsigned long int& ) const override;
     TRIBL_InstanceBase *Copy() const override;
     IB_InstanceBase *TRIBL_test( const Instance&,
 				 size_t,
@@ -295,7 +615,6 @@ namespace Timbl {
 				 const ClassDistribution *&,
 				 size_t& ) override;
   private:
-    IB_InstanceBase *IBPartition( IBtree * ) const;
     void AssignDefaults( size_t );
     size_t Threshold;
   };
@@ -307,12 +626,11 @@ namespace Timbl {
       InstanceBase_base( size, cnt, rand, keep_dists ) {
     };
     TRIBL2_InstanceBase *clone() const override;
+    TRIBL2_InstanceBase *clone( unsigned long int& ) const override;
     TRIBL2_InstanceBase *Copy() const override;
     IB_InstanceBase *TRIBL2_test( const Instance& ,
 				  const ClassDistribution *&,
 				  size_t& ) override;
-  private:
-    IB_InstanceBase *IBPartition( IBtree * ) const;
   };
 
 }
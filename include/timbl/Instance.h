@@ -57,11 +57,21 @@ namespace Timbl {
     int Occurrences() const { return occ; };
     void Occurrences( const int o ) { occ = o; };
     size_t size() const { return FV.size(); };
+    void setValue( size_t i, FeatureValue *fv ){
+      FV[i] = fv;
+      VI[i] = fv ? static_cast<uint32_t>( fv->Index() ) : UnknownId;
+    };
+    void setUnknown( size_t, const icu::UnicodeString& );
+    void swap( Instance& );
+    static constexpr uint32_t UnknownId = 0;
     std::vector<FeatureValue *> FV;
+    std::vector<uint32_t> VI; // the Index() of every FV, or UnknownId
     TargetValue *TV;
   private:
     double sample_weight; // relative weight
     int occ;
+    std::vector<FeatureValue *> unknowns; // reusable dummies for unseen values
+    std::vector<icu::UnicodeString> unknown_names; // and their names
   };
 
 }
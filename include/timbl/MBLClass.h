@@ -28,6 +28,8 @@
 #ifndef TIMBL_MBLCLASS_H
 #define TIMBL_MBLCLASS_H
 
+#include <chrono>
+#include <memory>
 #include "timbl/Instance.h"
 #include "timbl/BestArray.h"
 #include "timbl/neighborSet.h"
@@ -43,6 +45,7 @@ namespace Timbl {
   using namespace Common;
 
   class InstanceBase_base;
+  class DenseBase;
   class TesterClass;
   class Chopper;
   class neighborSet;
@@ -98,6 +101,9 @@ namespace Timbl {
     virtual ~MBLClass() override;
     void Initialize( size_t );
     bool PutInstanceBase( std::ostream& ) const;
+    void snapshot_from( MBLClass& );
+    void hand_over_values( std::vector<ValueClass *>&,
+			   std::vector<Hash::UnicodeHash *>& );
     VerbosityFlags get_verbosity() const { return verbosity; };
     void set_verbosity( VerbosityFlags v ) { verbosity = v; };
     const Instance *chopped_to_instance( PhaseValue );
@@ -116,6 +122,9 @@ namespace Timbl {
     void TestInstance( const Instance& ,
 		       InstanceBase_base * = NULL,
 		       size_t = 0 );
+    bool TestInstances( const std::vector<Instance *>&,
+			InstanceBase_base *,
+			const std::vector<BestArray *>& );
     icu::UnicodeString get_org_input( ) const;
     const ClassDistribution *ExactMatch( const Instance& ) const;
     void fillNeighborSet( neighborSet& ) const;
@@ -195,15 +204,31 @@ namespace Timbl {
     MetricType globalMetricOption;
     bool do_diversify;
     bool do_prune;
+    bool do_freeze;
+    bool do_best_first;
+    bool do_exact_index;
+    bool do_dense;
+    size_t search_budget;
+    size_t search_deadline;
+    size_t result_cache_size;
+    bool search_cut_off;
+    size_t node_visits; // the nodes tested by the searches since the last count
     bool initProbabilityArrays( bool );
     void calculatePrestored();
     void initDecay();
     void initTesters();
+    bool dense_searchable() const;
     Chopper *ChopInput;
     int F_length;
   private:
     size_t MaxFeatures;
     std::vector<MetricType> UserOptions;
+    std::vector<const Feature *> sorted_features; // for best-first testing
+    bool out_of_budget( size_t,
+			const std::chrono::steady_clock::time_point& ) const;
+    bool dense_ok; // the current settings allow a search of a DenseBase
+    std::vector<double> dense_dist; // scratch space for that search
+    std::vector<double> dense_norm; // idem
     InputFormatType input_format;
     VerbosityFlags verbosity;
     size_t target_pos;
@@ -213,16 +238,23 @@ namespace Timbl {
     size_t tribl_offset;
     unsigned igThreshold;
     int mvd_threshold;
+    double prestore_secs; // the time the last calculatePrestored() took
+    int prestore_threads; // and the number of threads it used
     bool do_sloppy_loo;
     bool do_exact_match;
     bool do_silly_testing;
     bool hashed_trees;
+    bool binary_trees;
     bool need_all_weights;
     bool do_sample_weighting;
     bool do_ignore_samples;
     bool no_samples_test;
     bool keep_distributions;
     double DBEntropy;
+    // the hashes of the last version published from this experiment, or
+    // for a version: its own hashes
+    std::shared_ptr<Hash::UnicodeHash> feature_hash_copy;
+    std::shared_ptr<Hash::UnicodeHash> target_hash_copy;
     TesterClass *tester;
     int doOcc;
     bool chopExamples() const {
@@ -254,6 +286,15 @@ namespace Timbl {
     void test_instance_ex( const Instance&,
 			   InstanceBase_base * = NULL,
 			   size_t = 0 );
+    bool test_instance_dense( const Instance&,
+			      const DenseBase * );
+    void test_instances( const std::vector<Instance *>&,
+			 InstanceBase_base *,
+			 const std::vector<BestArray *>& );
+    double seed_threshold( const Instance&,
+			   InstanceBase_base *,
+			   TesterClass *,
+			   BestArray& );
 
     bool allocate_arrays();
 
@@ -0,0 +1,66 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+#ifndef TIMBL_MAPPEDFILE_H
+#define TIMBL_MAPPEDFILE_H
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace Timbl {
+
+  class MappedFile: public std::streambuf {
+    // A read-only view on a complete file, mmap-ed when the system allows.
+    // It can serve as the streambuf of an istream, so the text formats
+    // are read from it as usual, while binary readers can access the
+    // bytes at the current read position directly.
+  public:
+    explicit MappedFile( const std::string& );
+    MappedFile( const MappedFile& ) = delete; // forbid copies
+    MappedFile& operator=( const MappedFile& ) = delete; // forbid copies
+    ~MappedFile() override;
+    bool is_open() const { return opened; };
+    bool is_mapped() const { return map_base != 0; };
+    const char *data() const { return eback(); };
+    size_t size() const { return egptr() - eback(); };
+    const char *current() const { return gptr(); };
+    size_t remaining() const { return egptr() - gptr(); };
+  protected:
+    pos_type seekoff( off_type,
+		      std::ios_base::seekdir,
+		      std::ios_base::openmode ) override;
+    pos_type seekpos( pos_type, std::ios_base::openmode ) override;
+  private:
+    bool opened;
+    void *map_base;
+    size_t map_length;
+    std::vector<char> buffer; // used when mmap is not possible
+  };
+
+}
+#endif // TIMBL_MAPPEDFILE_H
@@ -29,12 +29,79 @@
 #ifndef TIMBL_MATRICES_H
 #define TIMBL_MATRICES_H
 
+#include <vector>
+#include <map>
+#include <limits>
+#include <utility>
+#include <ostream>
+
+template <class T>
+class SymetricMatrix {
+  // A symmetric matrix with an empty diagonal, for the dense id's of a set
+  // of values. Only the values that get a row in Init() are stored, as a
+  // packed lower triangle: row r holds the cells (r,0) ... (r,r-1).
+  // Cells of other values are 0.
+ public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+  SymetricMatrix(): dim( 0 ) {};
+  void Clear() { rows.clear(); cells.clear(); dim = 0; };
+  void Init( const std::vector<bool>& use ){
+    // value id i gets a row when use[i] is true
+    rows.assign( use.size(), npos );
+    dim = 0;
+    for ( size_t i=0; i < use.size(); ++i ){
+      if ( use[i] ){
+	rows[i] = dim++;
+      }
+    }
+    cells.assign( dim > 0 ? dim*(dim-1)/2 : 0, T(0) );
+  };
+  bool Has( size_t i ) const {
+    return i < rows.size() && rows[i] != npos;
+  };
+  size_t Dimension() const { return dim; };
+  void Assign( size_t i, size_t j, T d ){
+    size_t c = cell( i, j );
+    if ( c != npos ){
+      cells[c] = d;
+    }
+  };
+  T Extract( size_t i, size_t j ) const {
+    size_t c = cell( i, j );
+    if ( c == npos ){
+      return T(0);
+    }
+    return cells[c];
+  };
+  size_t NumBytes() const {
+    return sizeof(*this) + rows.size() * sizeof(size_t)
+      + cells.size() * sizeof(T);
+  };
+ private:
+  size_t cell( size_t i, size_t j ) const {
+    if ( i == j || !Has( i ) || !Has( j ) ){
+      return npos;
+    }
+    size_t r1 = rows[i];
+    size_t r2 = rows[j];
+    if ( r1 < r2 ){
+      std::swap( r1, r2 );
+    }
+    return r1*(r1-1)/2 + r2;
+  };
+  size_t dim;
+  std::vector<size_t> rows; // the row of every value id, or npos
+  std::vector<T> cells;
+};
+
 template <class T>  class SparseSymetricMatrix;
 template <class T> std::ostream& operator << (std::ostream&,
 					      const SparseSymetricMatrix<T>& );
 
 template <class Class>
 class SparseSymetricMatrix {
+  // The map based predecessor of SymetricMatrix. Timbl doesn't use it
+  // anymore, it is kept for code that includes this header
   using CDmap = std::map< Class, double >;
   using CCDmap = std::map< Class, CDmap >;
   friend std::ostream& operator << <> ( std::ostream&,
@@ -49,15 +49,17 @@ namespace Timbl {
   class StatisticsClass {
   public:
   StatisticsClass(): _data(0), _skipped(0), _correct(0),
-      _tieOk(0), _tieFalse(0), _exact(0) {};
+      _tieOk(0), _tieFalse(0), _exact(0), _approx(0), _visits(0) {};
     void clear() { _data =0; _skipped = 0; _correct = 0;
-      _tieOk = 0; _tieFalse = 0; _exact = 0; };
+      _tieOk = 0; _tieFalse = 0; _exact = 0; _approx = 0; _visits = 0; };
     void addLine() { ++_data; }
     void addSkipped() { ++_skipped; }
     void addCorrect() { ++_correct; }
     void addTieCorrect() { ++_tieOk; }
     void addTieFailure() { ++_tieFalse; }
     void addExact() { ++_exact; }
+    void addApproximate() { ++_approx; }
+    void addVisits( size_t n ) { _visits += n; }
     unsigned int dataLines() const { return _data; };
     unsigned int skippedLines() const { return _skipped; };
     unsigned int totalLines() const { return _data + _skipped; };
@@ -65,6 +67,8 @@ namespace Timbl {
     unsigned int tiedCorrect() const { return _tieOk; };
     unsigned int tiedFailure() const { return _tieFalse; };
     unsigned int exactMatches() const { return _exact; };
+    unsigned int approximateResults() const { return _approx; };
+    size_t visitedNodes() const { return _visits; };
     void merge( const StatisticsClass& );
   private:
     unsigned int _data;
@@ -73,6 +77,8 @@ namespace Timbl {
     unsigned int _tieOk;
     unsigned int _tieFalse;
     unsigned int _exact;
+    unsigned int _approx;
+    size_t _visits;
   };
 
 }
@@ -30,7 +30,9 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <unordered_map>
+#include <cstdint>
 #include "unicode/unistr.h"
 #include "timbl/MsgClass.h"
 #include "ticcutils/Unicode.h"
@@ -44,7 +46,7 @@ namespace Timbl {
   class ValueClass {
   public:
     ValueClass( const icu::UnicodeString& n, size_t i ):
-      _name( n ), _index( i ), _frequency( 1 ) {};
+      _name( &n ), _index( i ), _frequency( 1 ) {};
     ValueClass( const ValueClass& ) = delete; // forbid copies
     ValueClass& operator=( const ValueClass& ) = delete; // forbid copies
     virtual ~ValueClass() {};
@@ -54,15 +56,15 @@ namespace Timbl {
     void incr_val_freq(){ ++_frequency; };
     void decr_val_freq(){ --_frequency; };
     size_t Index() const { return _index; };
-    const icu::UnicodeString& name() const { return _name; };
-    const std::string name_string() const { return TiCC::UnicodeToUTF8(_name);};
+    const icu::UnicodeString& name() const { return *_name; };
+    const std::string name_string() const { return TiCC::UnicodeToUTF8(*_name);};
     // temporary for backward compatability
-    const icu::UnicodeString& name_u() const { return _name; }; // HACK
-    const std::string Name() const { return TiCC::UnicodeToUTF8(_name); }; // HACK
+    const icu::UnicodeString& name_u() const { return *_name; }; // HACK
+    const std::string Name() const { return TiCC::UnicodeToUTF8(*_name); }; // HACK
     // REMOVE ^^^^
     friend std::ostream& operator<<( std::ostream& os, ValueClass const *vc );
   protected:
-    const icu::UnicodeString& _name;
+    const icu::UnicodeString *_name;
     size_t _index;
     size_t _frequency;
   };
@@ -91,6 +93,8 @@ namespace Timbl {
     bool decrement_value( TargetValue * );
     bool increment_value( TargetValue * );
     TargetValue *MajorityClass() const;
+    size_t Frequency( const TargetValue * ) const;
+    void Snapshot( const Targets&, Hash::UnicodeHash * );
     size_t EffectiveValues() const;
     size_t TotalValues() const;
     size_t num_of_values() const { return values_array.size(); };
@@ -99,6 +103,8 @@ namespace Timbl {
     Hash::UnicodeHash *target_hash;
     std::vector<TargetValue *> values_array;
     std::unordered_map< size_t, TargetValue *> reverse_values;
+    // in a Snapshot: the frequencies of the values at that time, on Index()
+    std::shared_ptr<const std::vector<size_t>> frozen_freqs;
     bool is_reference;
   };
 
@@ -136,6 +142,49 @@ namespace Timbl {
   private:
   };
 
+  class VfieldList {
+    // The sorted list of Vfields of a ClassDistribution.
+    // Most distributions hold only one or two targets. Up to INLINE_SIZE
+    // Vfields are stored inside the object itself; only larger lists
+    // are moved to the heap. Vfields are trivially copyable, so they are
+    // moved around with memmove.
+  public:
+    using iterator = Vfield *;
+    using const_iterator = const Vfield *;
+    static constexpr uint32_t INLINE_SIZE = 2;
+    VfieldList(): _size(0), _cap(INLINE_SIZE) {};
+    VfieldList( const VfieldList& );
+    VfieldList& operator=( const VfieldList& );
+    ~VfieldList();
+    size_t size() const { return _size; };
+    size_t capacity() const { return _cap; };
+    bool empty() const { return _size == 0; };
+    void clear() { _size = 0; };
+    iterator begin() { return data(); };
+    iterator end() { return data() + _size; };
+    const_iterator begin() const { return data(); };
+    const_iterator end() const { return data() + _size; };
+    Vfield& operator[]( size_t i ) { return data()[i]; };
+    const Vfield& operator[]( size_t i ) const { return data()[i]; };
+    Vfield& back() { return data()[_size-1]; };
+    const Vfield& back() const { return data()[_size-1]; };
+    void reserve( size_t );
+    iterator insert( iterator, const Vfield& );
+    void emplace_back( const TargetValue *val, size_t freq, double w ){
+      insert( end(), Vfield( val, freq, w ) ); };
+  private:
+    bool is_inline() const { return _cap == INLINE_SIZE; };
+    Vfield *data() { return is_inline() ? reinterpret_cast<Vfield *>( buf ) : heap; };
+    const Vfield *data() const {
+      return is_inline() ? reinterpret_cast<const Vfield *>( buf ) : heap; };
+    uint32_t _size;
+    uint32_t _cap;
+    union {
+      Vfield *heap;
+      alignas(Vfield) unsigned char buf[INLINE_SIZE * sizeof(Vfield)];
+    };
+  };
+
   class WClassDistribution;
 
   class ClassDistribution{
@@ -143,16 +192,17 @@ namespace Timbl {
     friend std::ostream& operator<<( std::ostream&, const ClassDistribution * );
     friend class WClassDistribution;
   public:
-    // The distribution is stored as a flat vector of Vfield values, kept
+    // The distribution is stored as a flat list of Vfield values, kept
     // sorted by value->Index(). Compared to the former
     // std::map<size_t,Vfield*> this removes, per target class, one heap
     // allocation and the red-black-tree node overhead -- a large memory win
     // since there is (potentially) one distribution per instance-base node.
+    // Small lists don't use the heap at all, see VfieldList.
     // Lookups are a binary search; the sorted invariant also keeps
     // (de)serialisation order stable.
-    using VDlist = std::vector<Vfield>;
+    using VDlist = VfieldList;
     using dist_iterator = VDlist::const_iterator;
-    ClassDistribution( ): total_items(0) {};
+    ClassDistribution( ): total_items(0), owners(0) {};
     ClassDistribution( const ClassDistribution& );
     virtual ~ClassDistribution(){ clear(); };
     size_t totalSize() const{ return total_items; };
@@ -161,7 +211,8 @@ namespace Timbl {
     void clear();
     dist_iterator begin() const { return distribution.begin(); };
     dist_iterator end() const { return distribution.end(); };
-    virtual const TargetValue* BestTarget( bool&, bool = false ) const;
+    virtual const TargetValue* BestTarget( bool&, bool = false,
+					   const Targets * = 0 ) const;
     void Merge( const ClassDistribution& );
     virtual void SetFreq( const TargetValue *, int, double=1.0 );
     virtual bool IncFreq( const TargetValue *, size_t, double=1.0 );
@@ -181,6 +232,16 @@ namespace Timbl {
     double Entropy() const;
     ClassDistribution *to_VD_Copy( ) const;
     virtual WClassDistribution *to_WVD_Copy() const;
+    ClassDistribution *Copy() const;
+    // Equal tail distributions of an IBtree may be shared by several nodes
+    // (see DistributionPool). A shared distribution counts its owners and
+    // must not be modified.
+    unsigned int Owners() const;
+    void AddOwner();
+    bool DropOwner();
+    size_t HashValue() const;
+    bool Equals( const ClassDistribution& ) const;
+    size_t NumBytes() const;
   protected:
     virtual void DistToString( std::string&, double=0 ) const;
     virtual void DistToStringWW( std::string&, int ) const;
@@ -195,12 +256,14 @@ namespace Timbl {
     VDlist::iterator lower_index( size_t id );
     size_t total_items;
     VDlist distribution;
+    unsigned int owners; // 0 means: only 1 owner, never shared
   };
 
   class WClassDistribution: public ClassDistribution {
   public:
     WClassDistribution(): ClassDistribution() {};
-    const TargetValue* BestTarget( bool &, bool = false ) const override;
+    const TargetValue* BestTarget( bool &, bool = false,
+				   const Targets * = 0 ) const override;
     void SetFreq( const TargetValue *, int, double ) override;
     bool IncFreq( const TargetValue *, size_t, double ) override;
     WClassDistribution *to_WVD_Copy( ) const override;
@@ -64,11 +64,15 @@ namespace Timbl{
     TesterClass( const TesterClass& ) = delete; // inhibit copies
     TesterClass& operator=( const TesterClass& ) = delete; // inhibit copies
     virtual ~TesterClass(){};
-    void init( const Instance&, size_t, size_t );
+    virtual void init( const Instance&, size_t, size_t );
     virtual size_t test( const std::vector<FeatureValue *>&,
 			 size_t,
 			 double ) = 0;
     virtual double getDistance( size_t ) const = 0;
+    void setFilters( const std::vector<uint64_t> *b,
+		     const std::vector<uint64_t> *q ){
+      below_filters = b; query_filters = q; };
+    size_t Visits() const { return visits; };
   protected:
     size_t _size;
     size_t effSize;
@@ -78,6 +82,10 @@ namespace Timbl{
     const std::vector<size_t> &permutation;
     std::vector<Feature *> permFeatures;
     std::vector<double> distances;
+    // see InstanceBase_base::subtreeFilters(). Only set for one search
+    const std::vector<uint64_t> *below_filters;
+    const std::vector<uint64_t> *query_filters;
+    size_t visits; // the number of nodes tested since init()
   private:
   };
 
@@ -86,11 +94,14 @@ namespace Timbl{
     DistanceTester( const Feature_List&,
 		    int );
     ~DistanceTester() override;
+    void init( const Instance&, size_t, size_t ) override;
     double getDistance( size_t ) const override;
     size_t test( const std::vector<FeatureValue *>&,
 		 size_t,
 		 double ) override;
   private:
+    double lower_bound( const Instance&, size_t ) const;
+    int mvdThreshold;
     std::vector<metricTestFunction*> metricTest;
     // Per-feature test info precomputed once, in permuted order, so the inner
     // test loop avoids the permutation indirection and, for plain Overlap
@@ -99,6 +110,28 @@ namespace Timbl{
     // (F==G ? 0 : weight).
     std::vector<metricTestFunction*> permTest; // metricTest in permuted order
     std::vector<char> isOverlap;               // 1 if feature uses Overlap
+    // remaining[i] is a lower bound for the distance contributed by the
+    // features i..effSize-1 of the current instance, whatever values the
+    // instance base holds for them. It is > 0 only for values that were
+    // never seen in training.
+    std::vector<double> remaining;
+    // absent[i] is what feature i adds when the value of the instance is
+    // not in a subtree: the weight for a known value under Overlap, 0
+    // otherwise. absent_rest[i] is the sum for i..effSize-1
+    std::vector<double> absent;
+    std::vector<double> absent_rest;
+    bool beyond_subtree( size_t, double ) const;
+    // per feature with a storable metric, the weighted distance of the
+    // value of the current instance to every value id. A cell is computed
+    // when it is first needed, and valid when its stamp equals stamp.
+    struct distTable {
+      std::vector<double> dist;
+      std::vector<unsigned int> valid;
+    };
+    std::vector<distTable> tables;     // in permuted order
+    std::vector<char> hasTable;        // 1 if the feature uses a table
+    unsigned int stamp;                // one per init()
+    double table_distance( size_t, const FeatureValue * );
   };
 
   class SimilarityTester: public TesterClass {
@@ -75,6 +75,9 @@ namespace Timbl{
     bool Increment( const std::string& );
     bool Decrement_u( const icu::UnicodeString& );
     bool Decrement( const std::string& );
+    bool Publish();
+    TimblAPI *NewReader() const;
+    bool Refresh();
     bool Expand( const std::string& );
     bool Remove( const std::string& );
     bool Prune( bool = false );
@@ -119,6 +122,8 @@ namespace Timbl{
 		   double& );
     bool Classify( const icu::UnicodeString&,
 		   icu::UnicodeString& );
+    bool Classify( const std::vector<std::string>&,
+		   std::vector<std::string>& );
     bool ShowBestNeighbors( std::ostream& ) const;
     size_t matchDepth() const;
     double confidence() const;
@@ -33,6 +33,9 @@
 #include <iosfwd>
 #include <fstream>
 #include <set>
+#include <list>
+#include <unordered_map>
+#include <memory>
 #include "ticcutils/XMLtools.h"
 #include "timbl/Statistics.h"
 #include "timbl/MsgClass.h"
@@ -110,6 +113,44 @@ namespace Timbl {
     std::string resultCache;
   };
 
+  class resultLRU {
+    // A bounded cache of classification results, keyed on the value ids
+    // of a test instance. When it is full, the least recently used result
+    // is dropped.
+  public:
+    struct entry {
+      std::string key;
+      const TargetValue *target;
+      WClassDistribution *dist;
+      double distance;
+      bool exact;
+      bool tie;
+    };
+    explicit resultLRU( size_t n ): capacity(n), hits(0), misses(0) {};
+    resultLRU( const resultLRU& ) = delete; // inhibit copies
+    resultLRU& operator=( const resultLRU& ) = delete; // inhibit copies
+    ~resultLRU() { clear(); };
+    const entry *find( const std::string& );
+    void store( const std::string&,
+		const TargetValue *,
+		const ClassDistribution *,
+		double,
+		bool,
+		bool );
+    void clear();
+    void merge_stats( const resultLRU& );
+    size_t size() const { return entries.size(); };
+    size_t Hits() const { return hits; };
+    size_t Misses() const { return misses; };
+    size_t NumBytes() const;
+  private:
+    size_t capacity;
+    size_t hits;
+    size_t misses;
+    std::list<entry> entries; // most recently used first
+    std::unordered_map<std::string, std::list<entry>::iterator> index;
+  };
+
   class fCmp {
   public:
     bool operator()( const FeatureValue* F, const FeatureValue* G ) const{
@@ -123,6 +164,7 @@ namespace Timbl {
   std::ostream& operator<< ( std::ostream&, const fileDoubleIndex& );
 
   class threadData;
+  class SnapshotChannel;
 
   class TimblExperiment: public MBLClass {
     friend class TimblAPI;
@@ -162,6 +204,10 @@ namespace Timbl {
     void setOutPath( const std::string& s ){ outPath = s; };
     TimblExperiment *CreateClient( int  ) const;
     TimblExperiment *splitChild() const;
+    bool Publish();
+    TimblExperiment *NewReader() const;
+    bool isReader() const { return snapshot != nullptr; };
+    bool Outdated() const;
     bool SetOptions( int, const char *[] );
     bool SetOptions( const std::string& );
     bool SetOptions( const TiCC::CL_Options&  );
@@ -195,6 +241,8 @@ namespace Timbl {
 		   icu::UnicodeString&,
 		   icu::UnicodeString&,
 		   double& );
+    bool Classify( const std::vector<std::string>&,
+		   std::vector<std::string>& );
     size_t matchDepth() const { return match_depth; };
     double confidence() const { return bestResult.confidence(); };
     bool matchedAtLeaf() const { return last_leaf; };
@@ -249,6 +297,10 @@ namespace Timbl {
     virtual void showTestingInfo( std::ostream& );
     virtual bool checkTestFile();
     bool learnFromFileIndex( const fileIndex&, std::istream& );
+    InstanceBase_base *buildFromFileIndex( const fileIndex&,
+					   std::istream&,
+					   unsigned long int& );
+    bool learnFromMultiIndex( const fileDoubleIndex& );
     bool initTestFiles( const std::string&, const std::string& );
     void show_results( std::ostream&,
 		       const double,
@@ -257,6 +309,7 @@ namespace Timbl {
 		       const double ) ;
     void testInstance( const Instance&,
 		       InstanceBase_base *,
+		       size_t = 0,
 		       size_t = 0 );
     void normalizeResult();
     const neighborSet *LocalClassify( const Instance& );
@@ -275,6 +328,18 @@ namespace Timbl {
     void show_metric_info( std::ostream& os ) const;
     double sum_remaining_weights( size_t ) const;
 
+    void build_read_copies( bool );
+    void freeze_instancebase( bool );
+    void index_instancebase();
+    void dense_instancebase( bool );
+    bool cache_key( const Instance&, std::string& ) const;
+    bool spare_neighbor_pays() const;
+    void count_search( bool );
+    void clear_result_cache() {
+      if ( result_cache ){
+	result_cache->clear();
+      }
+    };
     bool build_file_index( const std::string&, fileIndex&  );
     bool build_file_multi_index( const std::string&, fileDoubleIndex&  );
 
@@ -296,13 +361,22 @@ namespace Timbl {
     resultStore bestResult;
     size_t match_depth;
     bool last_leaf;
+    unsigned int searches; // recent searches, and how many of those
+    unsigned int tied_searches; // ended in a Tie
 
   private:
     TimblExperiment( const TimblExperiment& );
     int estimate;
     int numOfThreads;
+    std::shared_ptr<SnapshotChannel> channel; // between a writer and readers
+    std::shared_ptr<const TimblExperiment> snapshot; // the version we read
+    BestArray *batch_best; // neighbours of the next instance, if known
+    resultLRU *result_cache;
+    bool copies_built; // the first frozen or dense copy is made
     const TargetValue *classifyString( const icu::UnicodeString&,
 				       double& );
+    void search_batch( const std::vector<icu::UnicodeString>&,
+		       std::vector<BestArray *>& );
   };
 
   class IB1_Experiment: public TimblExperiment {
@@ -324,8 +398,12 @@ namespace Timbl {
     };
     bool checkTestFile() override;
     bool checkLine( const icu::UnicodeString& ) override;
-    bool Increment( const Instance& I ) { return UnHideInstance( I ); };
-    bool Decrement( const Instance& I ) { return HideInstance( I ); };
+    bool Increment( const Instance& I ) {
+      clear_result_cache();
+      return UnHideInstance( I ); };
+    bool Decrement( const Instance& I ) {
+      clear_result_cache();
+      return HideInstance( I ); };
   private:
     bool GetInstanceBase( std::istream& ) override;
   };
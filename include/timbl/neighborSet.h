@@ -108,9 +108,12 @@ namespace Timbl {
       showDistribution = b;
       return ret;
     }
+    bool isApproximate() const { return approximate; };
+    void setApproximate( bool b ) { approximate = b; };
   private:
     mutable bool showDistance;
     mutable bool showDistribution;
+    bool approximate; // found by a search that ran out of its budget
     void push_back( double, const ClassDistribution & );
     std::vector<double> distances;
     std::vector<ClassDistribution *> distributions;
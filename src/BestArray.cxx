@@ -59,6 +59,13 @@ namespace Timbl {
     }
   }
 
+  void BestRec::mergeLeaves(){
+    for ( const auto *leaf : leaves ){
+      aggregateDist.Merge( *leaf );
+    }
+    leaves.clear();
+  }
+
   BestArray::~BestArray(){
     for ( auto const& b : bestArray ){
       delete b;
@@ -115,22 +122,35 @@ namespace Timbl {
 	best->bestDistributions.clear();
       }
       best->aggregateDist.clear();
+      best->leaves.clear();
     }
   }
 
+  void BestArray::swap( BestArray& other ){
+    // exchange the results of 2 searches, without copying
+    std::swap( _storeInstances, other._storeInstances );
+    std::swap( _showDi, other._showDi );
+    std::swap( _showDb, other._showDb );
+    std::swap( size, other.size );
+    std::swap( maxBests, other.maxBests );
+    bestArray.swap( other.bestArray );
+  }
+
   double BestArray::addResult( double Distance,
 			       const ClassDistribution *Distr,
 			       const UnicodeString& neighbor ){
     // We have the similarity in Distance, and a num_of_neighbors
     // dimensional array with best similarities.
     // Check, and add/replace/move/whatever.
+    // Distr is only remembered, it is merged later by mergeLeaves(). So
+    // nothing is copied for neighbors that are displaced again.
     //
     for ( unsigned int k = 0; k < size; ++k ) {
       BestRec *best = bestArray[k];
       if (fabs(Distance - best->bestDistance) < Epsilon) {
 	// Equal...just add to the end.
 	//
-	best->aggregateDist.Merge( *Distr );
+	best->leaves.push_back( Distr );
 	if ( _storeInstances && best->bestInstances.size() < maxBests ){
 	  best->bestInstances.push_back( neighbor );
 	  best->bestDistributions.push_back( Distr->to_VD_Copy() );
@@ -165,7 +185,8 @@ namespace Timbl {
 	    best->bestDistributions.push_back( Distr->to_VD_Copy() );
 	  }
 	  best->aggregateDist.clear();
-	  best->aggregateDist.Merge( *Distr );
+	  best->leaves.clear();
+	  best->leaves.push_back( Distr );
 	}
 	else {
 	  //
@@ -189,7 +210,8 @@ namespace Timbl {
 	    keep->bestDistributions.push_back( Distr->to_VD_Copy() );
 	  }
 	  keep->aggregateDist.clear();
-	  keep->aggregateDist.Merge( *Distr );
+	  keep->leaves.clear();
+	  keep->leaves.push_back( Distr );
 	  bestArray[k] = keep;
 	}
 	break;
@@ -198,19 +220,51 @@ namespace Timbl {
     return bestArray[size-1]->bestDistance;
   }
 
-  void BestArray::initNeighborSet( neighborSet& ns ) const {
+  void BestArray::mergeLeaves(){
+    for ( size_t k=0; k < size; ++k ){
+      bestArray[k]->mergeLeaves();
+    }
+  }
+
+  void BestArray::initNeighborSet( neighborSet& ns, size_t n ) {
+    // fill ns with the first n neighbors, or with all of them when n == 0
+    // all neighbors are merged, also the ones we don't add, as they
+    // might be displayed later on.
+    mergeLeaves();
     ns.clear();
-    for ( auto const *best : bestArray ){
-      ns.push_back( best->bestDistance,
-		    best->aggregateDist );
+    size_t stop = ( n > 0 && n < size ) ? n : size;
+    for ( size_t k=0; k < stop; ++k ){
+      ns.push_back( bestArray[k]->bestDistance,
+		    bestArray[k]->aggregateDist );
     }
   }
 
-  void BestArray::addToNeighborSet( neighborSet& ns, size_t n ) const {
+  void BestArray::addToNeighborSet( neighborSet& ns, size_t n ) {
+    // after a new search, nothing is merged yet
+    mergeLeaves();
     ns.push_back( bestArray[n-1]->bestDistance,
 		  bestArray[n-1]->aggregateDist );
   }
 
+  void BestArray::trim( unsigned int n ){
+    // forget all neighbors after the first n. Used to drop a spare
+    // (k+1)-th neighbor that wasn't needed to resolve a tie
+    for ( size_t k=n; k < size; ++k ){
+      BestRec *best = bestArray[k];
+      best->bestDistance = DBL_MAX;
+      for ( const auto& it : best->bestDistributions ){
+	delete it;
+      }
+      best->bestInstances.clear();
+      best->bestDistributions.clear();
+      best->aggregateDist.clear();
+      best->leaves.clear();
+    }
+    if ( n < size ){
+      size = n;
+    }
+  }
+
   xmlNode *BestArray::toXML() const {
     xmlNode *top = TiCC::XmlNewNode( "neighborset" );
     size_t k = 0;
@@ -26,6 +26,7 @@
 */
 
 #include <vector>
+#include <limits>
 #include <iosfwd>
 #include <iomanip>
 #include <algorithm> // for sort()
@@ -48,14 +49,24 @@ namespace Timbl {
   FeatureValue::FeatureValue( const UnicodeString& value,
 			      size_t hash_val ):
     ValueClass( value, hash_val ),
-    ValueClassProb( 0 )
+    ValueClassProb( 0 ),
+    _value_id( std::numeric_limits<size_t>::max() )
   {
+    parse_numeric();
   }
 
   FeatureValue::FeatureValue( const UnicodeString& s ):
     ValueClass( s, 0 ),
-    ValueClassProb(0){
+    ValueClassProb(0),
+    _value_id( std::numeric_limits<size_t>::max() ){
     _frequency = 0;
+    parse_numeric();
+  }
+
+  void FeatureValue::parse_numeric(){
+    // the numeric metrics need the value of the name over and over again
+    _numeric = 0.0;
+    _is_numeric = TiCC::stringTo<double>( name(), _numeric );
   }
 
   FeatureValue::~FeatureValue( ){
@@ -82,7 +93,8 @@ namespace Timbl {
     n_min (0.0),
     n_max (0.0),
     weight(0.0),
-    is_reference(false)
+    is_reference(false),
+    shared_values(false)
   {}
 
   Feature::Feature( const Feature& in ): MsgClass( in ){
@@ -115,6 +127,7 @@ namespace Timbl {
       values_array = in.values_array;
       reverse_values = in.reverse_values;
       TokenTree = in.TokenTree;
+      frozen_stats = in.frozen_stats;
     }
     return *this;
   }
@@ -182,11 +195,13 @@ namespace Timbl {
       // so we MUST reverse lookup the index
       FeatureValue *fv = new FeatureValue( value, hash_val );
       fv->ValFreq( freq );
+      fv->_value_id = values_array.size();
       reverse_values[hash_val] = fv;
       values_array.push_back( fv );
     }
     else {
       it->second->IncValFreq( freq );
+      value_changed( it->second );
     }
     FeatureValue *result = reverse_values[hash_val];
     if ( tv ){
@@ -199,6 +214,7 @@ namespace Timbl {
 				 const TargetValue *tv ){
     bool result = false;
     if ( FV ){
+      value_changed( FV );
       FV->incr_val_freq();
       if ( tv ){
 	FV->TargetDist.IncFreq(tv,1);
@@ -212,6 +228,7 @@ namespace Timbl {
 				 const TargetValue *tv ){
     bool result = false;
     if ( FV ){
+      value_changed( FV );
       FV->decr_val_freq();
       if ( tv ){
 	FV->TargetDist.DecFreq(tv);
@@ -256,9 +273,10 @@ namespace Timbl {
   struct D_D {
     D_D(): dist(0), value(0.0) {};
     explicit D_D( FeatureValue *fv ): value(0.0) {
-      if ( !TiCC::stringTo( fv->name(), value ) ){
+      if ( !fv->isNumeric() ){
 	throw( logic_error("called DD with an non-numeric value" ) );
       }
+      value = fv->numericValue();
       dist = &fv->TargetDist;
     }
     ClassDistribution *dist;
@@ -543,12 +561,16 @@ namespace Timbl {
 			      size_t limit ) const {
     double result = 0.0;
     if ( F != G ){
+      if ( frozen_stats ){
+	F = frozen_value( F );
+	G = frozen_value( G );
+      }
       bool dummy;
       if ( metric->isStorable()
 	   && matrixPresent( dummy )
 	   && F->ValFreq() >= matrix_clip_freq
 	   && G->ValFreq() >= matrix_clip_freq ){
-	result = metric_matrix->Extract( F, G );
+	result = metric_matrix->Extract( F->valueId(), G->valueId() );
       }
       else if ( metric->isNumerical() ) {
 	result = metric->distance( F, G, limit, Max() - Min() );
@@ -675,8 +697,10 @@ namespace Timbl {
     if ( !is_reference ){
       delete_matrix();
       delete metric;
-      for ( const auto* it : values_array ){
-	delete it;
+      if ( !shared_values ){
+	for ( const auto* it : values_array ){
+	  delete it;
+	}
       }
     }
     reverse_values.clear();
@@ -705,17 +729,94 @@ namespace Timbl {
     }
   }
 
+  size_t Feature::matrix_values() const {
+    // the number of values with a row in the matrix
+    if ( metric_matrix ){
+      return metric_matrix->Dimension();
+    }
+    else {
+      return 0;
+    }
+  }
+
+  void Feature::value_changed( const FeatureValue *fv ){
+    // only needed when there is a Snapshot to keep up with
+    if ( published_stats ){
+      changed_values.insert( fv->_value_id );
+    }
+  }
+
+  FeatureValue *Feature::copy_stats( const FeatureValue *fv ){
+    // a stand-in for fv with the same id and the same statistics, as far
+    // as the metrics need them
+    FeatureValue *result = new FeatureValue( fv->name(), fv->Index() );
+    result->ValFreq( fv->ValFreq() );
+    result->_value_id = fv->_value_id;
+    if ( fv->ValueClassProb ){
+      result->ValueClassProb = new SparseValueProbClass( *fv->ValueClassProb );
+    }
+    return result;
+  }
+
+  const FeatureValue *Feature::frozen_value( const FeatureValue *fv ) const {
+    // the statistics of fv at the time of the Snapshot. Unknown values
+    // (not from the training data) don't change, so they stand for
+    // themselves
+    size_t id = fv->valueId();
+    if ( id < frozen_stats->size() ){
+      return (*frozen_stats)[id].get();
+    }
+    return fv;
+  }
+
+  Feature *Feature::Snapshot( Hash::UnicodeHash *hash ){
+    // a read-only copy for a published version, using hash for Lookup().
+    // The metric and the matrix are its own, as we go on changing ours.
+    // Only the metrics with a matrix look at the statistics of the values
+    Feature *result = new Feature( hash );
+    *result = *this;
+    result->TokenTree = hash;
+    result->metric = 0;
+    if ( metric ){
+      result->setMetricType( metric->type() );
+    }
+    if ( metric_matrix ){
+      result->metric_matrix = new SymetricMatrix<double>( *metric_matrix );
+    }
+    result->shared_values = true;
+    result->frozen_stats = 0;
+    if ( metric && metric->isStorable() ){
+      auto stats = make_shared<value_stats>();
+      if ( published_stats ){
+	*stats = *published_stats;
+      }
+      for ( const auto& id : changed_values ){
+	if ( id < stats->size() ){
+	  (*stats)[id].reset( copy_stats( values_array[id] ) );
+	}
+      }
+      stats->reserve( values_array.size() );
+      for ( size_t id = stats->size(); id < values_array.size(); ++id ){
+	stats->emplace_back( copy_stats( values_array[id] ) );
+      }
+      changed_values.clear();
+      published_stats = stats;
+      result->frozen_stats = stats;
+    }
+    return result;
+  }
+
   FeatVal_Stat Feature::prepare_numeric_stats(){
     bool first = true;
     for ( const auto* fv : values_array ){
       size_t freq = fv->ValFreq();
       if ( freq > 0 ){
-	double tmp = -1;
-	if ( !TiCC::stringTo( fv->name(), tmp ) ){
+	if ( !fv->isNumeric() ){
 	  Warning( "a Non Numeric value '" + fv->name_string() +
 		   "' in Numeric Feature!" );
 	  return NotNumeric;
 	}
+	double tmp = fv->numericValue();
 	if ( first ){
 	  first = false;
 	  n_min = tmp;
@@ -758,7 +859,7 @@ namespace Timbl {
     vector<double> store( values_array.size() );
     for ( unsigned int i=0; i < values_array.size(); ++i ){
       const FeatureValue *FV = values_array[i];
-      double val = TiCC::stringTo<double>( FV->name() );
+      double val = FV->numericValue();
       store[i] = val;
       sum += val;
     }
@@ -808,22 +909,40 @@ namespace Timbl {
     if ( PrestoreStatus == ps_read ){
       return true;
     }
-    if ( !metric_matrix ){
-      metric_matrix = new SparseSymetricMatrix<const ValueClass*>();
-    }
     if ( PrestoreStatus != ps_failed && metric->isStorable( ) ) {
       try {
-	for ( const auto* FV_i : values_array ){
-	  for ( const auto* FV_j : values_array ){
-	    if ( FV_i->ValFreq() >= matrix_clip_freq &&
-		 FV_j->ValFreq() >= matrix_clip_freq &&
-		 ( Prestored_metric != metric->type() ||
-		   fabs(metric_matrix->Extract(FV_i,FV_j)) < Epsilon ) ){
-	      double dist = metric->distance( FV_i, FV_j, limit );
-	      metric_matrix->Assign( FV_i, FV_j, dist );
+	// only the values above the clip frequency get a row. Distances
+	// stored before for the same metric are kept.
+	vector<bool> use( values_array.size() );
+	for ( size_t i=0; i < values_array.size(); ++i ){
+	  use[i] = values_array[i]->ValFreq() >= matrix_clip_freq;
+	}
+	SymetricMatrix<double> matrix;
+	matrix.Init( use );
+	bool keep = metric_matrix && Prestored_metric == metric->type();
+	// the rows are filled by tasks, when there is a team of threads
+	size_t num = values_array.size();
+#pragma omp taskloop grainsize( 16 ) shared( matrix, use, keep )
+	for ( size_t i=0; i < num; ++i ){
+	  if ( !use[i] ){
+	    continue;
+	  }
+	  for ( size_t j=0; j < i; ++j ){
+	    if ( !use[j] ){
+	      continue;
+	    }
+	    double dist = keep ? metric_matrix->Extract( j, i ) : 0.0;
+	    if ( fabs(dist) < Epsilon ){
+	      dist = metric->distance( values_array[j], values_array[i], limit );
 	    }
+	    matrix.Assign( j, i, dist );
 	  }
 	}
+	// copies of this Feature share the matrix
+	if ( !metric_matrix ){
+	  metric_matrix = new SymetricMatrix<double>();
+	}
+	*metric_matrix = std::move( matrix );
       }
       catch( ... ){
 	cout << "hit the ground!" << endl;
@@ -925,11 +1044,10 @@ namespace Timbl {
 
   bool Feature::fill_matrix( istream &is ) {
     if ( !metric_matrix ){
-      metric_matrix = new SparseSymetricMatrix<const ValueClass*>();
-    }
-    else {
-      metric_matrix->Clear();
+      metric_matrix = new SymetricMatrix<double>();
     }
+    // a row for every value, the file may hold any of them
+    metric_matrix->Init( vector<bool>( values_array.size(), true ) );
     UnicodeString line;
     while ( TiCC::getline(is,line) ){
       if ( line.isEmpty() ){
@@ -960,7 +1078,9 @@ namespace Timbl {
 	else {
 	  FeatureValue *F1 = Lookup(parts[0]);
 	  FeatureValue *F2 = Lookup(parts[1]);
-	  metric_matrix->Assign( F1, F2, d );
+	  if ( F1 && F2 ){
+	    metric_matrix->Assign( F1->valueId(), F2->valueId(), d );
+	  }
 	}
       }
     }
@@ -992,14 +1112,30 @@ namespace Timbl {
 	    os << "*";
 	  }
 	  else {
-	    os << metric_matrix->Extract(FV_i,FV_j);
+	    os << metric_matrix->Extract( FV_i->valueId(), FV_j->valueId() );
 	  }
 	}
 	os << endl;
       }
     }
     else {
-      os << *metric_matrix << endl;
+      // the lower triangle, in the order of the values
+      for ( const auto* FV_i : values_array ){
+	if ( !metric_matrix->Has( FV_i->valueId() ) ){
+	  continue;
+	}
+	for ( const auto* FV_j : values_array ){
+	  if ( FV_j == FV_i ){
+	    break;
+	  }
+	  if ( metric_matrix->Has( FV_j->valueId() ) ){
+	    os << "[" << FV_i << ",\t" << FV_j << "] "
+	       << metric_matrix->Extract( FV_i->valueId(), FV_j->valueId() )
+	       << endl;
+	  }
+	}
+      }
+      os << endl;
     }
     os << setprecision( old_prec );
     os.flags( old_flags );
@@ -77,6 +77,14 @@ namespace Timbl {
     do_silly = false;
     do_diversify = false;
     do_prune = false;
+    do_freeze = false;
+    do_binary = false;
+    do_best_first = false;
+    do_exact_index = false;
+    do_dense = false;
+    search_budget = 0;
+    search_deadline = 0;
+    cache_size = 0;
     if ( MaxFeats == -1 ){
       MaxFeats = Max;
       LocalInputFormat = UnknownInputFormat; // InputFormat and verbosity
@@ -140,6 +148,9 @@ namespace Timbl {
     seed( in.seed ),
     threshold( in.threshold ),
     igThreshold( in.igThreshold ),
+    search_budget( in.search_budget ),
+    search_deadline( in.search_deadline ),
+    cache_size( in.cache_size ),
     myVerbosity( in.myVerbosity ),
     opt_init( in.opt_init ),
     opt_changed( in.opt_changed ),
@@ -157,6 +168,11 @@ namespace Timbl {
     do_silly( in.do_silly ),
     do_diversify( in.do_diversify ),
     do_prune( in.do_prune ),
+    do_freeze( in.do_freeze ),
+    do_binary( in.do_binary ),
+    do_best_first( in.do_best_first ),
+    do_exact_index( in.do_exact_index ),
+    do_dense( in.do_dense ),
     metricsArray( in.metricsArray ),
     parent_socket_os( in.parent_socket_os ),
     outPath( in.outPath ),
@@ -170,6 +186,15 @@ namespace Timbl {
     return result;
   }
 
+  GetOptClass *GetOptClass::Fresh() const{
+    // a copy that sets all options again on a new, empty experiment
+    GetOptClass *result = new GetOptClass(*this);
+    result->opt_init = false;
+    result->opt_changed = false;
+    result->N_present = N_present;
+    return result;
+  }
+
   void GetOptClass::Error( const string& out_line ) const {
     if ( parent_socket_os ){
       *parent_socket_os << "ERROR { " << out_line << " }" << endl;
@@ -248,6 +273,54 @@ namespace Timbl {
 	    return false;
 	  }
 	}
+	if ( do_freeze ){
+	  optline = "FREEZE_TREE: true";
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( do_binary ){
+	  optline = "BINARY_TREE: true";
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( do_best_first ){
+	  optline = "BEST_FIRST: true";
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( do_exact_index ){
+	  optline = "EXACT_INDEX: true";
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( do_dense ){
+	  optline = "DENSE_SEARCH: true";
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( cache_size > 0 ){
+	  optline = "RESULT_CACHE: " + TiCC::toString<int>(cache_size);
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( search_budget > 0 ){
+	  optline = "SEARCH_BUDGET: " + TiCC::toString<int>(search_budget);
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
+	if ( search_deadline > 0 ){
+	  optline = "SEARCH_DEADLINE: " + TiCC::toString<int>(search_deadline);
+	  if ( !Exp->SetOption( optline ) ){
+	    return false;
+	  }
+	}
 	if ( f_length > 0 ){
 	  optline = "FLENGTH: " + TiCC::toString<int>(f_length);
 	  if ( !Exp->SetOption( optline ) ){
@@ -709,10 +782,40 @@ namespace Timbl {
 	  break;
 
 	case 'b':
-	  bootstrap_lines = TiCC::stringTo<int>( value );
-	  if ( bootstrap_lines < 1 ){
-	    Error( "illegal value for -b option: " + value );
-	    return false;
+	  if ( longOpt ){
+	    if ( option == "binary" ){
+	      do_binary = true;
+	    }
+	    else if ( option == "bestfirst" ){
+	      do_best_first = true;
+	    }
+	    else if ( option == "budget" ){
+	      // --budget=n limits a search to n visits of the Instance Base,
+	      // --budget=nus to n microseconds
+	      string val = value;
+	      int *target = &search_budget;
+	      if ( val.size() > 2
+		   && val.compare( val.size()-2, 2, "us" ) == 0 ){
+		val.erase( val.size()-2 );
+		target = &search_deadline;
+	      }
+	      if ( !TiCC::stringTo<int>( val, *target )
+		   || *target <= 0 ){
+		Error( "illegal value for --budget option: " + value );
+		return false;
+	      }
+	    }
+	    else {
+	      Error( "invalid option: Did you mean '--binary', '--bestfirst' or '--budget' ?" );
+	      return false;
+	    }
+	  }
+	  else {
+	    bootstrap_lines = TiCC::stringTo<int>( value );
+	    if ( bootstrap_lines < 1 ){
+	      Error( "illegal value for -b option: " + value );
+	      return false;
+	    }
 	  }
 	  break;
 
@@ -749,6 +852,14 @@ namespace Timbl {
 		return false;
 	      }
 	    }
+	    else if ( option == "cache" ){
+	      if ( !TiCC::stringTo<int>( value, cache_size )
+		   || cache_size <= 0 ){
+		Error( "invalid value for --cache option: '"
+		       + value + "'" );
+		return false;
+	      }
+	    }
 	  }
 	  else {
 	    if ( !TiCC::stringTo<int>( value, clip_freq )
@@ -759,56 +870,66 @@ namespace Timbl {
 	  }
 	  break;
 
-	case 'd': {
-	  string::size_type pos1 = value.find( ":" );
-	  if ( pos1 == string::npos ){
-	    pos1 = value.find_first_of( "0123456789" );
-	    if ( pos1 != string::npos ){
-	      if ( ! ( TiCC::stringTo<DecayType>( string( value, 0, pos1 ),
-					    local_decay ) &&
-		       TiCC::stringTo<double>( string( value, pos1 ),
-					 local_decay_alfa ) ) ){
-		Error( "illegal value for -d option: " + value );
-		return false;
-	      }
+	case 'd':
+	  if ( longOpt ){
+	    if ( option == "dense" ){
+	      do_dense = true;
 	    }
-	    else if ( !TiCC::stringTo<DecayType>( value, local_decay ) ){
-	      Error( "illegal value for -d option: " + value );
+	    else {
+	      Error( "invalid option: Did you mean '--dense' ?" );
 	      return false;
 	    }
 	  }
 	  else {
-	    string::size_type pos2 = value.find( ':', pos1+1 );
-	    if ( pos2 == string::npos ){
-	      pos2 = value.find_first_of( "0123456789", pos1+1 );
-	      if ( pos2 != string::npos ){
+	    string::size_type pos1 = value.find( ":" );
+	    if ( pos1 == string::npos ){
+	      pos1 = value.find_first_of( "0123456789" );
+	      if ( pos1 != string::npos ){
 		if ( ! ( TiCC::stringTo<DecayType>( string( value, 0, pos1 ),
 					      local_decay ) &&
-			 TiCC::stringTo<double>( string( value, pos2 ),
+			 TiCC::stringTo<double>( string( value, pos1 ),
 					   local_decay_alfa ) ) ){
 		  Error( "illegal value for -d option: " + value );
 		  return false;
 		}
 	      }
-	      else {
+	      else if ( !TiCC::stringTo<DecayType>( value, local_decay ) ){
 		Error( "illegal value for -d option: " + value );
 		return false;
 	      }
 	    }
 	    else {
-	      if ( ! ( TiCC::stringTo<DecayType>( string( value, 0, pos1 ),
-					    local_decay ) &&
-		       TiCC::stringTo<double>( string( value, pos1+1, pos2-pos1-1 ),
-					 local_decay_alfa ) &&
-		       TiCC::stringTo<double>( string( value, pos2+1 ),
-					 local_decay_beta ) ) ){
-		Error( "illegal value for -d option: " + value );
-		return false;
+	      string::size_type pos2 = value.find( ':', pos1+1 );
+	      if ( pos2 == string::npos ){
+		pos2 = value.find_first_of( "0123456789", pos1+1 );
+		if ( pos2 != string::npos ){
+		  if ( ! ( TiCC::stringTo<DecayType>( string( value, 0, pos1 ),
+						local_decay ) &&
+			   TiCC::stringTo<double>( string( value, pos2 ),
+					     local_decay_alfa ) ) ){
+		    Error( "illegal value for -d option: " + value );
+		    return false;
+		  }
+		}
+		else {
+		  Error( "illegal value for -d option: " + value );
+		  return false;
+		}
+	      }
+	      else {
+		if ( ! ( TiCC::stringTo<DecayType>( string( value, 0, pos1 ),
+					      local_decay ) &&
+			 TiCC::stringTo<double>( string( value, pos1+1, pos2-pos1-1 ),
+					   local_decay_alfa ) &&
+			 TiCC::stringTo<double>( string( value, pos2+1 ),
+					   local_decay_beta ) ) ){
+		  Error( "illegal value for -d option: " + value );
+		  return false;
+		}
 	      }
 	    }
 	  }
 	  break;
-	}
 
 	case 'D':
 	  if ( longOpt ){
@@ -826,13 +947,37 @@ namespace Timbl {
 	  break;
 
 	case 'e':
-	  if ( !TiCC::stringTo<int>( value, estimate )
-	       || estimate < 0 ){
+	  if ( longOpt ){
+	    if ( option == "exactindex" ){
+	      do_exact_index = true;
+	    }
+	    else {
+	      Error( "invalid option: Did you mean '--exactindex' ?" );
+	      return false;
+	    }
+	  }
+	  else if ( !TiCC::stringTo<int>( value, estimate )
+		    || estimate < 0 ){
 	    Error( "illegal value for -e option: " + value );
 	    return false;
 	  }
 	  break;
 
+	case 'f':
+	  if ( longOpt ){
+	    if ( option == "freeze" ){
+	      do_freeze = true;
+	    }
+	    else {
+	      Error( "invalid option: Did you mean '--freeze' ?" );
+	      return false;
+	    }
+	  }
+	  else {
+	    Warning( string("unhandled option: ") + opt_char + " " + value );
+	  }
+	  break;
+
 	case 'F':
 	  if ( !TiCC::stringTo<InputFormatType>( value, LocalInputFormat ) ){
 	    Error( "illegal value for -F option: " + value );
@@ -94,11 +94,17 @@ namespace Timbl {
     double Compres;
     unsigned long int CurSize;
     unsigned long int CurBytes;
+    unsigned long int SharedBytes;
     CurBytes = InstanceBase->GetSizeInfo( CurSize, Compres );
+    SharedBytes = InstanceBase->SharedBytes();
     ios::fmtflags OldFlg = os.setf( ios::fixed, ios::floatfield );
     int OldPrec = os.precision(2);
     os << "\nSize of InstanceBase = " << CurSize << " Nodes, (" << CurBytes
        << " bytes), " << Compres << " % compression" << endl;
+    if ( SharedBytes > 0 ){
+      os << "Sharing equal distributions saved " << SharedBytes
+	 << " bytes" << endl;
+    }
     if ( Verbosity(BRANCHING) ) {
       vector<unsigned int> terminals;
       vector<unsigned int> nonTerminals;
@@ -307,6 +313,10 @@ namespace Timbl {
 	    if ( compare_nocase_n( "(Hashed)", splits[3] ) ){
 	      Hashed = true;
 	    }
+	    else if ( compare_nocase_n( "(Binary)", splits[3] ) ){
+	      // the binary format is always hashed
+	      Hashed = true;
+	    }
 	  }
 	}
       }
@@ -463,7 +473,14 @@ namespace Timbl {
 	os << " ." << endl;
       }
       os << "# Bin_Size: " << Bin_Size << endl;
-      if ( hashed_trees ){
+      if ( binary_trees ){
+	InstanceBase->SaveBinary( os,
+				  *targets.hash(),
+				  *features.hash(),
+				  features,
+				  keep_distributions );
+      }
+      else if ( hashed_trees ){
 	InstanceBase->Save( os,
 			    *targets.hash(),
 			    *features.hash(),
@@ -28,6 +28,14 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <new>
+#include <iterator>
+#include <cstring>
+#include <cmath>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include "ticcutils/StringOps.h"
 #include "ticcutils/UniHash.h"
@@ -37,6 +45,7 @@
 #include "timbl/Types.h"
 #include "timbl/Instance.h"
 #include "timbl/IBtree.h"
+#include "timbl/MappedFile.h"
 
 using namespace std;
 using namespace icu;
@@ -44,6 +53,7 @@ using namespace icu;
 namespace Timbl {
   using namespace Common;
   using TiCC::operator<<;
+
   IBtree::IBtree():
     FValue(0), TValue(0), TDistribution(0),
     link(0), next(0)
@@ -55,20 +65,186 @@ namespace Timbl {
   { }
 
   IBtree::~IBtree(){
-    delete TDistribution;
-    delete link;
-    delete next;
+    // the nodes themselves are owned by a NodeArena
+    drop_distribution();
+  }
+
+  void IBtree::drop_distribution(){
+    // a shared distribution is only deleted by its last owner
+    if ( TDistribution && TDistribution->DropOwner() ){
+      delete TDistribution;
+    }
+    TDistribution = 0;
+  }
+
+  ClassDistribution *IBtree::own_distribution(){
+    // copy on write: a shared distribution is replaced by a private copy
+    // before it is modified
+    if ( TDistribution->Owners() > 1 ){
+      ClassDistribution *copy = TDistribution->Copy();
+      drop_distribution();
+      TDistribution = copy;
+    }
+    return TDistribution;
+  }
+
+  size_t DistributionPool::dist_hash::operator()( const ClassDistribution *d ) const {
+    return d->HashValue();
+  }
+
+  bool DistributionPool::dist_equal::operator()( const ClassDistribution *a,
+						 const ClassDistribution *b ) const {
+    return a->Equals( *b );
+  }
+
+  DistributionPool::~DistributionPool(){
+    for ( const auto& dist : pool ){
+      if ( dist->DropOwner() ){
+	delete dist;
+      }
+    }
+  }
+
+  ClassDistribution *DistributionPool::share( ClassDistribution *dist ){
+    // dist is owned by the caller. Returns an equal distribution from the
+    // pool instead, which is then owned by the caller too.
+    auto ins = pool.insert( dist );
+    ClassDistribution *result = *ins.first;
+    if ( ins.second ){
+      result->AddOwner(); // the pool's reference
+    }
+    else if ( result != dist ){
+      result->AddOwner();
+      if ( dist->DropOwner() ){
+	delete dist;
+      }
+    }
+    return result;
+  }
+
+  ClassDistribution *DistributionPool::single( const TargetValue *tv,
+					       int occ ){
+    // a (shared) distribution with only 'occ' times target 'tv'
+    ClassDistribution tmp;
+    tmp.IncFreq( tv, occ );
+    auto it = pool.find( &tmp );
+    if ( it != pool.end() ){
+      (*it)->AddOwner();
+      return *it;
+    }
+    return share( tmp.Copy() );
+  }
+
+  void DistributionPool::adopt( DistributionPool& other ){
+    // take over the references of the other pool
+    for ( const auto& dist : other.pool ){
+      if ( !pool.insert( dist ).second
+	   && dist->DropOwner() ){
+	delete dist;
+      }
+    }
+    other.pool.clear();
+  }
+
+  NodeArena::slab::slab():
+    nodes( static_cast<IBtree*>( ::operator new( SLAB_SIZE * sizeof(IBtree) ) ) ),
+    used( 0 )
+  { }
+
+  NodeArena::slab::~slab(){
+    for ( size_t i=0; i < used; ++i ){
+      nodes[i].~IBtree();
+    }
+    ::operator delete( nodes );
+  }
+
+  IBtree *NodeArena::alloc( FeatureValue *FV ){
+    IBtree *result;
+    if ( free_list ){
+      result = free_list;
+      free_list = free_list->next;
+      result->~IBtree();
+      new ( result ) IBtree( FV );
+    }
+    else {
+      if ( slabs.empty() || slabs.back()->used == SLAB_SIZE ){
+	slabs.push_back( make_shared<slab>() );
+      }
+      slab& sl = *slabs.back();
+      result = new ( &sl.nodes[sl.used++] ) IBtree( FV );
+    }
+    if ( sealed ){
+      fresh.insert( result );
+    }
+    return result;
+  }
+
+  void NodeArena::release( IBtree *node ){
+    // only this node is released, NOT its children or siblings.
+    if ( Sealed( node ) ){
+      // a published version still uses it
+      ++garbage;
+      return;
+    }
+    node->drop_distribution();
+    node->link = 0;
+    node->next = free_list;
+    free_list = node;
+  }
+
+  void NodeArena::adopt( NodeArena& other ){
+    // take over all nodes of the other arena. Our last slab remains the
+    // one to fill next, so slabs of other are inserted before it.
+    if ( slabs.empty() ){
+      slabs.swap( other.slabs );
+    }
+    else {
+      slabs.insert( slabs.end()-1, other.slabs.begin(), other.slabs.end() );
+      other.slabs.clear();
+    }
+    if ( other.free_list ){
+      IBtree *last = other.free_list;
+      while ( last->next ){
+	last = last->next;
+      }
+      last->next = free_list;
+      free_list = other.free_list;
+      other.free_list = 0;
+    }
+  }
+
+  void NodeArena::swap( NodeArena& other ){
+    slabs.swap( other.slabs );
+    std::swap( free_list, other.free_list );
+    std::swap( sealed, other.sealed );
+    fresh.swap( other.fresh );
+    std::swap( garbage, other.garbage );
+  }
+
+  void NodeArena::Seal(){
+    // all nodes so far are shared from now on. Nodes on the free list are
+    // not in use, so they may still be recycled
+    sealed = true;
+    fresh.clear();
+  }
+
+  void NodeArena::Share( const NodeArena& other ){
+    // refer to the (sealed) slabs of other too. We never allocate nodes
+    // ourselves, this is only to keep them alive
+    slabs.insert( slabs.end(), other.slabs.begin(), other.slabs.end() );
   }
 
 #ifdef IBSTATS
   inline IBtree *IBtree::add_feat_val( FeatureValue *FV,
 				       unsigned int& mm,
 				       IBtree *& tree,
-				       unsigned long& cnt ){
+				       unsigned long& cnt,
+				       NodeArena& arena ){
 #else
   inline IBtree *IBtree::add_feat_val( FeatureValue *FV,
 				       IBtree *& tree,
-				       unsigned long& cnt ){
+				       unsigned long& cnt,
+				       NodeArena& arena ){
 #endif
     // Add a Featurevalue to the IB.
     IBtree **pnt = &tree;
@@ -86,14 +262,14 @@ namespace Timbl {
       else {
 	// need to add a new node before the current one
 	IBtree *tmp = *pnt;
-	*pnt = new IBtree( FV );
+	*pnt = arena.alloc( FV );
 	++cnt;
 	(*pnt)->next = tmp;
 	return *pnt;
       }
     }
     // add at the end.
-    *pnt = new IBtree( FV );
+    *pnt = arena.alloc( FV );
     ++cnt;
     return *pnt;
   }
@@ -173,12 +349,53 @@ namespace Timbl {
     return os;
   }
 
+  unsigned long int InstanceBase_base::distribution_bytes( unsigned long int& Saved ) const {
+    // returns the number of bytes used by the distributions.
+    // Saved is the number of bytes that sharing them saves
+    unsigned long int DistBytes = 0;
+    Saved = 0;
+    unordered_set<const ClassDistribution *> seen;
+    vector<const IBtree *> todo;
+    if ( InstBase ){
+      todo.push_back( InstBase );
+    }
+    while ( !todo.empty() ){
+      const IBtree *pnt = todo.back();
+      todo.pop_back();
+      for ( ; pnt; pnt = pnt->next ){
+	if ( pnt->link ){
+	  todo.push_back( pnt->link );
+	}
+	const ClassDistribution *dist = pnt->TDistribution;
+	if ( dist ){
+	  if ( dist->Owners() < 2
+	       || seen.insert( dist ).second ){
+	    DistBytes += dist->NumBytes();
+	  }
+	  else {
+	    Saved += dist->NumBytes();
+	  }
+	}
+      }
+    }
+    return DistBytes;
+  }
+
   unsigned long int InstanceBase_base::GetSizeInfo( unsigned long int& CurSize,
 						    double &Compression ) const {
+    // returns the number of bytes used by the nodes and the distributions.
     unsigned long int MaxSize = (Depth+1) * NumOfTails;
     CurSize = ibCount;
     Compression = 100*(1-(double)CurSize/(double)MaxSize);
-    return CurSize * sizeof(IBtree);
+    unsigned long int Saved;
+    return CurSize * sizeof(IBtree) + distribution_bytes( Saved );
+  }
+
+  unsigned long int InstanceBase_base::SharedBytes() const {
+    // the number of bytes that sharing equal distributions saves
+    unsigned long int Saved;
+    distribution_bytes( Saved );
+    return Saved;
   }
 
   void InstanceBase_base::write_tree( ostream &os, const IBtree *pnt ) const {
@@ -446,6 +663,199 @@ namespace Timbl {
     PersistentDistributions = temp_persist;
   }
 
+  // The binary InstanceBase format (Version 5)
+  // After the usual header lines, one block follows, starting with a
+  // bin_header. Then the sections follow, all arrays of fixed size records,
+  // each starting at a multiple of 8 bytes from the start of the block:
+  //   name_ends : uint64_t[targets+values], where each name ends in 'text'
+  //               (first the class names, then the feature values)
+  //   text      : all names in UTF-8, concatenated
+  //   stats     : double[features*6], the statistics of every feature
+  //   nodes     : bin_node[nodes], the tree in pre-order
+  //   dists     : bin_dist[dists], dists[0] is the TopDistribution
+  //   items     : bin_item[items], the entries of all distributions
+  // Everything is stored in native byte order. Reading is one linear pass
+  // over the block, no tokenizing is involved.
+  const char BinaryMagic[8] = { 'T', 'i', 'M', 'B', 'L', 'b', 'i', 'n' };
+  const uint32_t BinaryRevision = 1;
+  const uint32_t BinaryByteOrder = 0x01020304;
+  const uint32_t NO_DIST = UINT32_MAX;
+  const size_t NUM_STATS = 6;
+
+  struct bin_header {
+    char magic[8];
+    uint32_t revision;
+    uint32_t byte_order;
+    uint32_t depth;
+    uint32_t persistent;
+    uint64_t targets;
+    uint64_t values;
+    uint64_t text_bytes;
+    uint64_t features;
+    uint64_t roots;
+    uint64_t nodes;
+    uint64_t dists;
+    uint64_t items;
+  };
+
+  struct bin_node {
+    uint32_t value;    // index in the feature hash
+    uint32_t target;   // index in the target hash
+    uint32_t dist;     // index in dists, or NO_DIST
+    uint32_t children; // number of children, they follow in pre-order
+  };
+
+  struct bin_dist {
+    uint64_t end;      // one past the last item of this distribution
+    uint64_t weighted;
+  };
+
+  struct bin_item {
+    uint64_t freq;
+    double weight;
+    uint32_t target;
+    uint32_t pad;
+  };
+
+  inline size_t padded( size_t len ){
+    return (len + 7) & ~size_t(7);
+  }
+
+  inline void write_padded( ostream& os, const void *data, size_t len ){
+    static const char zeros[8] = { 0 };
+    os.write( static_cast<const char *>(data), len );
+    os.write( zeros, padded( len ) - len );
+  }
+
+  template <typename T>
+  inline T fetch( const char *section, uint64_t i ){
+    // the block has no particular alignment in memory, so copy
+    T result;
+    memcpy( &result, section + i*sizeof(T), sizeof(T) );
+    return result;
+  }
+
+  void InstanceBase_base::SaveBinary( ostream& os,
+				      const Hash::UnicodeHash& cats,
+				      const Hash::UnicodeHash& feats,
+				      const Feature_List& features,
+				      bool persist ) {
+    // save an IBtree in the binary format. It is meant for fast loading
+    // and holds the same information as the Hashed format, plus the
+    // feature statistics.
+    bool temp_persist = PersistentDistributions;
+    PersistentDistributions = persist;
+    AssignDefaults();
+    os << "# Version " << BinaryVersion << " (Binary)\n#" << endl;
+    string text;
+    vector<uint64_t> name_ends;
+    for ( unsigned int i=1; i <= cats.num_of_entries(); ++i ){
+      text += TiCC::UnicodeToUTF8( cats.reverse_lookup( i ) );
+      name_ends.push_back( text.size() );
+    }
+    for ( unsigned int i=1; i <= feats.num_of_entries(); ++i ){
+      text += TiCC::UnicodeToUTF8( feats.reverse_lookup( i ) );
+      name_ends.push_back( text.size() );
+    }
+    vector<double> stats;
+    for ( const auto *feat : features.feats ){
+      stats.push_back( feat->InfoGain() );
+      stats.push_back( feat->SplitInfo() );
+      stats.push_back( feat->GainRatio() );
+      stats.push_back( feat->ChiSquare() );
+      stats.push_back( feat->SharedVariance() );
+      stats.push_back( feat->StandardDeviation() );
+    }
+    vector<bin_node> nodes;
+    vector<bin_dist> dists;
+    vector<bin_item> items;
+    auto add_dist = [&]( const ClassDistribution *dist ){
+      if ( dists.size() >= NO_DIST ){
+	throw range_error( "too many distributions for the binary format" );
+      }
+      for ( const auto& it : *dist ){
+	bin_item item = { it.Freq(), it.Weight(),
+			  static_cast<uint32_t>( it.Index() ), 0 };
+	items.push_back( item );
+      }
+      bool weighted = dynamic_cast<const WClassDistribution*>( dist ) != 0;
+      bin_dist bd = { items.size(), weighted };
+      dists.push_back( bd );
+      return static_cast<uint32_t>( dists.size() - 1 );
+    };
+    add_dist( TopDistribution );
+    uint64_t roots = 0;
+    for ( const IBtree *pnt = InstBase; pnt; pnt = pnt->next ){
+      ++roots;
+    }
+    // a pre-order walk. stack holds the next sibling to visit per level.
+    // The distributions stored are the same as in write_tree_hashed()
+    vector<const IBtree *> stack;
+    if ( InstBase ){
+      stack.push_back( InstBase );
+    }
+    while ( !stack.empty() ){
+      const IBtree *pnt = stack.back();
+      if ( !pnt ){
+	stack.pop_back();
+	continue;
+      }
+      stack.back() = pnt->next;
+      bin_node node = { static_cast<uint32_t>( pnt->FValue->Index() ),
+			static_cast<uint32_t>( pnt->TValue->Index() ),
+			NO_DIST, 0 };
+      const ClassDistribution *dist = 0;
+      const IBtree *children = 0;
+      if ( pnt->link ){
+	if ( PersistentDistributions && pnt->TDistribution ){
+	  dist = pnt->TDistribution;
+	}
+	if ( pnt->link->FValue ){
+	  children = pnt->link;
+	}
+	else if ( !PersistentDistributions && pnt->link->TDistribution ){
+	  dist = pnt->link->TDistribution;
+	}
+      }
+      else {
+	dist = pnt->TDistribution;
+      }
+      if ( dist ){
+	node.dist = add_dist( dist );
+      }
+      for ( const IBtree *child = children; child; child = child->next ){
+	++node.children;
+      }
+      nodes.push_back( node );
+      if ( children ){
+	stack.push_back( children );
+      }
+    }
+    bin_header head;
+    memset( &head, 0, sizeof(head) );
+    memcpy( head.magic, BinaryMagic, sizeof(head.magic) );
+    head.revision = BinaryRevision;
+    head.byte_order = BinaryByteOrder;
+    head.depth = Depth;
+    head.persistent = PersistentDistributions;
+    head.targets = cats.num_of_entries();
+    head.values = feats.num_of_entries();
+    head.text_bytes = text.size();
+    head.features = features.feats.size();
+    head.roots = roots;
+    head.nodes = nodes.size();
+    head.dists = dists.size();
+    head.items = items.size();
+    write_padded( os, &head, sizeof(head) );
+    write_padded( os, name_ends.data(), name_ends.size()*sizeof(uint64_t) );
+    write_padded( os, text.data(), text.size() );
+    write_padded( os, stats.data(), stats.size()*sizeof(double) );
+    write_padded( os, nodes.data(), nodes.size()*sizeof(bin_node) );
+    write_padded( os, dists.data(), dists.size()*sizeof(bin_dist) );
+    write_padded( os, items.data(), items.size()*sizeof(bin_item) );
+    PersistentDistributions = temp_persist;
+  }
+
   IBtree* InstanceBase_base::read_list( istream &is,
 					Feature_List& feats,
 					Targets& Targ,
@@ -458,7 +868,7 @@ namespace Timbl {
       is >> delim;    // skip the opening `[` or separating ','
       *pnt = read_local( is, feats, Targ, level );
       if ( !(*pnt) ){
-	delete result;
+	// the nodes read so far are cleaned up with the Arena
 	return NULL;
       }
       pnt = &((*pnt)->next);
@@ -480,7 +890,7 @@ namespace Timbl {
       is >> delim;    // skip the opening `[` or separating ','
       *pnt = read_local_hashed( is, feats, Targ, level );
       if ( !(*pnt) ){
-	delete result;
+	// the nodes read so far are cleaned up with the Arena
 	return NULL;
       }
       pnt = &((*pnt)->next);
@@ -497,7 +907,7 @@ namespace Timbl {
     if ( !is ){
       return NULL;
     }
-    IBtree *result = new IBtree();
+    IBtree *result = Arena.alloc();
     ++ibCount;
     UnicodeString buf;
     char delim;
@@ -506,7 +916,6 @@ namespace Timbl {
     is >> delim;
     if ( !is || delim != '(' ){
       Error( "missing `(` in Instance Base file" );
-      delete result;
       return NULL;
     }
     is >> ws >> buf;
@@ -520,7 +929,6 @@ namespace Timbl {
       catch ( const exception& e ){
 	Warning( e.what() );
 	Error( "problems reading a distribution from InstanceBase file" );
-	delete result;
 	return 0;
       }
       // also we have to update the targetinformation of the featurevalue
@@ -532,19 +940,19 @@ namespace Timbl {
     if ( look_ahead(is) == '[' ){
       result->link = read_list( is, feats, Targ, level+1 );
       if ( !(result->link) ){
-	delete result;
 	return 0;
       }
     }
     else if ( look_ahead(is) == ')' && result->TDistribution ){
-      result->link = new IBtree();
+      result->link = Arena.alloc();
       ++ibCount;
       result->link->TValue = result->TValue;
       if ( PersistentDistributions ){
-	result->link->TDistribution = result->TDistribution->to_VD_Copy();
+	result->link->TDistribution
+	  = Pool.share( result->TDistribution->to_VD_Copy() );
       }
       else {
-	result->link->TDistribution = result->TDistribution;
+	result->link->TDistribution = Pool.share( result->TDistribution );
 	result->TDistribution = NULL;
       }
       NumOfTails++;
@@ -552,7 +960,6 @@ namespace Timbl {
     is >> delim;
     if ( delim != ')' ){
       Error( "missing `)` in Instance Base file" );
-      delete result;
       return NULL;
     }
     return result;
@@ -565,7 +972,7 @@ namespace Timbl {
     if ( !is ){
       return NULL;
     }
-    IBtree *result = new IBtree();
+    IBtree *result = Arena.alloc();
     ++ibCount;
     char delim;
     int index;
@@ -574,7 +981,6 @@ namespace Timbl {
     is >> delim;
     if ( !is || delim != '(' ){
       Error( "missing `(` in Instance Base file" );
-      delete result;
       return NULL;
     }
     is >> index;
@@ -592,14 +998,12 @@ namespace Timbl {
       catch ( const exception& e ){
 	Warning( e.what() );
 	Error( "problems reading a hashed distribution from InstanceBase file" );
-	delete result;
 	return 0;
       }
     }
     if ( look_ahead(is) == '[' ){
       result->link = read_list_hashed( is, feats, Targ, level+1 );
       if ( !(result->link) ){
-	delete result;
 	return NULL;
       }
     }
@@ -607,14 +1011,15 @@ namespace Timbl {
       //
       // make a dummy node for the targetdistributions just read
       //
-      result->link = new IBtree();
+      result->link = Arena.alloc();
       ++ibCount;
       result->link->TValue = result->TValue;
       if ( PersistentDistributions ){
-	result->link->TDistribution = result->TDistribution->to_VD_Copy();
+	result->link->TDistribution
+	  = Pool.share( result->TDistribution->to_VD_Copy() );
       }
       else {
-	result->link->TDistribution = result->TDistribution;
+	result->link->TDistribution = Pool.share( result->TDistribution );
 	result->TDistribution = NULL;
       }
       NumOfTails++;
@@ -622,7 +1027,6 @@ namespace Timbl {
     is >> delim;
     if ( delim != ')' ){
       Error( "missing `)` in Instance Base file" );
-      delete result;
       return NULL;
     }
     return result;
@@ -645,14 +1049,106 @@ namespace Timbl {
     }
   }
 
-  void InstanceBase_base::fill_index(){
-    IBtree *pnt = InstBase;
+  inline uint64_t fingerprint_add( uint64_t fp, uint32_t id ){
+    // fold the next value id of a path into its fingerprint, with a
+    // splitmix64 step, so every bit depends on all the values so far
+    fp += id + 0x9e3779b97f4a7c15ULL;
+    fp ^= fp >> 30;
+    fp *= 0xbf58476d1ce4e5b9ULL;
+    fp ^= fp >> 27;
+    fp *= 0x94d049bb133111ebULL;
+    return fp ^ ( fp >> 31 );
+  }
+
+  uint64_t PathIndex::fingerprint( const uint32_t *path ) const {
+    uint64_t fp = 0;
+    for ( size_t i=0; i < depth; ++i ){
+      fp = fingerprint_add( fp, path[i] );
+    }
+    return fp;
+  }
+
+  bool PathIndex::same_path( const entry& e, const uint32_t *path ) const {
+    return equal( path, path + depth, ids.begin() + e.pos );
+  }
+
+  void PathIndex::insert( const uint32_t *path, const IBtree *leaf ){
+    // add a path, or move it to another leaf
+    uint64_t fp = fingerprint( path );
+    auto const& It = table.find( fp );
+    if ( It == table.end() ){
+      table[fp] = { leaf, ids.size() };
+      ids.insert( ids.end(), path, path + depth );
+    }
+    else if ( same_path( It->second, path ) ){
+      It->second.leaf = leaf;
+    }
+    // else: a collision, the path is only found in the tree
+  }
+
+  bool PathIndex::lookup( const uint32_t *path, const IBtree*& leaf ) const {
+    // find the leaf of path, 0 when it is not in the tree. Returns false
+    // when we can't tell, because another path has the same fingerprint
+    leaf = 0;
+    auto const& It = table.find( fingerprint( path ) );
+    if ( It == table.end() ){
+      return true;
+    }
+    if ( !same_path( It->second, path ) ){
+      return false;
+    }
+    leaf = It->second.leaf;
+    return true;
+  }
+
+  bool InstanceBase_base::IndexExact(){
+    // build a hash table from the value ids of every full path in the
+    // tree to its leaf, so ExactMatch() needs one probe instead of a walk
+    // over all levels. AddInstance() keeps it up to date.
+    if ( !ExactIndex && InstBase && !Pruned ){
+      ExactIndex = new PathIndex( Depth );
+      ExactIndex->reserve( NumOfTails );
+      vector<uint32_t> path;
+      fill_exact_index( InstBase, path );
+    }
+    return ExactIndex != 0;
+  }
+
+  void InstanceBase_base::fill_exact_index( const IBtree *pnt,
+					    vector<uint32_t>& path ){
     while ( pnt ){
-      fast_index[pnt->FValue->Index()] = pnt;
+      if ( pnt->link == NULL ){
+	ExactIndex->insert( path.data(), pnt );
+	return;
+      }
+      path.push_back( pnt->FValue->Index() );
+      fill_exact_index( pnt->link, path );
+      path.pop_back();
       pnt = pnt->next;
     }
   }
 
+  const ClassDistribution *InstanceBase_base::indexed_match( const Instance& Inst ) const {
+    // same as IBtree::exact_match(), using the ExactIndex
+    for ( size_t i=0; i < Depth; ++i ){
+      if ( Inst.VI[i] == Instance::UnknownId ){
+	return NULL;
+      }
+    }
+    const IBtree *leaf;
+    if ( !ExactIndex->lookup( Inst.VI.data(), leaf ) ){
+      // a fingerprint collision, so search the tree itself
+      if ( FrozenBase ){
+	return FrozenBase->exact_match( Inst );
+      }
+      return linked_match( Inst );
+    }
+    if ( !leaf || leaf->TDistribution->ZeroDist() ){
+      return NULL;
+    }
+    return leaf->TDistribution;
+  }
+
   bool IG_InstanceBase::ReadIB( istream &is,
 				Feature_List& feats,
 				Targets& Targ,
@@ -804,6 +1300,9 @@ namespace Timbl {
     DefAss = true;  // always for a restored tree
     DefaultsValid = true; // always for a restored tree
     Version = expected_version;
+    if ( Version >= BinaryVersion ){
+      return read_IB_binary( is, feats, Targs );
+    }
     read_hash( is, *Targs.hash(), *feats.hash() );
     is >> delim;
     if ( !is || delim != '(' ){
@@ -847,6 +1346,228 @@ namespace Timbl {
     return (InstBase != NULL);
   }
 
+  bool InstanceBase_base::read_IB_binary( istream& is,
+					  Feature_List& feats,
+					  Targets& Targs ){
+    // read the binary block which follows the header lines.
+    // When is reads from a MappedFile, we work on the mapped memory,
+    // otherwise we take a copy of the rest of the stream first.
+    const char *block = 0;
+    size_t length = 0;
+    vector<char> copy;
+    const MappedFile *mf = dynamic_cast<const MappedFile*>( is.rdbuf() );
+    if ( mf ){
+      block = mf->current();
+      length = mf->remaining();
+    }
+    else {
+      copy.assign( istreambuf_iterator<char>( is ),
+		   istreambuf_iterator<char>() );
+      block = copy.data();
+      length = copy.size();
+    }
+    bin_header head;
+    if ( length < sizeof(head) ){
+      Error( "binary Instance Base file is truncated" );
+      return false;
+    }
+    memcpy( &head, block, sizeof(head) );
+    if ( memcmp( head.magic, BinaryMagic, sizeof(head.magic) ) != 0 ){
+      Error( "missing binary header in Instance Base file" );
+      return false;
+    }
+    if ( head.byte_order != BinaryByteOrder ){
+      Error( "binary Instance Base file is written with another byte order" );
+      return false;
+    }
+    if ( head.revision != BinaryRevision ){
+      Error( "unsupported revision of the binary Instance Base format: "
+	     + TiCC::toString( head.revision ) );
+      return false;
+    }
+    if ( head.depth != Depth ){
+      Error( "binary Instance Base file has " + TiCC::toString( head.depth )
+	     + " levels, expected " + TiCC::toString( Depth ) );
+      return false;
+    }
+    size_t pos = padded( sizeof(head) );
+    bool truncated = false;
+    auto section = [&]( uint64_t count, size_t size ) -> const char * {
+      if ( count > length / size
+	   || pos > length
+	   || padded( count*size ) > length - pos ){
+	truncated = true;
+	return 0;
+      }
+      const char *result = block + pos;
+      pos += padded( count*size );
+      return result;
+    };
+    const char *name_ends = 0;
+    if ( head.targets <= length && head.values <= length ){
+      name_ends = section( head.targets + head.values, sizeof(uint64_t) );
+    }
+    const char *text = section( head.text_bytes, 1 );
+    const char *stats = section( head.features, NUM_STATS*sizeof(double) );
+    const char *nodes = section( head.nodes, sizeof(bin_node) );
+    const char *dists = section( head.dists, sizeof(bin_dist) );
+    const char *items = section( head.items, sizeof(bin_item) );
+    if ( truncated || !name_ends || head.dists == 0 ){
+      Error( "binary Instance Base file is truncated" );
+      return false;
+    }
+    // the hashes are still empty, so the indices come out the same
+    uint64_t start = 0;
+    for ( uint64_t i=0; i < head.targets + head.values; ++i ){
+      uint64_t end = fetch<uint64_t>( name_ends, i );
+      if ( end < start || end > head.text_bytes ){
+	Error( "corrupt name table in binary Instance Base file" );
+	return false;
+      }
+      UnicodeString name
+	= TiCC::UnicodeFromUTF8( string( text + start, end - start ) );
+      unsigned int index;
+      uint64_t expected;
+      if ( i < head.targets ){
+	index = Targs.hash()->hash( name );
+	expected = i + 1;
+      }
+      else {
+	index = feats.hash()->hash( name );
+	expected = i - head.targets + 1;
+      }
+      if ( index != expected ){
+	Error( "the hash tables don't match the binary Instance Base file" );
+	return false;
+      }
+      start = end;
+    }
+    if ( head.features == feats.feats.size() ){
+      for ( size_t i=0; i < head.features; ++i ){
+	Feature *feat = feats.feats[i];
+	feat->InfoGain( fetch<double>( stats, i*NUM_STATS ) );
+	feat->SplitInfo( fetch<double>( stats, i*NUM_STATS+1 ) );
+	feat->GainRatio( fetch<double>( stats, i*NUM_STATS+2 ) );
+	feat->ChiSquare( fetch<double>( stats, i*NUM_STATS+3 ) );
+	feat->SharedVariance( fetch<double>( stats, i*NUM_STATS+4 ) );
+	feat->StandardDeviation( fetch<double>( stats, i*NUM_STATS+5 ) );
+      }
+    }
+    auto get_dist = [&]( uint32_t d, bool top ) -> ClassDistribution * {
+      // build distribution d. For the TopDistribution, we also
+      // create the Targets with their frequencies
+      uint64_t first = ( d == 0 ) ? 0 : fetch<bin_dist>( dists, d-1 ).end;
+      bin_dist bd = fetch<bin_dist>( dists, d );
+      if ( bd.end < first || bd.end > head.items ){
+	return 0;
+      }
+      ClassDistribution *result = 0;
+      if ( bd.weighted ){
+	result = new WClassDistribution();
+      }
+      else {
+	result = new ClassDistribution();
+      }
+      for ( uint64_t i = first; i < bd.end; ++i ){
+	bin_item item = fetch<bin_item>( items, i );
+	TargetValue *target = 0;
+	if ( item.target > 0 && item.target <= head.targets ){
+	  if ( top ){
+	    target = Targs.add_value( item.target, item.freq );
+	  }
+	  else {
+	    target = Targs.ReverseLookup( item.target );
+	  }
+	}
+	if ( !target ){
+	  delete result;
+	  return 0;
+	}
+	if ( bd.weighted ){
+	  result->SetFreq( target, item.freq, item.weight );
+	}
+	else {
+	  result->SetFreq( target, item.freq );
+	}
+      }
+      return result;
+    };
+    delete TopDistribution;
+    TopDistribution = get_dist( 0, true );
+    if ( !TopDistribution ){
+      Error( "problems reading Top Distribution from Instance Base file" );
+      return false;
+    }
+    // rebuild the tree from the pre-order node list. todo holds, per level,
+    // where the next node goes and how many siblings are still to come
+    struct pending {
+      IBtree **tail;
+      uint64_t left;
+    };
+    vector<pending> todo;
+    todo.push_back( { &InstBase, head.roots } );
+    bool ok = true;
+    for ( uint64_t n=0; ok && n < head.nodes; ++n ){
+      while ( !todo.empty() && todo.back().left == 0 ){
+	todo.pop_back();
+      }
+      bin_node bn = fetch<bin_node>( nodes, n );
+      if ( todo.empty()
+	   || todo.size() > Depth
+	   || bn.value == 0 || bn.value > head.values
+	   || ( bn.dist != NO_DIST
+		&& ( bn.dist == 0 || bn.dist >= head.dists ) ) ){
+	ok = false;
+	break;
+      }
+      size_t level = todo.size() - 1;
+      IBtree *node = Arena.alloc();
+      ++ibCount;
+      *todo.back().tail = node;
+      todo.back().tail = &node->next;
+      --todo.back().left;
+      node->FValue = feats.perm_feats[level]->add_value( bn.value, NULL, 1 );
+      node->TValue = Targs.ReverseLookup( bn.target );
+      if ( bn.dist != NO_DIST ){
+	node->TDistribution = get_dist( bn.dist, false );
+	ok = ( node->TDistribution != 0 );
+      }
+      if ( !node->TValue ){
+	ok = false;
+      }
+      else if ( bn.children > 0 ){
+	todo.push_back( { &node->link, bn.children } );
+      }
+      else if ( node->TDistribution ){
+	//
+	// make a dummy node for the targetdistributions just read
+	//
+	node->link = Arena.alloc();
+	++ibCount;
+	node->link->TValue = node->TValue;
+	if ( PersistentDistributions ){
+	  node->link->TDistribution
+	    = Pool.share( node->TDistribution->to_VD_Copy() );
+	}
+	else {
+	  node->link->TDistribution = Pool.share( node->TDistribution );
+	  node->TDistribution = NULL;
+	}
+	NumOfTails++;
+      }
+    }
+    for ( const auto& p : todo ){
+      if ( p.left != 0 ){
+	ok = false;
+      }
+    }
+    if ( !ok ){
+      Error( "corrupt tree in binary Instance Base file" );
+      InstBase = 0; // the nodes are cleaned up with the Arena
+    }
+    return (InstBase != NULL);
+  }
+
   bool InstanceBase_base::HasDistributions() const {
     if ( InstBase && InstBase->link ){
       return InstBase->link->TDistribution != NULL;
@@ -903,40 +1624,72 @@ namespace Timbl {
     return result;
   }
 
-  void IBtree::assign_defaults( bool Random, bool persist, size_t level ){
+  void IBtree::assign_default( bool Random, bool persist, size_t level,
+			       int spawn ){
+    // gather the Distribution information of the subtree of this node
+    // and use it to calculate the Default target
+    if ( link ){
+      if ( !TDistribution ){
+	link->assign_defaults( Random, persist, level-1, spawn );
+	TDistribution = link->sum_distributions( level > 1
+						 && persist );
+      }
+    }
+    bool dummy;
+    TValue = TDistribution->BestTarget( dummy, Random );
+  }
+
+  void IBtree::assign_defaults( bool Random, bool persist, size_t level,
+				int spawn ){
     // recursively gather Distribution information up to the top.
     // at each Node we use that info to calculate the Default target.
     // when level > 1 the info might be persistent for IGTREE use
+    // when spawn > 0, the subtrees at this level are independent tasks
     IBtree *pnt = this;
-    bool dummy;
     while ( pnt ){
-      if ( pnt->link ){
-	if ( !pnt->TDistribution ){
-	  pnt->link->assign_defaults( Random, persist, level-1 );
-	  pnt->TDistribution = pnt->link->sum_distributions( level > 1
-							     && persist );
-	}
+      if ( spawn > 0 && pnt->link ){
+#pragma omp task firstprivate( pnt )
+	pnt->assign_default( Random, persist, level, spawn-1 );
+      }
+      else {
+	pnt->assign_default( Random, persist, level, 0 );
       }
-      pnt->TValue = pnt->TDistribution->BestTarget( dummy, Random );
       pnt = pnt->next;
     }
+    if ( spawn > 0 ){
+#pragma omp taskwait
+    }
+  }
+
+  void IBtree::re_assign_default( bool Random, bool persist, int spawn ){
+    if ( link ){
+      delete TDistribution;
+      link->re_assign_defaults( Random, persist, spawn );
+      TDistribution = link->sum_distributions( persist );
+    }
+    bool dummy;
+    TValue = TDistribution->BestTarget( dummy, Random );
   }
 
   void IBtree::re_assign_defaults( bool Random,
-				   bool persist ){
+				   bool persist,
+				   int spawn ){
     // recursively gather Distribution information up to the top.
     // at each Node we use that info to calculate the Default target.
     IBtree *pnt = this;
-    bool dummy;
     while ( pnt ){
-      if ( pnt->link ){
-	delete pnt->TDistribution;
-	pnt->link->re_assign_defaults( Random, persist );
-	pnt->TDistribution = pnt->link->sum_distributions( persist );
+      if ( spawn > 0 && pnt->link ){
+#pragma omp task firstprivate( pnt )
+	pnt->re_assign_default( Random, persist, spawn-1 );
+      }
+      else {
+	pnt->re_assign_default( Random, persist, 0 );
       }
-      pnt->TValue = pnt->TDistribution->BestTarget( dummy, Random );
       pnt = pnt->next;
     }
+    if ( spawn > 0 ){
+#pragma omp taskwait
+    }
   }
 
   void IBtree::redo_distributions(){
@@ -950,16 +1703,17 @@ namespace Timbl {
 	pnt->link->redo_distributions();
 	delete pnt->TDistribution;
 	pnt->TDistribution = pnt->link->sum_distributions( false );
-	if ( pnt->FValue->ValFreq() > 0 ){
-	  pnt->FValue->ReconstructDistribution( *(pnt->TDistribution) );
-	}
+	// also when the sum is empty (after a Decrement). That sets ValFreq()
+	// to 0 but the next branch with this value will add to it again
+	pnt->FValue->ReconstructDistribution( *(pnt->TDistribution) );
       }
       pnt = pnt->next;
     }
   }
 
   inline IBtree *IBtree::make_unique( const TargetValue *Top,
-				      unsigned long& cnt ){
+				      unsigned long& cnt,
+				      NodeArena& arena ){
     // remove branches with the same target as the Top, except when they
     // still have a subbranch, which means that they are an exception.
     IBtree *result = this;
@@ -968,9 +1722,8 @@ namespace Timbl {
       if ( (*tmp)->TValue == Top && (*tmp)->link == NULL ){
 	IBtree *dead = *tmp;
 	*tmp = (*tmp)->next;
-	dead->next=NULL;
 	--cnt;
-	delete dead;
+	arena.release( dead );
       }
       else {
 	tmp = &((*tmp)->next);
@@ -983,20 +1736,63 @@ namespace Timbl {
 				 unsigned long& cnt,
 				 long depth,
 				 bool keep_dists,
-				 ClassDistribution*& dist ){
+				 ClassDistribution*& dist,
+				 NodeArena& arena,
+				 int spawn ){
     // recursively cut default nodes, (with make unique,) starting at the
     // leaves of the Tree and moving back to the top.
     // when keep_dists is true, gather the distributions upward.
+    // when spawn > 0, the subtrees at this level are reduced first, as
+    // independent tasks with their own counter and arena. The results are
+    // gathered afterwards, in the same order as the sequential code.
+    vector<IBtree *> links;
+    vector<ClassDistribution *> extras;
+    if ( spawn > 0 ){
+      vector<IBtree *> subs;
+      for ( IBtree *pnt = this; pnt; pnt = pnt->next ){
+	subs.push_back( pnt );
+      }
+      links.resize( subs.size(), 0 );
+      extras.resize( subs.size(), 0 );
+      unsigned long int start = cnt;
+      vector<unsigned long int> counts( subs.size(), start );
+      vector<NodeArena> arenas( subs.size() );
+      for ( size_t i=0; i < subs.size(); ++i ){
+	if ( subs[i]->link != NULL ){
+#pragma omp task firstprivate( i ) shared( subs, links, extras, counts, arenas )
+	  links[i] = subs[i]->link->Reduce( subs[i]->TValue,
+					    counts[i],
+					    depth-1,
+					    keep_dists,
+					    extras[i],
+					    arenas[i],
+					    spawn-1 );
+	}
+      }
+#pragma omp taskwait
+      for ( size_t i=0; i < subs.size(); ++i ){
+	cnt -= start - counts[i];
+	arena.adopt( arenas[i] );
+      }
+    }
     IBtree *pnt = this;
+    size_t pos = 0;
     while ( pnt ){
       if ( keep_dists ){
 	if ( pnt->link != NULL ){
 	  ClassDistribution *extra = 0;
-	  pnt->link = pnt->link->Reduce( pnt->TValue,
-					 cnt,
-					 depth-1,
-					 keep_dists,
-					 extra );
+	  if ( spawn > 0 ){
+	    pnt->link = links[pos];
+	    extra = extras[pos];
+	  }
+	  else {
+	    pnt->link = pnt->link->Reduce( pnt->TValue,
+					   cnt,
+					   depth-1,
+					   keep_dists,
+					   extra,
+					   arena );
+	  }
 	  if ( extra ){
 	    if ( pnt->TDistribution ){
 	      pnt->TDistribution->Merge( *extra );
@@ -1025,18 +1821,25 @@ namespace Timbl {
       }
       else {
 	if ( pnt->link != NULL ){
-	  ClassDistribution *dummy = 0;
-	  pnt->link = pnt->link->Reduce( pnt->TValue,
-					 cnt,
-					 depth-1,
-					 false,
-					 dummy );
+	  if ( spawn > 0 ){
+	    pnt->link = links[pos];
+	  }
+	  else {
+	    ClassDistribution *dummy = 0;
+	    pnt->link = pnt->link->Reduce( pnt->TValue,
+					   cnt,
+					   depth-1,
+					   false,
+					   dummy,
+					   arena );
+	  }
 	}
       }
       pnt = pnt->next;
+      ++pos;
     }
     if ( depth <= 0 ){
-      IBtree *out = make_unique( Top, cnt );
+      IBtree *out = make_unique( Top, cnt, arena );
       return out;
     }
     else {
@@ -1049,10 +1852,10 @@ namespace Timbl {
     }
   }
 
-  const ClassDistribution *IBtree::exact_match( const Instance& Inst ) const {
+  const ClassDistribution *InstanceBase_base::linked_match( const Instance& Inst ) const {
     // Is there an exact match between the Instance and the IB
     // If so, return the best Distribution.
-    const IBtree *pnt = this;
+    const IBtree *pnt = InstBase;
     int pos = 0;
     while ( pnt ){
       if ( pnt->link == NULL ){
@@ -1063,83 +1866,617 @@ namespace Timbl {
 	  return pnt->TDistribution;
 	}
       }
-      else if ( Inst.FV[pos]->isUnknown() ){
-	return NULL;
+      pnt = search_node( pnt, Inst.VI[pos] );
+      if ( pnt ){
+	pnt = pnt->link;
+	pos++;
       }
-      else if ( pnt->FValue == Inst.FV[pos] ){
-	if ( pnt->FValue->ValFreq() == 0 ){
-	  return NULL;
-	}
-	else {
-	  pnt = pnt->link;
-	  pos++;
-	}
+    }
+    return NULL;
+  }
+
+  FrozenTree::FrozenTree( IBtree *tree ):
+    root_count(0)
+  {
+    // lay out the tree breadth-first. Because we visit the parents in
+    // the same order as their children are appended, the children of
+    // every node end up contiguous, right after those of its left
+    // neighbour. So one offset per node suffices.
+    vector<uint32_t> levels;
+    for ( IBtree *pnt = tree; pnt; pnt = pnt->next ){
+      nodes.push_back( pnt );
+      levels.push_back( 0 );
+    }
+    root_count = nodes.size();
+    for ( size_t n=0; n < nodes.size(); ++n ){
+      if ( nodes.size() >= NO_NODE ){
+	throw range_error( "too many nodes for a frozen InstanceBase" );
+      }
+      offsets.push_back( nodes.size() );
+      for ( IBtree *pnt = nodes[n]->link; pnt; pnt = pnt->next ){
+	nodes.push_back( pnt );
+	levels.push_back( levels[n] + 1 );
+      }
+    }
+    offsets.push_back( nodes.size() );
+    ids.reserve( nodes.size() );
+    values.reserve( nodes.size() );
+    dists.reserve( nodes.size() );
+    defaults.reserve( nodes.size() );
+    for ( const auto& pnt : nodes ){
+      defaults.push_back( pnt->TValue );
+      if ( pnt->FValue ){
+	ids.push_back( pnt->FValue->Index() );
       }
       else {
-	pnt = pnt->next;
+	ids.push_back( 0 );
+      }
+      values.push_back( pnt->FValue );
+      if ( pnt->link ){
+	dists.push_back( 0 );
+      }
+      else {
+	dists.push_back( pnt->TDistribution );
+      }
+    }
+    // the children come after their parent, so a backward sweep has
+    // the filters of the children ready when it reaches the parent
+    below.resize( nodes.size(), 0 );
+    for ( size_t n=nodes.size(); n > 0; --n ){
+      uint64_t filter = 0;
+      for ( uint32_t c=offsets[n-1]; c < offsets[n]; ++c ){
+	filter |= below[c];
+	if ( values[c] ){
+	  filter |= filter_bit( levels[c], ids[c] );
+	}
       }
+      below[n-1] = filter;
+    }
+    hashed.resize( nodes.size(), false );
+    index_range( 0, root_count );
+    for ( size_t n=0; n < nodes.size(); ++n ){
+      index_range( offsets[n], offsets[n+1] );
     }
-    return NULL;
   }
 
-  InstanceBase_base::InstanceBase_base( size_t depth,
-					unsigned long int&cnt,
-					bool Rand,
-					bool persist ):
-    DefAss( false ),
-    DefaultsValid( false ),
-    Random( Rand ),
-    PersistentDistributions( persist ),
-    Pruned( false ),
-    Version( 4 ),
-    TopDistribution( new ClassDistribution ),
-    WTop( 0 ),
-    TopT( 0 ),
-    tiedTop(false),
-    InstBase( 0 ),
-    LastInstBasePos( 0 ),
-    ibCount( cnt ),
-    Depth( depth ),
-    NumOfTails( 0 )
-    {
-      InstPath.resize(depth,0);
+  void FrozenTree::index_range( uint32_t first, uint32_t last ){
+    // decide how the siblings [first,last) are searched.
+    // only ranges that can't use a linear scan or binary search
+    // get a hash table
+    if ( last - first <= LINEAR_LIMIT ){
+      return;
+    }
+    bool sorted = true;
+    for ( uint32_t n=first+1; n < last && sorted; ++n ){
+      sorted = ids[n-1] < ids[n];
+    }
+    if ( sorted && last - first <= HASH_LIMIT ){
+      return;
+    }
+    uint32_t size = 1;
+    while ( size < 2*(last - first) ){
+      size <<= 1;
+    }
+    child_hash h;
+    h.start = hash_pool.size();
+    h.mask = size - 1;
+    hash_pool.resize( hash_pool.size() + size, NO_NODE );
+    for ( uint32_t n=first; n < last; ++n ){
+      uint32_t slot = hash_slot( ids[n], h.mask );
+      while ( hash_pool[h.start+slot] != NO_NODE ){
+	slot = ( slot + 1 ) & h.mask;
+      }
+      hash_pool[h.start+slot] = n;
+    }
+    hashes[first] = h;
+    hashed[first] = true;
+  }
+
+  void FrozenTree::refresh_defaults(){
+    // the defaults in the IBtree are (re)assigned, copy them again
+    for ( size_t n=0; n < nodes.size(); ++n ){
+      defaults[n] = nodes[n]->TValue;
+    }
+  }
+
+  size_t FrozenTree::NumBytes() const {
+    return offsets.size() * sizeof(uint32_t)
+      + ids.size() * ( sizeof(uint32_t)
+		       + sizeof(FeatureValue *)
+		       + sizeof(ClassDistribution *)
+		       + sizeof(const TargetValue *)
+		       + sizeof(uint64_t)
+		       + sizeof(IBtree *) )
+      + hashed.size() / 8
+      + hashes.size() * ( sizeof(uint32_t) + sizeof(child_hash) )
+      + hash_pool.size() * sizeof(uint32_t);
+  }
+
+  uint32_t FrozenTree::search_node( uint32_t first,
+				    uint32_t last,
+				    uint32_t id ) const {
+    // look for the value with this id in the siblings [first,last)
+    // we only compare id's, which are stored contiguous
+    if ( id == Instance::UnknownId || first >= last ){
+      return NO_NODE;
+    }
+    if ( last - first <= LINEAR_LIMIT ){
+      for ( uint32_t n=first; n < last; ++n ){
+	if ( ids[n] == id ){
+	  return n;
+	}
+      }
+    }
+    else if ( !hashed[first] ){
+      auto const begin = ids.begin();
+      auto const it = lower_bound( begin + first, begin + last, id );
+      if ( it != begin + last && *it == id ){
+	return it - begin;
+      }
+    }
+    else {
+      const child_hash& h = hashes.find( first )->second;
+      uint32_t slot = hash_slot( id, h.mask );
+      uint32_t n;
+      while ( ( n = hash_pool[h.start+slot] ) != NO_NODE ){
+	if ( ids[n] == id ){
+	  return n;
+	}
+	slot = ( slot + 1 ) & h.mask;
+      }
+    }
+    return NO_NODE;
+  }
+
+  const ClassDistribution *FrozenTree::exact_match( const Instance& Inst ) const {
+    // same as IBtree::exact_match(), but on the frozen layout
+    if ( root_count == 0 ){
+      return NULL;
+    }
+    uint32_t first = 0;
+    uint32_t last = root_count;
+    size_t pos = 0;
+    while ( first < last ){
+      if ( is_leaf( first ) ){
+	if ( dists[first]->ZeroDist() ){
+	  return NULL;
+	}
+	else {
+	  return dists[first];
+	}
+      }
+      uint32_t n = search_node( first, last, Inst.VI[pos] );
+      if ( n == NO_NODE ){
+	return NULL;
+      }
+      first = offsets[n];
+      last = offsets[n+1];
+      ++pos;
+    }
+    return NULL;
+  }
+
+  bool FrozenTree::replace_distribution( const Instance& Inst,
+					 const IBtree *leaf ){
+    // copy-on-write gave 'leaf' a private distribution. Point to that one
+    // instead of the shared one. Returns false when leaf isn't found
+    uint32_t first = 0;
+    uint32_t last = root_count;
+    size_t pos = 0;
+    while ( first < last ){
+      uint32_t n = is_leaf( first ) ? first
+	: search_node( first, last, Inst.VI[pos] );
+      if ( n == NO_NODE ){
+	break;
+      }
+      if ( nodes[n] == leaf ){
+	dists[n] = leaf->TDistribution;
+	return true;
+      }
+      first = offsets[n];
+      last = offsets[n+1];
+      ++pos;
+    }
+    return false;
+  }
+
+#if defined(__AVX__)
+  // 4 doubles at a time
+#define DENSE_SIMD 4
+  using dvec = __m256d;
+  inline dvec dv_load( const double *p ){ return _mm256_loadu_pd( p ); }
+  inline void dv_store( double *p, dvec v ){ _mm256_storeu_pd( p, v ); }
+  inline dvec dv_set( double d ){ return _mm256_set1_pd( d ); }
+  inline dvec dv_add( dvec a, dvec b ){ return _mm256_add_pd( a, b ); }
+  inline dvec dv_sub( dvec a, dvec b ){ return _mm256_sub_pd( a, b ); }
+  inline dvec dv_mul( dvec a, dvec b ){ return _mm256_mul_pd( a, b ); }
+  inline dvec dv_div( dvec a, dvec b ){ return _mm256_div_pd( a, b ); }
+  inline dvec dv_sqrt( dvec a ){ return _mm256_sqrt_pd( a ); }
+  inline dvec dv_abs( dvec a ){
+    return _mm256_andnot_pd( _mm256_set1_pd( -0.0 ), a ); }
+#elif defined(__SSE2__)
+  // 2 doubles at a time
+#define DENSE_SIMD 2
+  using dvec = __m128d;
+  inline dvec dv_load( const double *p ){ return _mm_loadu_pd( p ); }
+  inline void dv_store( double *p, dvec v ){ _mm_storeu_pd( p, v ); }
+  inline dvec dv_set( double d ){ return _mm_set1_pd( d ); }
+  inline dvec dv_add( dvec a, dvec b ){ return _mm_add_pd( a, b ); }
+  inline dvec dv_sub( dvec a, dvec b ){ return _mm_sub_pd( a, b ); }
+  inline dvec dv_mul( dvec a, dvec b ){ return _mm_mul_pd( a, b ); }
+  inline dvec dv_div( dvec a, dvec b ){ return _mm_div_pd( a, b ); }
+  inline dvec dv_sqrt( dvec a ){ return _mm_sqrt_pd( a ); }
+  inline dvec dv_abs( dvec a ){
+    return _mm_andnot_pd( _mm_set1_pd( -0.0 ), a ); }
+#endif
+
+  DenseBase::DenseBase( const IBtree *tree, size_t d ):
+    depth( d ),
+    all_numeric( true )
+  {
+    vector<FeatureValue *> path( depth, 0 );
+    add_rows( tree, 0, path );
+    size_t num = rows();
+    matrix.resize( depth * num );
+    for ( size_t r=0; r < num; ++r ){
+      for ( size_t f=0; f < depth; ++f ){
+	const FeatureValue *fv = values[r*depth+f];
+	if ( fv->isNumeric() ){
+	  matrix[f*num+r] = fv->numericValue();
+	}
+	else {
+	  // the similarity metrics take this as 0
+	  all_numeric = false;
+	}
+      }
+    }
+  }
+
+  void DenseBase::add_rows( const IBtree *pnt,
+			    size_t level,
+			    vector<FeatureValue *>& path ){
+    // walk the tree depth first. every full path gives a row
+    for ( ; pnt; pnt = pnt->next ){
+      if ( level == depth ){
+	values.insert( values.end(), path.begin(), path.end() );
+	dists.push_back( pnt->TDistribution );
+	return;
+      }
+      path[level] = pnt->FValue;
+      add_rows( pnt->link, level+1, path );
+    }
+  }
+
+  size_t DenseBase::NumBytes() const {
+    return matrix.size() * sizeof(double)
+      + values.size() * sizeof(FeatureValue *)
+      + dists.size() * sizeof(ClassDistribution *);
+  }
+
+  // The kernels below do the same calculations as the Metric classes, in
+  // the same order. The SIMD versions only handle several rows at a time.
+
+  void DenseBase::add_numeric( size_t f, double q, double scale, double w,
+			       double *dist ) const {
+    size_t num = rows();
+    const double *col = &matrix[f*num];
+    size_t r = 0;
+#ifdef DENSE_SIMD
+    const dvec vq = dv_set( q );
+    const dvec vs = dv_set( scale );
+    const dvec vw = dv_set( w );
+    for ( ; r + DENSE_SIMD <= num; r += DENSE_SIMD ){
+      dvec d = dv_abs( dv_div( dv_sub( vq, dv_load( col+r ) ), vs ) );
+      dv_store( dist+r, dv_add( dv_load( dist+r ), dv_mul( d, vw ) ) );
+    }
+#endif
+    for ( ; r < num; ++r ){
+      dist[r] += fabs( (q - col[r]) / scale ) * w;
+    }
+  }
+
+  void DenseBase::add_euclidean( size_t f, double q, double scale, double w,
+				 double *dist ) const {
+    size_t num = rows();
+    const double *col = &matrix[f*num];
+    const double qq = q*q;
+    size_t r = 0;
+#ifdef DENSE_SIMD
+    const dvec vqq = dv_set( qq );
+    const dvec vs = dv_set( scale );
+    const dvec vw = dv_set( w );
+    for ( ; r + DENSE_SIMD <= num; r += DENSE_SIMD ){
+      dvec x = dv_load( col+r );
+      dvec d = dv_div( dv_sqrt( dv_abs( dv_sub( vqq, dv_mul( x, x ) ) ) ),
+		       vs );
+      dv_store( dist+r, dv_add( dv_load( dist+r ), dv_mul( d, vw ) ) );
+    }
+#endif
+    for ( ; r < num; ++r ){
+      dist[r] += sqrt( fabs( qq - col[r]*col[r] ) ) / scale * w;
+    }
+  }
+
+  void DenseBase::add_product( size_t f, double q, double w,
+			       double *dist ) const {
+    size_t num = rows();
+    const double *col = &matrix[f*num];
+    size_t r = 0;
+#ifdef DENSE_SIMD
+    const dvec vq = dv_set( q );
+    const dvec vw = dv_set( w );
+    for ( ; r + DENSE_SIMD <= num; r += DENSE_SIMD ){
+      dvec d = dv_mul( vq, dv_load( col+r ) );
+      dv_store( dist+r, dv_add( dv_load( dist+r ), dv_mul( d, vw ) ) );
+    }
+#endif
+    for ( ; r < num; ++r ){
+      dist[r] += ( q * col[r] ) * w;
+    }
+  }
+
+  void DenseBase::add_square( size_t f, double w, double *dist ) const {
+    size_t num = rows();
+    const double *col = &matrix[f*num];
+    size_t r = 0;
+#ifdef DENSE_SIMD
+    const dvec vw = dv_set( w );
+    for ( ; r + DENSE_SIMD <= num; r += DENSE_SIMD ){
+      dvec x = dv_load( col+r );
+      dv_store( dist+r, dv_add( dv_load( dist+r ), dv_mul( dv_mul( x, x ), vw ) ) );
+    }
+#endif
+    for ( ; r < num; ++r ){
+      dist[r] += ( col[r] * col[r] ) * w;
+    }
+  }
+
+  InstanceBase_base::InstanceBase_base( size_t depth,
+					unsigned long int&cnt,
+					bool Rand,
+					bool persist ):
+    DefAss( false ),
+    DefaultsValid( false ),
+    Random( Rand ),
+    PersistentDistributions( persist ),
+    Pruned( false ),
+    Version( 4 ),
+    TopDistribution( new ClassDistribution ),
+    WTop( 0 ),
+    TopT( 0 ),
+    tiedTop(false),
+    InstBase( 0 ),
+    LastInstBasePos( 0 ),
+    FrozenBase( 0 ),
+    DenseRows( 0 ),
+    ExactIndex( 0 ),
+    PartitionView( 0 ),
+    IsPartition( false ),
+    SortFeatures( 0 ),
+    SortLimit( 1 ),
+    ibCount( cnt ),
+    Depth( depth ),
+    NumOfTails( 0 ),
+    NumThreads( 1 )
+    {
+      InstPath.resize(depth,0);
       RestartSearch.resize(depth,0);
       SkipSearch.resize(depth,0);
     }
 
   InstanceBase_base::~InstanceBase_base(){
-    // the Instance can become very large, with even millions of 'next' pointers
-    // so recursive deletion will use a lot of stack
-    // therefore we choose to iterate the first level(s).
-    IBtree *pnt1 = InstBase;
-    while ( pnt1 ){
-      IBtree *toDel1 = pnt1;
-      pnt1 = pnt1->next;
-      toDel1->next = 0;
-      IBtree *pnt2 = toDel1->link;
-      toDel1->link = 0;
-      while ( pnt2 ){
-	IBtree *toDel2 = pnt2;
-	pnt2 = pnt2->next;
-	toDel2->next = 0;
-	IBtree *pnt3 = toDel2->link;
-	toDel2->link = 0;
-	while ( pnt3 ){
-	  IBtree *toDel3 = pnt3;
-	  pnt3 = pnt3->next;
-	  toDel3->next = 0;
-	  delete toDel3;
-	}
-	delete toDel2;
-      }
-      delete toDel1;
-    }
+    // the nodes of InstBase are all owned by Arena, which cleans them up
+    // without walking the tree. Copies and partitions have an empty Arena.
+    if ( PartitionView ){
+      PartitionView->CleanPartition( true );
+    }
+    delete FrozenBase;
+    delete DenseRows;
+    delete ExactIndex;
     delete TopDistribution;
     delete WTop;
   }
 
+  bool InstanceBase_base::Freeze(){
+    // build a read-only flat copy of the tree for faster testing.
+    // Any structural change to the tree will Thaw() it again
+    if ( !FrozenBase && InstBase ){
+      try {
+	FrozenBase = new FrozenTree( InstBase );
+      }
+      catch ( const range_error& e ){
+	Warning( string("unable to freeze the InstanceBase: ") + e.what() );
+	return false;
+      }
+    }
+    return FrozenBase != 0;
+  }
+
+  void InstanceBase_base::Thaw(){
+    // forget the read-only copies and indexes, they don't follow changes
+    // to the tree
+    Children.clear();
+    delete FrozenBase;
+    FrozenBase = 0;
+    delete DenseRows;
+    DenseRows = 0;
+  }
+
+  void InstanceBase_base::distribution_copied( const Instance& Inst,
+					       const IBtree *leaf ){
+    // copy-on-write gave leaf a private distribution. The frozen copy
+    // can follow that, the dense copy has to go
+    if ( FrozenBase
+	 && !FrozenBase->replace_distribution( Inst, leaf ) ){
+      Thaw();
+    }
+    delete DenseRows;
+    DenseRows = 0;
+  }
+
+  ClassDistribution *IBtree::copy_distribution() const {
+    // the distribution for a copy of this node. Those of the leafs are
+    // counted, so they are shared. The others are changed in place by
+    // AssignDefaults(), so they are copied.
+    if ( !TDistribution ){
+      return 0;
+    }
+    if ( link ){
+      return TDistribution->Copy();
+    }
+    TDistribution->AddOwner();
+    return TDistribution;
+  }
+
+  IBtree *InstanceBase_base::copy_node( IBtree *node ){
+    // a private copy of a node that is shared with a published version.
+    // The children and siblings are still shared
+    IBtree *result = Arena.alloc( node->FValue );
+    result->TValue = node->TValue;
+    result->TDistribution = node->copy_distribution();
+    result->link = node->link;
+    result->next = node->next;
+    if ( node == LastInstBasePos ){
+      LastInstBasePos = result;
+    }
+    Arena.release( node ); // only counted, the version still uses it
+    return result;
+  }
+
+  IBtree *InstanceBase_base::copy_tree( const IBtree *pnt ){
+    // a private copy of a whole (sub)tree
+    IBtree *result = 0;
+    IBtree **tail = &result;
+    while ( pnt ){
+      *tail = Arena.alloc( pnt->FValue );
+      (*tail)->TValue = pnt->TValue;
+      (*tail)->TDistribution = pnt->copy_distribution();
+      (*tail)->link = copy_tree( pnt->link );
+      tail = &((*tail)->next);
+      pnt = pnt->next;
+    }
+    return result;
+  }
+
+  void InstanceBase_base::unshare_path( const Instance& Inst ){
+    // Inst is about to be added or removed. Every node that this changes,
+    // but is shared with a published version, is replaced by a copy first.
+    // In a list of siblings, that includes the nodes before it, because
+    // their next pointers change too
+    if ( !Arena.IsShared() ){
+      return;
+    }
+    bool copied = false;
+    IBtree **slot = &InstBase;
+    for ( size_t i=0; i < Depth && *slot; ++i ){
+      const FeatureValue *FV = Inst.FV[i];
+      if ( !FV ){
+	break;
+      }
+      IBtree **pnt = slot;
+      while ( *pnt && (*pnt)->FValue->Index() < FV->Index() ){
+	if ( Arena.Sealed( *pnt ) ){
+	  *pnt = copy_node( *pnt );
+	  copied = true;
+	}
+	pnt = &((*pnt)->next);
+      }
+      if ( !*pnt || (*pnt)->FValue != FV ){
+	// the rest of the path is new
+	slot = 0;
+	break;
+      }
+      if ( Arena.Sealed( *pnt ) ){
+	*pnt = copy_node( *pnt );
+	copied = true;
+      }
+      slot = &((*pnt)->link);
+    }
+    if ( slot && *slot && Arena.Sealed( *slot ) ){
+      // the leaf
+      *slot = copy_node( *slot );
+      copied = true;
+      if ( ExactIndex ){
+	ExactIndex->insert( Inst.VI.data(), *slot );
+      }
+    }
+    if ( copied ){
+      Thaw();
+    }
+  }
+
+  void InstanceBase_base::Unshare(){
+    // the whole tree is about to change (AssignDefaults, Prune...), so we
+    // need a private copy of all of it. The published versions keep the
+    // old nodes
+    if ( !Arena.IsShared() ){
+      return;
+    }
+    NodeArena old_arena;
+    old_arena.swap( Arena );
+    InstBase = copy_tree( InstBase );
+    LastInstBasePos = InstBase;
+    while ( LastInstBasePos && LastInstBasePos->next ){
+      LastInstBasePos = LastInstBasePos->next;
+    }
+    Thaw();
+    if ( ExactIndex ){
+      delete ExactIndex;
+      ExactIndex = 0;
+      IndexExact();
+    }
+  }
+
+  InstanceBase_base *InstanceBase_base::Share( unsigned long int& cnt ){
+    // a read-only InstanceBase for a published version, that counts its
+    // nodes in cnt. All nodes and distributions are shared with us. From
+    // now on, we copy what we change (see unshare_path()), until most
+    // of our nodes are copies, then we start afresh with a private tree
+    if ( Arena.Garbage() > ibCount ){
+      Unshare();
+    }
+    Arena.Seal();
+    InstanceBase_base *result = clone( cnt );
+    result->Arena.Share( Arena );
+    result->InstBase = InstBase;
+    result->LastInstBasePos = LastInstBasePos;
+    result->DefAss = DefAss;
+    result->DefaultsValid = DefaultsValid;
+    result->Pruned = Pruned;
+    result->NumOfTails = NumOfTails;
+    result->NumThreads = NumThreads;
+    delete result->TopDistribution;
+    result->TopDistribution = TopDistribution->Copy();
+    if ( WTop ){
+      result->WTop = WTop->to_WVD_Copy();
+    }
+    // the read-only copies describe the shared nodes, so they can go to
+    // the version. We build new ones when we need them again
+    result->FrozenBase = FrozenBase;
+    FrozenBase = 0;
+    result->DenseRows = DenseRows;
+    DenseRows = 0;
+    result->ExactIndex = ExactIndex;
+    ExactIndex = 0;
+    return result;
+  }
+
+  bool InstanceBase_base::MakeDense(){
+    // build a dense matrix of all full paths, for a brute force search.
+    // a pruned tree has no full paths
+    if ( !DenseRows && InstBase && !Pruned ){
+      DenseRows = new DenseBase( InstBase, Depth );
+    }
+    return DenseRows != 0;
+  }
+
   IB_InstanceBase *IB_InstanceBase::clone() const {
-    return new IB_InstanceBase( Depth, ibCount, Random );
+    return clone( ibCount );
+  }
+
+  IB_InstanceBase *IB_InstanceBase::clone( unsigned long int& cnt ) const {
+    // a new, empty InstanceBase that counts its nodes in cnt
+    return new IB_InstanceBase( Depth, cnt, Random );
   }
 
   IB_InstanceBase *IB_InstanceBase::Copy() const {
@@ -1149,13 +2486,20 @@ namespace Timbl {
     result->NumOfTails = NumOfTails; // only usefull for Server???
     result->InstBase = InstBase;
     result->LastInstBasePos = LastInstBasePos;
+    result->FrozenBase = FrozenBase;
+    result->DenseRows = DenseRows;
+    result->ExactIndex = ExactIndex;
     delete result->TopDistribution;
     result->TopDistribution = TopDistribution;
     return result;
   }
 
   IG_InstanceBase *IG_InstanceBase::clone() const {
-    return new IG_InstanceBase( Depth, ibCount,
+    return clone( ibCount );
+  }
+
+  IG_InstanceBase *IG_InstanceBase::clone( unsigned long int& cnt ) const {
+    return new IG_InstanceBase( Depth, cnt,
 				Random, Pruned, PersistentDistributions );
   }
 
@@ -1167,6 +2511,9 @@ namespace Timbl {
     result->NumOfTails = NumOfTails; // only usefull for Server???
     result->InstBase = InstBase;
     result->LastInstBasePos = LastInstBasePos;
+    result->FrozenBase = FrozenBase;
+    result->DenseRows = DenseRows;
+    result->ExactIndex = ExactIndex;
     delete result->TopDistribution;
     result->TopDistribution = TopDistribution;
     return result;
@@ -1199,7 +2546,11 @@ namespace Timbl {
   }
 
   TRIBL_InstanceBase *TRIBL_InstanceBase::clone() const {
-    return new TRIBL_InstanceBase( Depth, ibCount,
+    return clone( ibCount );
+  }
+
+  TRIBL_InstanceBase *TRIBL_InstanceBase::clone( unsigned long int& cnt ) const {
+    return new TRIBL_InstanceBase( Depth, cnt,
 				   Random, PersistentDistributions );
   }
 
@@ -1211,13 +2562,20 @@ namespace Timbl {
     result->NumOfTails = NumOfTails; // only usefull for Server???
     result->InstBase = InstBase;
     result->LastInstBasePos = LastInstBasePos;
+    result->FrozenBase = FrozenBase;
+    result->DenseRows = DenseRows;
+    result->ExactIndex = ExactIndex;
     delete result->TopDistribution;
     result->TopDistribution = TopDistribution;
     return result;
   }
 
   TRIBL2_InstanceBase *TRIBL2_InstanceBase::clone() const {
-    return new TRIBL2_InstanceBase( Depth, ibCount,
+    return clone( ibCount );
+  }
+
+  TRIBL2_InstanceBase *TRIBL2_InstanceBase::clone( unsigned long int& cnt ) const {
+    return new TRIBL2_InstanceBase( Depth, cnt,
 				    Random, PersistentDistributions );
   }
 
@@ -1228,74 +2586,96 @@ namespace Timbl {
     result->NumOfTails = NumOfTails; // only usefull for Server???
     result->InstBase = InstBase;
     result->LastInstBasePos = LastInstBasePos;
+    result->FrozenBase = FrozenBase;
+    result->DenseRows = DenseRows;
+    result->ExactIndex = ExactIndex;
     delete result->TopDistribution;
     result->TopDistribution = TopDistribution;
     return result;
   }
 
-  IB_InstanceBase* TRIBL_InstanceBase::IBPartition( IBtree *sub ) const {
-    int i=0;
+  IB_InstanceBase* InstanceBase_base::IBPartition( IBtree *sub ){
+    // Return an IB_InstanceBase view on the subtree 'sub', for TRIBL and
+    // TRIBL2 testing.
+    // The view is created once, and then re-pointed for every test, so no
+    // allocations are done per instance. It is owned by this InstanceBase
+    // so Copies (one per thread) each have their own.
+    size_t i=0;
     IBtree *tmp = sub;
     while ( tmp && tmp->link ){
       i++;
       tmp = tmp->link;
     }
-    IB_InstanceBase *result =
-      new IB_InstanceBase( i, ibCount, Random );
+    if ( !PartitionView ){
+      PartitionView = new IB_InstanceBase( Depth, ibCount, Random );
+      PartitionView->IsPartition = true;
+    }
+    IB_InstanceBase *result = PartitionView;
+    result->Depth = i;
     result->DefAss = DefAss;
     result->DefaultsValid = DefaultsValid;
     result->NumOfTails = NumOfTails; // only usefull for Server???
     result->InstBase = sub;
-    if ( sub ){
-      delete result->TopDistribution;
-      result->TopDistribution =
-	sub->sum_distributions( false  );
-    }
+    result->SortFeatures = SortFeatures;
+    result->SortLimit = SortLimit;
     return result;
   }
 
-  IB_InstanceBase* TRIBL2_InstanceBase::IBPartition( IBtree *sub ) const {
-    int i=0;
-    IBtree *tmp = sub;
-    while ( tmp && tmp->link ){
-      i++;
-      tmp = tmp->link;
-    }
-    IB_InstanceBase *result =
-      new IB_InstanceBase( i, ibCount, Random );
-    result->DefAss = DefAss;
-    result->DefaultsValid = DefaultsValid;
-    result->NumOfTails = NumOfTails; // only usefull for Server???
-    result->InstBase = sub;
-    if ( sub ){
-      delete result->TopDistribution;
-      result->TopDistribution =
-	sub->sum_distributions( false  );
-    }
-    return result;
+  void InstanceBase_base::BestFirst( const vector<const Feature *> *feats,
+				     int limit ){
+    // when feats is given, InitGraphTest() and NextGraphTest() visit the
+    // siblings on every level with a feature in feats in order of
+    // increasing distance to the value of the test instance
+    SortFeatures = feats;
+    SortLimit = limit;
   }
 
   void InstanceBase_base::CleanPartition( bool distToo ){
     InstBase = 0; // prevent deletion of InstBase in next step!
+    FrozenBase = 0; // idem, it is shared with the original
+    DenseRows = 0; // idem
+    ExactIndex = 0; // idem
     if ( !distToo ){
       TopDistribution = 0; // save TopDistribution for deletion
     }
     delete this;
   }
 
+  int InstanceBase_base::spawn_levels() const {
+    // the number of tree levels that are split into parallel tasks.
+    // Random tie resolving depends on the order of the calls, so then
+    // we stay sequential.
+    if ( NumThreads > 1 && !Random ){
+      return 2;
+    }
+    return 0;
+  }
+
   void InstanceBase_base::AssignDefaults(){
     if ( !DefaultsValid ){
-      if ( !DefAss ){
-	InstBase->assign_defaults( Random,
-				   PersistentDistributions,
-				   Depth );
-      }
-      else {
-	InstBase->re_assign_defaults( Random, PersistentDistributions );
+      Unshare();
+      int spawn = spawn_levels();
+#pragma omp parallel num_threads( NumThreads ) if ( spawn > 0 )
+#pragma omp single
+      {
+	if ( !DefAss ){
+	  InstBase->assign_defaults( Random,
+				     PersistentDistributions,
+				     Depth,
+				     spawn );
+	}
+	else {
+	  InstBase->re_assign_defaults( Random,
+					PersistentDistributions,
+					spawn );
+	}
       }
       ClassDistribution *Top
 	= InstBase->sum_distributions( PersistentDistributions );
       delete Top; // still a bit silly but the Top Distribution is known
+      if ( FrozenBase ){
+	FrozenBase->refresh_defaults();
+      }
     }
     DefAss = true;
     DefaultsValid = true;
@@ -1307,7 +2687,16 @@ namespace Timbl {
       DefaultsValid = false;
     }
     if ( !DefaultsValid ){
-      InstBase->assign_defaults( Random, PersistentDistributions, Threshold );
+      int spawn = spawn_levels();
+#pragma omp parallel num_threads( NumThreads ) if ( spawn > 0 )
+#pragma omp single
+      InstBase->assign_defaults( Random,
+				 PersistentDistributions,
+				 Threshold,
+				 spawn );
+      if ( FrozenBase ){
+	FrozenBase->refresh_defaults();
+      }
     }
     DefAss = true;
     DefaultsValid = true;
@@ -1324,9 +2713,17 @@ namespace Timbl {
       throw runtime_error( "cannot prune a pruned instancebase" );
     }
     else {
+      Unshare();
       AssignDefaults( );
+      Thaw();
+      delete ExactIndex; // a pruned tree has no full paths
+      ExactIndex = 0;
       ClassDistribution *cd = NULL;
-      InstBase = InstBase->Reduce( top, ibCount, depth, keep_dists, cd );
+      int spawn = spawn_levels();
+#pragma omp parallel num_threads( NumThreads ) if ( spawn > 0 )
+#pragma omp single
+      InstBase = InstBase->Reduce( top, ibCount, depth, keep_dists, cd,
+				   Arena, spawn );
       if ( cd ){
 	delete cd;
       }
@@ -1341,9 +2738,17 @@ namespace Timbl {
       throw runtime_error( "cannot prune a pruned instancebase" );
     }
     else {
+      Unshare();
       AssignDefaults( );
+      Thaw();
+      delete ExactIndex; // a pruned tree has no full paths
+      ExactIndex = 0;
       ClassDistribution *cd = NULL;
-      InstBase = InstBase->Reduce( top, ibCount, depth, keep_dists, cd );
+      int spawn = spawn_levels();
+#pragma omp parallel num_threads( NumThreads ) if ( spawn > 0 )
+#pragma omp single
+      InstBase = InstBase->Reduce( top, ibCount, depth, keep_dists, cd,
+				   Arena, spawn );
       Pruned = true;
     }
   }
@@ -1361,14 +2766,19 @@ namespace Timbl {
     }
     bool dummy;
     InstBase->TValue = dist.BestTarget( dummy, Random );
+    Thaw();
+    delete ExactIndex;
+    ExactIndex = 0;
     ClassDistribution *cd = NULL;
-    InstBase = InstBase->Reduce( top, ibCount, 0, false, cd );
+    InstBase = InstBase->Reduce( top, ibCount, 0, false, cd, Arena );
     Pruned = true;
   }
 
   bool InstanceBase_base::AddInstance( const Instance& Inst ){
     bool sw_conflict = false;
     // add one instance to the IB
+    unsigned long int old_count = ibCount;
+    unshare_path( Inst );
     IBtree *hlp;
     IBtree **pnt = &InstBase;
 #ifdef IBSTATS
@@ -1378,7 +2788,7 @@ namespace Timbl {
 #endif
     if ( !InstBase ){
       for ( unsigned int i = 0; i < Depth; ++i ){
-	*pnt = new IBtree( Inst.FV[i] );
+	*pnt = Arena.alloc( Inst.FV[i] );
 	++ibCount;
 	pnt = &((*pnt)->link);
       }
@@ -1387,9 +2797,9 @@ namespace Timbl {
     else {
       for ( unsigned int i = 0; i < Depth; ++i ){
 #ifdef IBSTATS
-	hlp = IBtree::add_feat_val( Inst.FV[i], mismatch[i], *pnt, ibCount );
+	hlp = IBtree::add_feat_val( Inst.FV[i], mismatch[i], *pnt, ibCount, Arena );
 #else
-	hlp = IBtree::add_feat_val( Inst.FV[i], *pnt, ibCount );
+	hlp = IBtree::add_feat_val( Inst.FV[i], *pnt, ibCount, Arena );
 #endif
 	if ( i==0 && hlp->next == 0 ){
 	  LastInstBasePos = hlp;
@@ -1397,31 +2807,50 @@ namespace Timbl {
 	pnt = &(hlp->link);
       }
     }
+    int occ = Inst.Occurrences();
+    const ClassDistribution *old_dist = *pnt ? (*pnt)->TDistribution : 0;
     if ( *pnt == NULL ){
-      *pnt = new IBtree();
+      *pnt = Arena.alloc();
       ++ibCount;
       if ( abs( Inst.ExemplarWeight() ) > Epsilon ){
 	(*pnt)->TDistribution = new WClassDistribution();
+	sw_conflict = (*pnt)->TDistribution->IncFreq( Inst.TV, occ,
+						      Inst.ExemplarWeight() );
       }
       else {
-	(*pnt)->TDistribution = new ClassDistribution;
+	(*pnt)->TDistribution = Pool.single( Inst.TV, occ );
       }
       NumOfTails++;
+      if ( ExactIndex ){
+	ExactIndex->insert( Inst.VI.data(), *pnt );
+      }
     }
-    int occ = Inst.Occurrences();
-    if ( abs( Inst.ExemplarWeight() ) > Epsilon ){
-      sw_conflict = (*pnt)->TDistribution->IncFreq( Inst.TV, occ,
-						    Inst.ExemplarWeight() );
+    else if ( abs( Inst.ExemplarWeight() ) > Epsilon ){
+      sw_conflict = (*pnt)->own_distribution()->IncFreq( Inst.TV, occ,
+							 Inst.ExemplarWeight() );
     }
     else {
-      (*pnt)->TDistribution->IncFreq(Inst.TV, occ );
+      (*pnt)->own_distribution()->IncFreq(Inst.TV, occ );
     }
     TopDistribution->IncFreq(Inst.TV, occ );
     DefaultsValid = false;
+    if ( ibCount != old_count ){
+      // the tree has grown. a frozen copy is outdated
+      Thaw();
+    }
+    else if ( (*pnt)->TDistribution != old_dist ){
+      distribution_copied( Inst, *pnt );
+    }
     return !sw_conflict;
   }
 
   bool InstanceBase_base::MergeSub( InstanceBase_base *ib ){
+    Unshare();
+    Thaw();
+    delete ExactIndex; // IndexExact() builds it again
+    ExactIndex = 0;
+    Arena.adopt( ib->Arena );
+    Pool.adopt( ib->Pool );
     if ( ib->InstBase ){
       // we place the InstanceBase of ib in front of the current InstanceBase
       // the assumption is that both are sorted on ascending index, and that
@@ -1465,8 +2894,7 @@ namespace Timbl {
   void IBtree::cleanDistributions() {
     IBtree *pnt = this;
     while ( pnt ){
-      delete pnt->TDistribution;
-      pnt->TDistribution = 0;
+      pnt->drop_distribution();
       if ( pnt->link ){
 	pnt->link->cleanDistributions();
       }
@@ -1475,6 +2903,10 @@ namespace Timbl {
   }
 
   bool IG_InstanceBase::MergeSub( InstanceBase_base *ib ){
+    Unshare();
+    Thaw();
+    Arena.adopt( ib->Arena );
+    Pool.adopt( ib->Pool );
     if ( ib->InstBase ){
       if ( !PersistentDistributions ){
 	ib->InstBase->cleanDistributions();
@@ -1497,17 +2929,14 @@ namespace Timbl {
 	    // this may happen
 	    // snip the link and insert at our link
 	    IBtree *snip = ibPnt->link;
-	    ibPnt->link = 0;
-	    delete ibPnt->TDistribution;
-	    ibPnt->TDistribution = 0;
 	    --ib->ibCount;
-	    delete ibPnt;
+	    Arena.release( ibPnt );
 	    while ( snip ){
 	      if ( PersistentDistributions ){
 		(*pnt)->TDistribution->Merge( *snip->TDistribution );
 	      }
 	      else {
-		delete snip->TDistribution;
+		snip->drop_distribution();
 	      }
 	      IBtree **tmp = &(*pnt)->link;
 	      while ( *tmp && (*tmp)->FValue->Index() < snip->FValue->Index() ){
@@ -1553,13 +2982,19 @@ namespace Timbl {
   }
 
   void InstanceBase_base::RemoveInstance( const Instance& Inst ){
+    unshare_path( Inst );
     for ( int occ=0; occ < Inst.Occurrences(); ++occ ){
       // remove an instance from the IB
       int pos = 0;
       IBtree *pnt = InstBase;
       while ( pnt ){
 	if ( pnt->link == NULL ){
-	  pnt->TDistribution->DecFreq(Inst.TV);
+	  // the leaf stays in the tree, so an ExactIndex is still valid
+	  const ClassDistribution *old_dist = pnt->TDistribution;
+	  pnt->own_distribution()->DecFreq(Inst.TV);
+	  if ( pnt->TDistribution != old_dist ){
+	    distribution_copied( Inst, pnt );
+	  }
 	  TopDistribution->DecFreq(Inst.TV);
 	  break;
 	}
@@ -1578,51 +3013,149 @@ namespace Timbl {
   }
 
   const ClassDistribution *InstanceBase_base::InitGraphTest( vector<FeatureValue *>&,
-							     const vector<FeatureValue *> *,
+							     const Instance *,
 							     const size_t,
 							     const size_t ){
     FatalError( "InitGraphTest" );
     return 0;
   }
 
-  const IBtree *IBtree::search_node( const FeatureValue *fv ) const {
-    const IBtree *pnt = 0;
-    if ( fv ){
-      if ( fv->isUnknown() ){
-	return 0;
+  const IBtree *ChildIndex::scan( const IBtree *pnt, uint32_t id ){
+    // look for the value with this id in pnt and its siblings
+    while ( pnt ){
+      if ( pnt->FValue && pnt->FValue->Index() == id ){
+	return pnt;
       }
-      pnt = this;
-      while ( pnt ){
-	if ( pnt->FValue == fv ){
-	  break;
-	}
-	pnt = pnt->next;
+      pnt = pnt->next;
+    }
+    return 0;
+  }
+
+  void ChildIndex::index_list( const IBtree *first, list_index& index ){
+    bool sorted = true;
+    for ( const IBtree *pnt = first; pnt; pnt = pnt->next ){
+      uint32_t id = pnt->FValue ? pnt->FValue->Index() : Instance::UnknownId;
+      if ( !index.sorted.empty() && index.sorted.back().first >= id ){
+	sorted = false;
+      }
+      index.sorted.push_back( make_pair( id, pnt ) );
+    }
+    if ( !sorted || index.sorted.size() > FrozenTree::HASH_LIMIT ){
+      index.hashed.reserve( index.sorted.size() );
+      for ( auto const& [id,pnt] : index.sorted ){
+	index.hashed.insert( make_pair( id, pnt ) );
       }
+      index.sorted.clear();
+      index.sorted.shrink_to_fit();
     }
-    return pnt;
   }
 
-  const IBtree *InstanceBase_base::fast_search_node( const FeatureValue *fv ) {
-    const IBtree *result = 0;
-    if ( fast_index.empty() ){
-      fill_index();
+  const IBtree *ChildIndex::search( const IBtree *first, uint32_t id ){
+    // look for the value with this id in the siblings of first.
+    // a short list is scanned, we only index a list that is longer
+    if ( id == Instance::UnknownId ){
+      return 0;
     }
-    if ( fv ){
-      if ( fv->isUnknown() ){
-	return 0;
+    const IBtree *pnt = first;
+    for ( uint32_t i=0; pnt && i < FrozenTree::LINEAR_LIMIT; ++i ){
+      if ( pnt->FValue && pnt->FValue->Index() == id ){
+	return pnt;
       }
-      auto const& It = fast_index.find( fv->Index() );
-      if ( It != fast_index.end() ){
-	result = It->second;
+      pnt = pnt->next;
+    }
+    if ( !pnt ){
+      return 0;
+    }
+    auto It = lists.find( first );
+    if ( It == lists.end() ){
+      It = lists.emplace( first, list_index() ).first;
+      index_list( first, It->second );
+    }
+    const list_index& index = It->second;
+    if ( index.sorted.empty() ){
+      auto const& hit = index.hashed.find( id );
+      return hit == index.hashed.end() ? 0 : hit->second;
+    }
+    auto const hit = lower_bound( index.sorted.begin(),
+				  index.sorted.end(),
+				  id,
+				  []( const auto& p, uint32_t v ){
+				    return p.first < v; } );
+    if ( hit != index.sorted.end() && hit->first == id ){
+      return hit->second;
+    }
+    return 0;
+  }
+
+  const IBtree *InstanceBase_base::search_node( const IBtree *first,
+						uint32_t id ) const {
+    // look for the value with this id in the siblings of first.
+    // a partition changes on every test, so indexing it doesn't pay off
+    if ( IsPartition ){
+      return id == Instance::UnknownId ? 0 : ChildIndex::scan( first, id );
+    }
+    return Children.search( first, id );
+  }
+
+  template <typename T>
+  void nearest_first( vector<pair<double,T>>& vec ){
+    // a stable sort on distance. Most sibling lists are short, so an
+    // insertion sort, which needs no extra memory, is the best choice
+    if ( vec.size() > 32 ){
+      stable_sort( vec.begin(), vec.end(),
+		   []( const auto& a, const auto& b ){ return a.first < b.first; } );
+      return;
+    }
+    for ( size_t i=1; i < vec.size(); ++i ){
+      auto tmp = vec[i];
+      size_t j = i;
+      for ( ; j > 0 && tmp.first < vec[j-1].first; --j ){
+	vec[j] = vec[j-1];
       }
+      vec[j] = tmp;
     }
-    return result;
+  }
+
+  const IBtree *IB_InstanceBase::sort_siblings( size_t level,
+						const IBtree *pnt ){
+    // put pnt and its siblings in order of increasing distance to the
+    // value of the test instance at this level, and return the nearest
+    const Feature *feat = (*SortFeatures)[offSet+level];
+    const FeatureValue *fv = testInst->FV[offSet+level];
+    auto& sorted = SortedNodes[level];
+    sorted.clear();
+    for ( ; pnt; pnt = pnt->next ){
+      sorted.push_back( make_pair( feat->fvDistance( fv, pnt->FValue, SortLimit ),
+				   pnt ) );
+    }
+    nearest_first( sorted );
+    SortPos[level] = 0;
+    return sorted[0].second;
+  }
+
+  uint32_t IB_InstanceBase::sort_frozen( size_t level,
+					 uint32_t first,
+					 uint32_t last ){
+    // sort_siblings() for the siblings [first,last) of a FrozenTree
+    const Feature *feat = (*SortFeatures)[offSet+level];
+    const FeatureValue *fv = testInst->FV[offSet+level];
+    auto& sorted = SortedFrozen[level];
+    sorted.clear();
+    for ( uint32_t n=first; n < last; ++n ){
+      sorted.push_back( make_pair( feat->fvDistance( fv,
+						     FrozenBase->values[n],
+						     SortLimit ),
+				   n ) );
+    }
+    nearest_first( sorted );
+    SortPos[level] = 0;
+    return sorted[0].second;
   }
 
   //#define DEBUGTESTS
 
   const ClassDistribution *IB_InstanceBase::InitGraphTest( vector<FeatureValue *>& Path,
-							   const vector<FeatureValue *> *inst,
+							   const Instance *inst,
 							   const size_t off,
 							   const size_t eff ){
     const IBtree *pnt;
@@ -1633,6 +3166,18 @@ namespace Timbl {
 #ifdef DEBUGTESTS
     cerr << "initTest for " << *inst << endl;
 #endif
+    if ( SortFeatures ){
+      SortedLevel.resize( Depth );
+      for ( size_t i=0; i < Depth; ++i ){
+	SortedLevel[i] = (*SortFeatures)[offSet+i] != 0;
+      }
+    }
+    else {
+      SortedLevel.clear();
+    }
+    if ( FrozenBase ){
+      return InitFrozenTest( Path );
+    }
     pnt = InstBase;
     for ( unsigned int i = 0; i < Depth; ++i ){
       if ( !pnt ){
@@ -1641,23 +3186,27 @@ namespace Timbl {
       }
       InstPath[i] = pnt;
       RestartSearch[i] = pnt;
-      if ( i == 0 ){
-	pnt = fast_search_node( (*testInst)[offSet+i] );
+      if ( sortedLevel( i ) ){
+	// the nearest value first, the exact match when present
+	pnt = sort_siblings( i, pnt );
+	RestartSearch[i] = NULL;
+	SkipSearch[i] = NULL;
+	InstPath[i] = pnt;
       }
       else {
-	pnt = pnt->search_node( (*testInst)[offSet+i] );
-      }
-      if ( pnt ){ // found an exact match, so mark restart position
-	if ( RestartSearch[i] == pnt ){
-	  RestartSearch[i] = pnt->next;
+	pnt = search_node( pnt, testInst->VI[offSet+i] );
+	if ( pnt ){ // found an exact match, so mark restart position
+	  if ( RestartSearch[i] == pnt ){
+	    RestartSearch[i] = pnt->next;
+	  }
+	  SkipSearch[i] = pnt;
+	  InstPath[i] = pnt;
+	}
+	else { // no exact match at this level. Just start with the first....
+	  RestartSearch[i] = NULL;
+	  SkipSearch[i] = NULL;
+	  pnt = InstPath[i];
 	}
-	SkipSearch[i] = pnt;
-	InstPath[i] = pnt;
-      }
-      else { // no exact match at this level. Just start with the first....
-	RestartSearch[i] = NULL;
-	SkipSearch[i] = NULL;
-	pnt = InstPath[i];
       }
       Path[i] = pnt->FValue;
 #ifdef DEBUGTESTS
@@ -1688,25 +3237,35 @@ namespace Timbl {
 
   const ClassDistribution *IB_InstanceBase::NextGraphTest( vector<FeatureValue *>& Path,
 							   size_t& pos ){
+    if ( FrozenBase ){
+      return NextFrozenTest( Path, pos );
+    }
     const IBtree *pnt = NULL;
     const ClassDistribution *result = NULL;
     bool goon = true;
     while ( !pnt && goon ){
-      if ( RestartSearch[pos] == NULL ) {
-	// No exact match here, so no real problems
-	pnt = InstPath[pos]->next;
-	//	cerr << "NO MATCH increment ";
-	// if ( pnt )
-	//   cerr << pnt->FValue;
-	// cerr << endl;
+      if ( sortedLevel( pos ) ){
+	if ( ++SortPos[pos] < SortedNodes[pos].size() ){
+	  pnt = SortedNodes[pos][SortPos[pos]].second;
+	}
       }
       else {
-	pnt = RestartSearch[pos];
-	//	cerr << "restart met " << pnt->FValue << endl;
-	RestartSearch[pos] = NULL;
-      }
-      if ( pnt && pnt == SkipSearch[pos] ){
-	pnt = pnt->next;
+	if ( RestartSearch[pos] == NULL ) {
+	  // No exact match here, so no real problems
+	  pnt = InstPath[pos]->next;
+	  //	cerr << "NO MATCH increment ";
+	  // if ( pnt )
+	  //   cerr << pnt->FValue;
+	  // cerr << endl;
+	}
+	else {
+	  pnt = RestartSearch[pos];
+	  //	cerr << "restart met " << pnt->FValue << endl;
+	  RestartSearch[pos] = NULL;
+	}
+	if ( pnt && pnt == SkipSearch[pos] ){
+	  pnt = pnt->next;
+	}
       }
       if ( !pnt ) {
 	if ( pos == 0 ){
@@ -1726,7 +3285,16 @@ namespace Timbl {
 #endif
       pnt = pnt->link;
       for (  size_t j=pos+1; j < Depth; ++j ){
-	const IBtree *tmp = pnt->search_node( (*testInst)[offSet+j] );
+	if ( sortedLevel( j ) ){
+	  const IBtree *tmp = sort_siblings( j, pnt );
+	  RestartSearch[j] = NULL;
+	  SkipSearch[j] = NULL;
+	  InstPath[j] = tmp;
+	  Path[j] = tmp->FValue;
+	  pnt = tmp->link;
+	  continue;
+	}
+	const IBtree *tmp = search_node( pnt, testInst->VI[offSet+j] );
 	if ( tmp ){ // we found an exact match, so mark Restart position
 	  if ( pnt == tmp ){
 	    RestartSearch[j] = pnt->next;
@@ -1768,6 +3336,154 @@ namespace Timbl {
     return result;
   }
 
+  const ClassDistribution *IB_InstanceBase::InitFrozenTest( vector<FeatureValue *>& Path ){
+    // InitGraphTest() on the frozen layout.
+    // The siblings at level i are [InstPath[i],FrozenEnd[i])
+    // a NO_NODE takes the role of a NULL pointer
+    const FrozenTree *ft = FrozenBase;
+    const uint32_t NO_NODE = FrozenTree::NO_NODE;
+    const ClassDistribution *result = NULL;
+    uint32_t first = 0;
+    uint32_t last = ft->root_count;
+    for ( unsigned int i = 0; i < Depth; ++i ){
+      FrozenWant[i] = FrozenTree::filter_bit( i, testInst->VI[offSet+i] );
+    }
+    for ( unsigned int i = 0; i < Depth; ++i ){
+      if ( first >= last ){
+	throw logic_error( "frozen InstanceBase is incomplete!" );
+      }
+      FrozenEnd[i] = last;
+      uint32_t n;
+      if ( sortedLevel( i ) ){
+	n = sort_frozen( i, first, last );
+	FrozenRestart[i] = NO_NODE;
+	FrozenSkip[i] = NO_NODE;
+      }
+      else {
+	n = ft->search_node( first, last, testInst->VI[offSet+i] );
+	if ( n != NO_NODE ){ // found an exact match, so mark restart position
+	  if ( n == first ){
+	    FrozenRestart[i] = ( first+1 < last ) ? first+1 : NO_NODE;
+	  }
+	  else {
+	    FrozenRestart[i] = first;
+	  }
+	  FrozenSkip[i] = n;
+	}
+	else { // no exact match at this level. Just start with the first....
+	  FrozenRestart[i] = NO_NODE;
+	  FrozenSkip[i] = NO_NODE;
+	  n = first;
+	}
+      }
+      FrozenPath[i] = n;
+      FrozenBelow[i] = ft->below[n];
+      Path[i] = ft->values[n];
+      first = ft->offsets[n];
+      last = ft->offsets[n+1];
+      if ( first < last && ft->is_leaf( first ) ){
+	result = ft->dists[first];
+	break;
+      }
+    }
+    while ( result && result->ZeroDist() ){
+      // This might happen when doing LOO or CV tests
+      size_t TmpPos = effFeat-1;
+      result = NextFrozenTest( Path, TmpPos );
+    }
+    return result;
+  }
+
+  const ClassDistribution *IB_InstanceBase::NextFrozenTest( vector<FeatureValue *>& Path,
+							    size_t& pos ){
+    // NextGraphTest() on the frozen layout.
+    const FrozenTree *ft = FrozenBase;
+    const uint32_t NO_NODE = FrozenTree::NO_NODE;
+    const ClassDistribution *result = NULL;
+    uint32_t n = NO_NODE;
+    bool goon = true;
+    while ( n == NO_NODE && goon ){
+      if ( sortedLevel( pos ) ){
+	if ( ++SortPos[pos] < SortedFrozen[pos].size() ){
+	  n = SortedFrozen[pos][SortPos[pos]].second;
+	}
+      }
+      else {
+	if ( FrozenRestart[pos] == NO_NODE ) {
+	  n = FrozenPath[pos] + 1;
+	}
+	else {
+	  n = FrozenRestart[pos];
+	  FrozenRestart[pos] = NO_NODE;
+	}
+	if ( n == FrozenSkip[pos] ){
+	  ++n;
+	}
+	if ( n >= FrozenEnd[pos] ) {
+	  n = NO_NODE;
+	}
+      }
+      if ( n == NO_NODE ) {
+	if ( pos == 0 ){
+	  goon = false;
+	}
+	else {
+	  pos--;
+	}
+      }
+    }
+    if ( n != NO_NODE && goon ) {
+      FrozenPath[pos] = n;
+      FrozenBelow[pos] = ft->below[n];
+      Path[pos] = ft->values[n];
+      uint32_t first = ft->offsets[n];
+      uint32_t last = ft->offsets[n+1];
+      for ( size_t j=pos+1; j < Depth; ++j ){
+	FrozenEnd[j] = last;
+	uint32_t hit;
+	if ( sortedLevel( j ) ){
+	  hit = sort_frozen( j, first, last );
+	  FrozenRestart[j] = NO_NODE;
+	  FrozenSkip[j] = NO_NODE;
+	}
+	else {
+	  hit = ft->search_node( first, last, testInst->VI[offSet+j] );
+	  if ( hit != NO_NODE ){ // we found an exact match, so mark Restart position
+	    if ( hit == first ){
+	      FrozenRestart[j] = ( first+1 < last ) ? first+1 : NO_NODE;
+	    }
+	    else {
+	      FrozenRestart[j] = first;
+	    }
+	    FrozenSkip[j] = hit;
+	  }
+	  else { // no exact match at this level. Just start with the first....
+	    FrozenRestart[j] = NO_NODE;
+	    FrozenSkip[j] = NO_NODE;
+	    hit = first;
+	  }
+	}
+	FrozenPath[j] = hit;
+	FrozenBelow[j] = ft->below[hit];
+	Path[j] = ft->values[hit];
+	first = ft->offsets[hit];
+	last = ft->offsets[hit+1];
+      }
+      if ( first < last ){
+	result = ft->dists[first];
+      }
+    }
+    if ( result && result->ZeroDist() ){
+      // This might happen when doing LOO or CV tests
+      size_t TmpPos = effFeat-1;
+      result = NextFrozenTest( Path, TmpPos );
+      if ( TmpPos < pos ){
+	pos = TmpPos;
+      }
+    }
+    return result;
+  }
+
   const ClassDistribution *InstanceBase_base::IG_test( const Instance& ,
 						       size_t &,
 						       bool &,
@@ -1787,7 +3503,23 @@ namespace Timbl {
     ClassDistribution *Dist = NULL;
     int pos = 0;
     leaf = false;
-    const IBtree *pnt = fast_search_node( Inst.FV[pos] );
+    if ( FrozenBase ){
+      const FrozenTree *ft = FrozenBase;
+      uint32_t n = ft->search_node( 0, ft->root_count, Inst.VI[pos] );
+      while ( n != FrozenTree::NO_NODE ){
+	result = ft->defaults[n];
+	if ( PersistentDistributions ){
+	  Dist = ft->nodes[n]->TDistribution;
+	}
+	uint32_t first = ft->offsets[n];
+	uint32_t last = ft->offsets[n+1];
+	leaf = ( first == last || ft->values[first] == NULL );
+	++pos;
+	n = leaf ? FrozenTree::NO_NODE
+	  : ft->search_node( first, last, Inst.VI[pos] );
+      }
+    }
+    const IBtree *pnt = FrozenBase ? NULL : search_node( InstBase, Inst.VI[pos] );
     while ( pnt ){
       result = pnt->TValue;
       if ( PersistentDistributions ){
@@ -1800,7 +3532,7 @@ namespace Timbl {
       leaf = (pnt == NULL);
       ++pos;
       if ( pnt ){
-	pnt = pnt->search_node( Inst.FV[pos] );
+	pnt = search_node( pnt, Inst.VI[pos] );
       }
     }
     end_level = pos;
@@ -1844,20 +3576,45 @@ namespace Timbl {
     dist = NULL;
     IB_InstanceBase *subt = NULL;
     size_t pos = 0;
-    while ( pnt && pos < threshold ){
-      if ( pnt->FValue == Inst.FV[pos] ){
-	dist = pnt->TDistribution;
-	TV = pnt->TValue;
-	pnt = pnt->link;
-	if ( pnt && !pnt->FValue ){
-	  dist = pnt->TDistribution;
-	  pnt = NULL;
+    if ( FrozenBase ){
+      // the same descent, but using the indexed frozen layout
+      const FrozenTree *ft = FrozenBase;
+      uint32_t first = 0;
+      uint32_t last = ft->root_count;
+      pnt = NULL;
+      while ( first < last && pos < threshold ){
+	uint32_t n = ft->search_node( first, last, Inst.VI[pos] );
+	if ( n == FrozenTree::NO_NODE ){
+	  break;
+	}
+	dist = ft->nodes[n]->TDistribution;
+	TV = ft->defaults[n];
+	first = ft->offsets[n];
+	last = ft->offsets[n+1];
+	if ( first < last && !ft->values[first] ){
+	  dist = ft->nodes[first]->TDistribution;
+	  last = first;
 	}
 	pos++;
       }
-      else {
-	pnt = pnt->next;
+      if ( first < last ){
+	pnt = ft->nodes[first];
+      }
+    }
+    while ( pnt && pos < threshold ){
+      const IBtree *hit = search_node( pnt, Inst.VI[pos] );
+      if ( !hit ){
+	pnt = NULL;
+	break;
       }
+      dist = hit->TDistribution;
+      TV = hit->TValue;
+      pnt = hit->link;
+      if ( pnt && !pnt->FValue ){
+	dist = pnt->TDistribution;
+	pnt = NULL;
+      }
+      pos++;
     }
     if ( pos == threshold ){
       if ( pnt ){
@@ -1896,21 +3653,43 @@ namespace Timbl {
     int pos = 0;
     IB_InstanceBase *subtree = NULL;
     IBtree *last_match = pnt;
-    while ( pnt ){
-      if ( pnt->FValue == Inst.FV[pos] ){
-	// a match, go deeper
-	pnt = pnt->link;
-	last_match = pnt;
+    if ( FrozenBase ){
+      // the same descent, but using the indexed frozen layout
+      const FrozenTree *ft = FrozenBase;
+      uint32_t first = 0;
+      uint32_t last = ft->root_count;
+      pnt = NULL;
+      while ( first < last ){
+	uint32_t n = ft->search_node( first, last, Inst.VI[pos] );
+	if ( n == FrozenTree::NO_NODE ){
+	  break;
+	}
+	first = ft->offsets[n];
+	last = ft->offsets[n+1];
+	last_match = ( first < last ) ? ft->nodes[first] : NULL;
 	pos++;
-	if ( pnt && !pnt->FValue ){
+	if ( first < last && !ft->values[first] ){
 	  // at the end, an exact match
-	  dist = pnt->TDistribution;
+	  dist = ft->nodes[first]->TDistribution;
 	  last_match = NULL;
 	  break;
 	}
       }
-      else {
-	pnt = pnt->next;
+    }
+    while ( pnt ){
+      const IBtree *hit = search_node( pnt, Inst.VI[pos] );
+      if ( !hit ){
+	break;
+      }
+      // a match, go deeper
+      pnt = hit->link;
+      last_match = pnt;
+      pos++;
+      if ( pnt && !pnt->FValue ){
+	// at the end, an exact match
+	dist = pnt->TDistribution;
+	last_match = NULL;
+	break;
       }
     }
     if ( last_match ){
@@ -33,6 +33,7 @@
 #include "timbl/Common.h"
 #include "timbl/Types.h"
 #include "timbl/IBtree.h"
+#include "timbl/MappedFile.h"
 #include "timbl/Instance.h"
 #include "timbl/TimblExperiment.h"
 #include "ticcutils/Timer.h"
@@ -68,6 +69,7 @@ namespace Timbl {
 	  if ( do_diversify ){
 	    diverseWeights();
 	  }
+	  build_read_copies( false );
 	  srand( random_seed );
 	}
 	MBL_init = true;
@@ -125,6 +127,7 @@ namespace Timbl {
       if ( ExpInvalid() ){
 	return false;
       }
+      InstanceBase->Threads( Clones() );
       if ( EffectiveFeatures() < 2 ){
 	fileIndex fmIndex;
 	result = build_file_index( CurrentDataFile, fmIndex );
@@ -160,6 +163,7 @@ namespace Timbl {
 						       (RandomSeed()>=0),
 						       false,
 						       true );
+		outInstanceBase->Threads( Clones() );
 	      }
 	      outInstanceBase->AddInstance( CurrInst );
 	    }
@@ -215,6 +219,7 @@ namespace Timbl {
 						     (RandomSeed()>=0),
 						     false,
 						     true );
+	      TmpInstanceBase->Threads( Clones() );
 	      for ( const auto& fit : dit.second ) {
 		for ( const auto& sit : fit.second ){
 		  datafile.clear();
@@ -233,6 +238,7 @@ namespace Timbl {
 							    (RandomSeed()>=0),
 							    false,
 							    true );
+		    PartInstanceBase->Threads( Clones() );
 		  }
 		  //		cerr << "add instance " << &CurrInst << endl;
 		  PartInstanceBase->AddInstance( CurrInst );
@@ -289,6 +295,7 @@ namespace Timbl {
 							   (RandomSeed()>=0),
 							   false,
 							   true );
+		    outInstanceBase->Threads( Clones() );
 		  }
 		  //	      cerr << "add instance " << &CurrInst << endl;
 		  outInstanceBase->AddInstance( CurrInst );
@@ -521,14 +528,15 @@ namespace Timbl {
   bool IG_Experiment::ReadInstanceBase( const string& FileName ){
     bool result = false;
     if ( ConfirmOptions() ){
-      ifstream infile( FileName, ios::in );
-      if ( !infile ) {
+      MappedFile mapped( FileName );
+      if ( !mapped.is_open() ) {
 	Error( "can't open: " + FileName );
       }
       else {
 	if ( !Verbosity(SILENT) ){
 	  Info( "Reading Instance-Base from: " + FileName );
 	}
+	istream infile( &mapped );
 	if ( GetInstanceBase( infile ) ){
 	  if ( !Verbosity(SILENT) ){
 	    writePermutation( cout );
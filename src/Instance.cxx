@@ -26,6 +26,7 @@
 */
 
 #include <iostream>
+#include <algorithm>
 
 #include "timbl/Types.h"
 #include "timbl/Instance.h"
@@ -34,6 +35,8 @@ using namespace std;
 
 namespace Timbl {
 
+  using icu::UnicodeString;
+
   Instance::Instance():
     TV(NULL),
     sample_weight(0.0),
@@ -42,18 +45,14 @@ namespace Timbl {
   }
 
   Instance::~Instance(){
-    clear();
+    for ( const auto& it : unknowns ){
+      delete it;
+    }
   }
 
   void Instance::clear(){
-    for ( auto& it : FV ){
-      if ( it ){
-	if ( it->isUnknown() ){
-	  delete it;
-	}
-      }
-      it = 0;
-    }
+    fill( FV.begin(), FV.end(), nullptr );
+    fill( VI.begin(), VI.end(), UnknownId );
     TV = 0;
     sample_weight = 0.0;
     occ = 1;
@@ -61,6 +60,46 @@ namespace Timbl {
 
   void Instance::Init( size_t len ){
     FV.resize( len, 0 );
+    VI.resize( len, UnknownId );
+  }
+
+  void Instance::setUnknown( size_t i, const UnicodeString& name ){
+    // an unseen (test) value. We don't allocate a new FeatureValue for
+    // every such value, but re-use a dummy per position, which is only
+    // valid until the next clear()
+    // The name is copied, so the Instance doesn't depend on the input
+    // it was made from.
+    if ( unknowns.size() <= i ){
+      unknowns.resize( FV.size(), 0 );
+      unknown_names.resize( FV.size() );
+      for ( size_t j=0; j < unknowns.size(); ++j ){
+	if ( unknowns[j] ){
+	  unknowns[j]->_name = &unknown_names[j];
+	}
+      }
+    }
+    unknown_names[i] = name;
+    if ( !unknowns[i] ){
+      unknowns[i] = new FeatureValue( unknown_names[i] );
+    }
+    else {
+      unknowns[i]->_name = &unknown_names[i];
+      unknowns[i]->parse_numeric();
+    }
+    FV[i] = unknowns[i];
+    VI[i] = UnknownId;
+  }
+
+  void Instance::swap( Instance& other ){
+    // exchange the contents of 2 Instances. Nothing is copied, the dummies
+    // for unknown values move along with their owner.
+    FV.swap( other.FV );
+    VI.swap( other.VI );
+    std::swap( TV, other.TV );
+    std::swap( sample_weight, other.sample_weight );
+    std::swap( occ, other.occ );
+    unknowns.swap( other.unknowns );
+    unknown_names.swap( other.unknown_names );
   }
 
   ostream& operator<<( ostream& os, const Instance *I ){
@@ -63,6 +63,10 @@ namespace Timbl {
 	  if ( do_diversify ){
 	    diverseWeights();
 	  }
+	  build_read_copies( false );
+	  if ( do_exact_index ){
+	    index_instancebase();
+	  }
 	  srand( random_seed );
 	}
 	initTesters();
@@ -110,6 +114,7 @@ namespace Timbl {
 	FatalError( "the file '" + FileName + "' contains only 1 usable line. LOO impossible!" );
       }
       initExperiment();
+      build_read_copies( true );
       stats.clear();
       delete confusionInfo;
       confusionInfo = 0;
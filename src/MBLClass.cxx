@@ -27,12 +27,14 @@
 
 #include <vector>
 #include <set>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <limits>
 #include <iomanip>
 #include <typeinfo>
+#include <chrono>
 
 #include <cassert>
 
@@ -61,6 +63,10 @@ using namespace nlohmann;
 namespace Timbl {
   using TiCC::operator<<;
 
+  // the length of the search that bounds the Threshold of every query
+  // in a batched search, see MBLClass::seed_threshold()
+  const size_t seed_steps = 64;
+
   void MBLClass::init_options_table( size_t Size ){
     if ( tableFilled ){
       return;
@@ -108,6 +114,23 @@ namespace Timbl {
 				 &do_diversify, false ) );
     Options.Add( new BoolOption( "DO_PRUNE",
 				 &do_prune, false ) );
+    Options.Add( new BoolOption( "FREEZE_TREE",
+				 &do_freeze, false ) );
+    Options.Add( new BoolOption( "BEST_FIRST",
+				 &do_best_first, false ) );
+    Options.Add( new BoolOption( "EXACT_INDEX",
+				 &do_exact_index, false ) );
+    Options.Add( new BoolOption( "DENSE_SEARCH",
+				 &do_dense, false ) );
+    Options.Add( new SizeOption( "RESULT_CACHE",
+				 &result_cache_size, 0, 0,
+				 std::numeric_limits<size_t>::max() ) );
+    Options.Add( new SizeOption( "SEARCH_BUDGET",
+				 &search_budget, 0, 0,
+				 std::numeric_limits<size_t>::max() ) );
+    Options.Add( new SizeOption( "SEARCH_DEADLINE",
+				 &search_deadline, 0, 0,
+				 std::numeric_limits<size_t>::max() ) );
     Options.Add( new DecayOption( "DECAY",
 				  &decay_flag, Zero ) );
     Options.Add( new IntegerOption( "SEED",
@@ -134,6 +157,8 @@ namespace Timbl {
 				 &do_exact_match, false ) );
     Options.Add( new BoolOption( "HASHED_TREE",
 				 &hashed_trees, true ) );
+    Options.Add( new BoolOption( "BINARY_TREE",
+				 &binary_trees, false ) );
     Options.Add( new MetricOption( "GLOBAL_METRIC",
 				   &globalMetricOption, Overlap ) );
     Options.Add( new MetricArrayOption( "METRICS",
@@ -220,9 +245,19 @@ namespace Timbl {
     globalMetricOption(Overlap),
     do_diversify(false),
     do_prune(false),
+    do_freeze(false),
+    do_best_first(false),
+    do_exact_index(false),
+    do_dense(false),
+    search_budget(0),
+    search_deadline(0),
+    result_cache_size(0),
+    search_cut_off(false),
+    node_visits(0),
     ChopInput(0),
     F_length(0),
     MaxFeatures(0),
+    dense_ok(false),
     input_format(UnknownInputFormat),
     verbosity(NO_VERB),
     target_pos(std::numeric_limits<size_t>::max()),
@@ -232,10 +267,13 @@ namespace Timbl {
     tribl_offset(0),
     igThreshold(1000),
     mvd_threshold(1),
+    prestore_secs(0.0),
+    prestore_threads(1),
     do_sloppy_loo(false),
     do_exact_match(false),
     do_silly_testing(false),
     hashed_trees(true),
+    binary_trees(false),
     need_all_weights(false),
     do_sample_weighting(false),
     do_ignore_samples(true),
@@ -277,6 +315,8 @@ namespace Timbl {
       }
       UserOptions        = m.UserOptions;
       mvd_threshold      = m.mvd_threshold;
+      prestore_secs      = m.prestore_secs;
+      prestore_threads   = m.prestore_threads;
       num_of_neighbors   = m.num_of_neighbors;
       dynamic_neighbors  = m.dynamic_neighbors;
       target_pos         = m.target_pos;
@@ -291,6 +331,15 @@ namespace Timbl {
       do_silly_testing   = m.do_silly_testing;
       do_diversify       = m.do_diversify;
       do_prune           = m.do_prune;
+      do_freeze          = m.do_freeze;
+      do_best_first      = m.do_best_first;
+      do_exact_index     = m.do_exact_index;
+      do_dense           = m.do_dense;
+      search_budget      = m.search_budget;
+      search_deadline    = m.search_deadline;
+      result_cache_size  = m.result_cache_size;
+      search_cut_off     = false;
+      node_visits        = 0;
       tester = 0;
       decay = 0;
       targets  = m.targets;
@@ -331,6 +380,72 @@ namespace Timbl {
     delete ChopInput;
   }
 
+  static shared_ptr<Hash::UnicodeHash>
+  copy_hash( const Hash::UnicodeHash *hash,
+	     const shared_ptr<Hash::UnicodeHash>& last ){
+    // a copy of hash, with the same indices. Hashes only grow, so when
+    // nothing was added, the last copy is still good
+    if ( last && last->num_of_entries() == hash->num_of_entries() ){
+      return last;
+    }
+    auto result = make_shared<Hash::UnicodeHash>();
+    for ( unsigned int i=1; i <= hash->num_of_entries(); ++i ){
+      if ( result->hash( hash->reverse_lookup( i ) ) != i ){
+	throw logic_error( "copy_hash: unable to reproduce the hash indices" );
+      }
+    }
+    return result;
+  }
+
+  void MBLClass::snapshot_from( MBLClass& m ){
+    // we are a copy of m, that is to be published as a version.
+    // Keep the values of m, but freeze everything about them that m may
+    // change later: the statistics, the matrices and the hashes
+    m.feature_hash_copy = copy_hash( m.features.hash(), m.feature_hash_copy );
+    m.target_hash_copy = copy_hash( m.targets.hash(), m.target_hash_copy );
+    feature_hash_copy = m.feature_hash_copy;
+    target_hash_copy = m.target_hash_copy;
+    features._feature_hash = feature_hash_copy.get();
+    for ( size_t i=0; i < NumOfFeatures(); ++i ){
+      delete features.feats[i];
+      features.feats[i]
+	= m.features.feats[i]->Snapshot( feature_hash_copy.get() );
+    }
+    for ( size_t i=0; i < NumOfFeatures(); ++i ){
+      if ( features.perm_feats[i] ){
+	features.perm_feats[i] = features.feats[features.permutation[i]];
+      }
+    }
+    targets.Snapshot( m.targets, target_hash_copy.get() );
+    DBEntropy = m.DBEntropy;
+  }
+
+  void MBLClass::hand_over_values( vector<ValueClass *>& values,
+				   vector<Hash::UnicodeHash *>& hashes ){
+    // published versions use our values, and the hashes that hold their
+    // names. They may outlive us, so we give them away, to be deleted
+    // after the last version
+    for ( auto *feat : features.feats ){
+      if ( !feat->is_reference && !feat->shared_values ){
+	values.insert( values.end(),
+		       feat->values_array.begin(),
+		       feat->values_array.end() );
+	feat->shared_values = true;
+      }
+    }
+    if ( !features._is_reference ){
+      hashes.push_back( features._feature_hash );
+      features._is_reference = true;
+    }
+    if ( !targets.is_reference ){
+      values.insert( values.end(),
+		     targets.values_array.begin(),
+		     targets.values_array.end() );
+      hashes.push_back( targets.target_hash );
+      targets.is_reference = true;
+    }
+  }
+
 
   void MBLClass::Info( const string& out_line ) const {
 #pragma omp critical
@@ -768,22 +883,32 @@ namespace Timbl {
 
   void MBLClass::MatrixInfo( ostream& os ) const {
     unsigned int TotalCount = 0;
-    bool dummy;
+    size_t Values = 0;
+    bool isRead;
     size_t m = 1;
     for ( const auto& feat : features.feats ){
       if ( !feat->Ignore() &&
 	   feat->isStorableMetric() &&
-	   feat->matrixPresent( dummy ) ){
+	   feat->matrixPresent( isRead ) ){
 	unsigned int Count = feat->matrix_byte_size();
 	os << "Size of value-matrix[" << m << "] = "
 	   << Count << " Bytes " << endl;
 	TotalCount += Count;
+	if ( !isRead ){
+	  Values += feat->matrix_values();
+	}
       }
       ++m;
     }
     if ( TotalCount ){
       os << "Total Size of value-matrices " << TotalCount << " Bytes "
-	 << endl << endl;
+	 << endl;
+      if ( Values ){
+	os << "Prestored " << Values << " rows of value-matrices in "
+	   << prestore_secs << " seconds, using " << prestore_threads
+	   << ( prestore_threads > 1 ? " threads" : " thread" ) << endl;
+      }
+      os << endl;
     }
   }
 
@@ -1017,10 +1142,41 @@ namespace Timbl {
   */
   void MBLClass::calculatePrestored(){
     if ( !is_copy ){
-      for ( size_t j = tribl_offset; j < EffectiveFeatures(); ++j ) {
-	if ( !features.perm_feats[j]->Ignore() &&
-	     features.perm_feats[j]->isStorableMetric() ){
-	  features.perm_feats[j]->store_matrix( mvd_threshold );
+      // every feature is a task, and so is every block of rows of its
+      // matrix. Each cell is computed on its own, so the result doesn't
+      // depend on the number of threads. The tasks don't write to the log,
+      // every feature gets its own slot for a message, shown afterwards.
+      int threads = InstanceBase ? InstanceBase->Threads() : 1;
+      vector<string> messages( EffectiveFeatures() );
+      auto start = chrono::steady_clock::now();
+#pragma omp parallel num_threads( threads ) if ( threads > 1 )
+#pragma omp single
+      {
+	for ( size_t j = tribl_offset; j < EffectiveFeatures(); ++j ) {
+	  Feature *feat = features.perm_feats[j];
+	  if ( !feat->Ignore() &&
+	       feat->isStorableMetric() ){
+#pragma omp task firstprivate( feat, j ) shared( messages )
+	    {
+	      feat->store_matrix( mvd_threshold );
+	      if ( feat->matrix_values() >= 1000 ){
+		messages[j] = "Prestored value-matrix of feature "
+		  + TiCC::toString( features.permutation[j]+1 )
+		  + " (" + TiCC::toString( feat->matrix_values() )
+		  + " values)";
+	      }
+	    }
+	  }
+	}
+      }
+      prestore_secs = chrono::duration<double>( chrono::steady_clock::now()
+						- start ).count();
+      prestore_threads = threads;
+      if ( !Verbosity(SILENT) ){
+	for ( auto const& message : messages ){
+	  if ( !message.empty() ){
+	    Info( message );
+	  }
 	}
       }
       if ( Verbosity(VD_MATRIX) ){
@@ -1063,13 +1219,13 @@ namespace Timbl {
 	// when learning, no need to bother about Permutation
 	if ( features[i]->Ignore() ) {
 	  // but this might happen, take care!
-	  CurrInst.FV[i] = NULL;
+	  CurrInst.setValue( i, NULL );
 	}
 	else {
 	  // Add it to the Instance.
 	  //	  cerr << "Feature add: " << ChopInput->getField(i) << endl;
-	  CurrInst.FV[i] = features[i]->add_value( ChopInput->getField(i),
-						      CurrInst.TV, occ );
+	  CurrInst.setValue( i, features[i]->add_value( ChopInput->getField(i),
+							CurrInst.TV, occ ) );
 
 	}
       } // i
@@ -1080,7 +1236,7 @@ namespace Timbl {
       // First the Features
       for ( size_t k = 0; k < EffectiveFeatures(); ++k ){
 	size_t j = features.permutation[k];
-	CurrInst.FV[k] = features[j]->Lookup( ChopInput->getField(j) );
+	CurrInst.setValue( k, features[j]->Lookup( ChopInput->getField(j) ) );
       } // k
       // and the Target
       CurrInst.TV = targets.Lookup( ChopInput->getField( NumOfFeatures() ) );
@@ -1093,9 +1249,9 @@ namespace Timbl {
       // Then the Features
       for ( size_t l = 0; l < EffectiveFeatures(); ++l ){
 	size_t j = features.permutation[l];
-	CurrInst.FV[l] = features[j]->add_value((*ChopInput)[j],
-						   CurrInst.TV,
-						   occ );
+	CurrInst.setValue( l, features[j]->add_value( (*ChopInput)[j],
+						      CurrInst.TV,
+						      occ ) );
       } // for l
       break;
     case TestWords:
@@ -1104,10 +1260,13 @@ namespace Timbl {
       for ( size_t m = 0; m < EffectiveFeatures(); ++m ){
 	size_t j = features.permutation[m];
 	const UnicodeString& fld =  ChopInput->getField(j);
-	CurrInst.FV[m] = features[j]->Lookup( fld );
-	if ( !CurrInst.FV[m] ){
-	  // for "unknown" values have to add a dummy value
-	  CurrInst.FV[m] = new FeatureValue( fld );
+	FeatureValue *fv = features[j]->Lookup( fld );
+	if ( fv ){
+	  CurrInst.setValue( m, fv );
+	}
+	else {
+	  // for "unknown" values we use a dummy value
+	  CurrInst.setUnknown( m, fld );
 	}
 
       } // i
@@ -1767,10 +1926,10 @@ namespace Timbl {
     UnicodeString result;
     Instance inst( Size );
     for ( size_t i=0; i< OffSet; ++i ){
-      inst.FV[i] = OrgFV[i];
+      inst.setValue( i, OrgFV[i] );
     }
     for ( size_t j=OffSet; j< Size; ++j ){
-      inst.FV[j] = RedFV[j-OffSet];
+      inst.setValue( j, RedFV[j-OffSet] );
     }
     vector<size_t> InvPerm(NumOfFeatures(),0);
     for ( size_t i=0; i< NumOfFeatures(); ++i ){
@@ -1839,7 +1998,7 @@ namespace Timbl {
 				   size_t ib_offset ){
     vector<FeatureValue *> CurrentFV(NumOfFeatures());
     const ClassDistribution *best_distrib = IB->InitGraphTest( CurrentFV,
-							       &Inst.FV,
+							       &Inst,
 							       ib_offset,
 							       EffectiveFeatures() );
     if ( !best_distrib ){
@@ -1870,6 +2029,7 @@ namespace Timbl {
       double Distance = WeightFun( tester->getDistance(EndPos),
 				   Bpnt->Weight() );
       bestArray.addResult( Distance, &ResultDist, origI );
+      bestArray.mergeLeaves(); // ResultDist is gone after this loop
       CurPos = EndPos-1;
       ++lastpos;
       if ( lastpos != best_distrib->end() ){
@@ -1887,6 +2047,7 @@ namespace Timbl {
 	}
       }
     }
+    node_visits += tester->Visits();
   }
 
   void MBLClass::initDecay(){
@@ -1916,6 +2077,113 @@ namespace Timbl {
     delete tester;
     tester = getTester( globalMetricOption,
 			features, mvd_threshold );
+    sorted_features.clear();
+    if ( do_best_first ){
+      // only a value difference metric gives an order worth searching in
+      bool any = false;
+      for ( size_t i=0; i < NumOfFeatures(); ++i ){
+	const Feature *feat = features.perm_feats[i];
+	if ( feat
+	     && !feat->Ignore()
+	     && feat->isStorableMetric()
+	     && feat->getMetricType() != Levenshtein
+	     && feat->getMetricType() != Dice ){
+	  any = true;
+	}
+	else {
+	  feat = 0;
+	}
+	sorted_features.push_back( feat );
+      }
+      if ( !any ){
+	sorted_features.clear();
+      }
+    }
+    if ( InstanceBase ){
+      InstanceBase->BestFirst( sorted_features.empty() ? 0 : &sorted_features,
+			       mvd_threshold );
+    }
+    dense_ok = dense_searchable();
+  }
+
+  bool MBLClass::dense_searchable() const {
+    // a brute force search of a DenseBase only knows the numeric metrics
+    // and the similarity metrics, and it always visits every instance
+    if ( doSamples()
+	 || search_budget > 0
+	 || search_deadline > 0 ){
+      return false;
+    }
+    if ( globalMetricOption == Cosine
+	 || globalMetricOption == DotProduct ){
+      return true;
+    }
+    for ( size_t i=0; i < EffectiveFeatures(); ++i ){
+      const Feature *feat = features.perm_feats[i];
+      if ( !feat
+	   || ( feat->getMetricType() != Numeric
+		&& feat->getMetricType() != Euclidean )
+	   || !( feat->Max() - feat->Min() > 0.0 ) ){
+	return false;
+      }
+    }
+    return true;
+  }
+
+  bool MBLClass::out_of_budget( size_t visits,
+				const chrono::steady_clock::time_point& start ) const {
+    // an approximate search stops after search_budget visits of the
+    // Instance Base, or when search_deadline microseconds have passed.
+    // the first visit is always made, so there is at least one neighbor
+    if ( visits <= 1 ){
+      return false;
+    }
+    if ( search_budget > 0 && visits > search_budget ){
+      return true;
+    }
+    if ( search_deadline > 0 ){
+      auto used = chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now() - start );
+      return static_cast<size_t>(used.count()) >= search_deadline;
+    }
+    return false;
+  }
+
+  struct search_candidate {
+    // a neighbor, found by a search that doesn't walk the InstanceBase
+    // in the order of a plain search
+    double distance;
+    const ClassDistribution *distrib;
+    vector<FeatureValue *> path;
+    UnicodeString origI;
+  };
+
+  static void add_in_search_order( vector<search_candidate>& candidates,
+				   const vector<FeatureValue *>& FV,
+				   size_t offset,
+				   BestArray& best ){
+    // a plain search visits the value of the query first on every level,
+    // and then the other values in tree order, which is the order of their
+    // Index(). Add the candidates to best again in that order, so neighbors
+    // at equal distances are listed in the same order, and the same ones
+    // are kept when MaxBests is reached
+    sort( candidates.begin(), candidates.end(),
+	  [&FV,offset]( const search_candidate& a,
+			const search_candidate& b ){
+	    for ( size_t l=0; l < a.path.size(); ++l ){
+	      if ( a.path[l] != b.path[l] ){
+		bool a_match = ( a.path[l] == FV[offset+l] );
+		bool b_match = ( b.path[l] == FV[offset+l] );
+		if ( a_match != b_match ){
+		  return a_match;
+		}
+		return a.path[l]->Index() < b.path[l]->Index();
+	      }
+	    }
+	    return false; } );
+    best.reset();
+    for ( const auto& c : candidates ){
+      best.addResult( c.distance, c.distrib, c.origI );
+    }
   }
 
   void MBLClass::test_instance( const Instance& Inst,
@@ -1925,12 +2193,26 @@ namespace Timbl {
     double Threshold = DBL_MAX;
     size_t EffFeat = EffectiveFeatures() - ib_offset;
     const ClassDistribution *best_distrib = IB->InitGraphTest( CurrentFV,
-							       &Inst.FV,
+							       &Inst,
 							       ib_offset,
 							       EffectiveFeatures() );
     tester->init( Inst, EffectiveFeatures(), ib_offset );
+    // prune whole subtrees, when the InstanceBase knows what is in them
+    tester->setFilters( IB->subtreeFilters(), IB->queryFilters() );
+    const bool budgeted = search_budget > 0 || search_deadline > 0;
+    const auto start = budgeted ? chrono::steady_clock::now()
+      : chrono::steady_clock::time_point();
+    size_t visits = 0;
     size_t CurPos = 0;
+    // --bestfirst visits the nearest values first, so neighbors at equal
+    // distances are found in another order than in a plain search
+    const bool reorder = !sorted_features.empty();
+    vector<search_candidate> candidates;
     while ( best_distrib ){
+      if ( budgeted && out_of_budget( ++visits, start ) ){
+	search_cut_off = true;
+	break;
+      }
       size_t EndPos = tester->test( CurrentFV,
 				    CurPos,
 				    Threshold + Epsilon );
@@ -1945,6 +2227,13 @@ namespace Timbl {
 				    NumOfFeatures() );
 	  }
 	  Threshold = bestArray.addResult( Distance, best_distrib, origI );
+	  if ( reorder ){
+	    candidates.push_back( { Distance,
+				    best_distrib,
+				    vector<FeatureValue *>( CurrentFV.begin(),
+							    CurrentFV.begin() + EffFeat ),
+				    origI } );
+	  }
 	  if ( do_silly_testing ){
 	    Threshold = DBL_MAX;
 	  }
@@ -1960,18 +2249,27 @@ namespace Timbl {
       size_t pos=EndPos-1;
       while ( true ){
 	// rollback
-	if ( tester->getDistance(pos) <= Threshold ){
+	if ( tester->getDistance(pos) <= Threshold
+	     && !( IB->sortedLevel( pos )
+		   && tester->getDistance(pos+1) > Threshold + Epsilon ) ){
+	  // on a sorted level the next siblings are at least as far away as
+	  // the current one, so when that is out of reach, skip them all
 	  CurPos = pos;
 	  best_distrib = IB->NextGraphTest( CurrentFV,
 					    CurPos );
 	  break;
 	}
 	if ( pos == 0 ){
+	  best_distrib = NULL; // nothing left to try
 	  break;
 	}
 	--pos;
       }
     }
+    if ( reorder ){
+      add_in_search_order( candidates, Inst.FV, ib_offset, bestArray );
+    }
+    node_visits += tester->Visits();
   }
 
   void MBLClass::test_instance_sim( const Instance& Inst,
@@ -1980,11 +2278,19 @@ namespace Timbl {
     vector<FeatureValue *> CurrentFV(NumOfFeatures());
     size_t EffFeat = EffectiveFeatures() - ib_offset;
     const ClassDistribution *best_distrib = IB->InitGraphTest( CurrentFV,
-							       &Inst.FV,
+							       &Inst,
 							       ib_offset,
 							       EffectiveFeatures() );
     tester->init( Inst, EffectiveFeatures(), ib_offset );
+    const bool budgeted = search_budget > 0 || search_deadline > 0;
+    const auto start = budgeted ? chrono::steady_clock::now()
+      : chrono::steady_clock::time_point();
+    size_t visits = 0;
     while ( best_distrib ){
+      if ( budgeted && out_of_budget( ++visits, start ) ){
+	search_cut_off = true;
+	break;
+      }
       double dummy_t = -1.0;
       size_t dummy_p = 0;
       // similarity::test() doesn't need CurPos, nor a Threshold
@@ -2020,6 +2326,260 @@ namespace Timbl {
       --EndPos;
       best_distrib = IB->NextGraphTest( CurrentFV, EndPos );
     }
+    node_visits += tester->Visits();
+  }
+
+  bool MBLClass::test_instance_dense( const Instance& Inst,
+				      const DenseBase *db ){
+    // the distances to all rows at once, one feature at a time, in the
+    // same order as the testers. Returns false when the rows can't be
+    // handled here, so the normal search must be done.
+    const bool similarity = GlobalMetric->isSimilarityMetric();
+    if ( !similarity && !db->allNumeric() ){
+      return false;
+    }
+    const bool cosine = globalMetricOption == Cosine;
+    size_t num = db->rows();
+    size_t EffFeat = EffectiveFeatures();
+    dense_dist.assign( num, 0.0 );
+    if ( cosine ){
+      dense_norm.assign( num, 0.0 );
+    }
+    double denom1 = 0.0;
+    for ( size_t f=0; f < EffFeat; ++f ){
+      const Feature *feat = features.perm_feats[f];
+      const FeatureValue *FV = Inst.FV[f];
+      double W = feat->Weight();
+      if ( similarity ){
+	if ( cosine ){
+	  db->add_square( f, W, dense_norm.data() );
+	}
+	if ( FV->isNumeric() ){
+	  // a non numeric value adds nothing
+	  double q = FV->numericValue();
+	  denom1 += ( q * q ) * W;
+	  db->add_product( f, q, W, dense_dist.data() );
+	}
+      }
+      else if ( !FV->isNumeric() ){
+	// the metric gives a distance of 1 to every row
+	for ( auto& d : dense_dist ){
+	  d += 1.0 * W;
+	}
+      }
+      else if ( feat->getMetricType() == Euclidean ){
+	db->add_euclidean( f, FV->numericValue(), feat->Max() - feat->Min(),
+			   W, dense_dist.data() );
+      }
+      else {
+	db->add_numeric( f, FV->numericValue(), feat->Max() - feat->Min(),
+			 W, dense_dist.data() );
+      }
+    }
+    if ( similarity ){
+      const double int_max = std::numeric_limits<int>::max();
+      for ( size_t r=0; r < num; ++r ){
+	if ( cosine ){
+	  double denom = sqrt( denom1 * dense_norm[r] );
+	  dense_dist[r] = 1.0 - dense_dist[r] / ( denom + Common::Epsilon );
+	}
+	else {
+	  dense_dist[r] = ( int_max - dense_dist[r] ) / int_max;
+	}
+	if ( dense_dist[r] < 0.0 ){
+	  // let the normal search report this
+	  return false;
+	}
+      }
+    }
+    vector<FeatureValue *> CurrentFV;
+    if ( Verbosity(NEAR_N) ){
+      CurrentFV.resize( NumOfFeatures() );
+    }
+    double Threshold = DBL_MAX;
+    for ( size_t r=0; r < num; ++r ){
+      double Distance = dense_dist[r];
+      if ( do_silly_testing
+	   || Distance <= Threshold + Epsilon ){
+	UnicodeString origI;
+	if ( Verbosity(NEAR_N) ){
+	  for ( size_t f=0; f < EffFeat; ++f ){
+	    CurrentFV[f] = db->value( r, f );
+	  }
+	  origI = formatInstance( Inst.FV, CurrentFV,
+				  0,
+				  NumOfFeatures() );
+	}
+	Threshold = bestArray.addResult( Distance,
+					 db->distribution( r ),
+					 origI );
+      }
+    }
+    return true;
+  }
+
+  double MBLClass::seed_threshold( const Instance& Inst,
+				   InstanceBase_base *IB,
+				   TesterClass *qt,
+				   BestArray& seeds ){
+    // an upper bound for the distance of the k-th neighbour of Inst: the
+    // k-th best distance among the first candidates of a normal search,
+    // which starts at the best match. The candidates are NOT kept.
+    if ( do_silly_testing ){
+      return DBL_MAX;
+    }
+    seeds.init( num_of_neighbors, 0, false, false, false );
+    vector<FeatureValue *> Path(NumOfFeatures());
+    double Threshold = DBL_MAX;
+    size_t EffFeat = EffectiveFeatures();
+    const ClassDistribution *best_distrib = IB->InitGraphTest( Path,
+							       &Inst,
+							       0,
+							       EffFeat );
+    size_t CurPos = 0;
+    for ( size_t step=0; best_distrib && step < seed_steps; ++step ){
+      size_t EndPos = qt->test( Path, CurPos, Threshold + Epsilon );
+      if ( EndPos == EffFeat ){
+	Threshold = seeds.addResult( qt->getDistance(EndPos),
+				     best_distrib,
+				     "" );
+      }
+      else {
+	++EndPos;
+      }
+      size_t pos = EndPos-1;
+      while ( pos > 0 && qt->getDistance(pos) > Threshold ){
+	--pos;
+      }
+      CurPos = pos;
+      best_distrib = IB->NextGraphTest( Path, CurPos );
+    }
+    return Threshold;
+  }
+
+  void MBLClass::test_instances( const vector<Instance *>& Insts,
+				 InstanceBase_base *IB,
+				 const vector<BestArray *>& Bests ){
+    // search the nearest neighbours of a batch of Instances in ONE walk
+    // over the InstanceBase, so nodes that are shared between queries
+    // are only visited once.
+    // Every query keeps its own tester, Threshold and BestArray. After a
+    // test, a query 'sleeps' at the level where it wants to continue: it
+    // rejected everything below the current prefix up to that level.
+    // The walk continues at the deepest level any query is interested in,
+    // and wakes up the queries for which the prefix has changed.
+    //
+    // A single search visits the value of the query first on every level,
+    // this walk doesn't. So neighbors at equal distances would be found in
+    // another order. Therefore the candidates are remembered, and added
+    // again afterwards, in the order of a single search.
+    size_t num = Insts.size();
+    size_t EffFeat = EffectiveFeatures();
+    vector<FeatureValue *> CurrentFV(NumOfFeatures());
+    vector<TesterClass *> testers( num, 0 );
+    vector<double> Thresholds( num, DBL_MAX );
+    vector<vector<size_t>> sleeping( EffFeat );
+    vector<size_t> active;
+    active.reserve( num );
+    vector<vector<search_candidate>> candidates( num );
+    // the shared walk can't start at the best match of every query, so
+    // every query first gets an upper bound for its Threshold from a
+    // short search of its own
+    BestArray seedArray;
+    for ( size_t q=0; q < num; ++q ){
+      testers[q] = getTester( globalMetricOption, features, mvd_threshold );
+      testers[q]->init( *Insts[q], EffFeat, 0 );
+      Thresholds[q] = seed_threshold( *Insts[q], IB, testers[q], seedArray );
+      active.push_back( q );
+    }
+    // an Instance without values, so we get a plain depth-first walk
+    Instance neutral( NumOfFeatures() );
+    const ClassDistribution *best_distrib = IB->InitGraphTest( CurrentFV,
+							       &neutral,
+							       0,
+							       EffFeat );
+    size_t CurPos = 0;
+    while ( best_distrib ){
+      for ( const auto& q : active ){
+	TesterClass *qt = testers[q];
+	size_t EndPos = qt->test( CurrentFV,
+				  CurPos,
+				  Thresholds[q] + Epsilon );
+	if ( EndPos == EffFeat ){
+	  double Distance = qt->getDistance(EndPos);
+	  if ( Distance >= 0.0 ){
+	    UnicodeString origI;
+	    if ( Verbosity(NEAR_N) ){
+	      origI = formatInstance( Insts[q]->FV, CurrentFV,
+				      0,
+				      NumOfFeatures() );
+	    }
+	    Thresholds[q] = min( Thresholds[q],
+				 Bests[q]->addResult( Distance,
+						      best_distrib,
+						      origI ) );
+	    candidates[q].push_back( { Distance,
+				       best_distrib,
+				       vector<FeatureValue *>( CurrentFV.begin(),
+							       CurrentFV.begin() + EffFeat ),
+				       origI } );
+	  }
+	  else {
+	    Error( "DISTANCE == " + TiCC::toString<double>(Distance) );
+	    FatalError( "we are dead" );
+	  }
+	}
+	else {
+	  ++EndPos; // out of luck, compensate for roll-back
+	}
+	size_t pos = EndPos-1;
+	while ( pos > 0 && qt->getDistance(pos) > Thresholds[q] ){
+	  // rollback
+	  --pos;
+	}
+	sleeping[pos].push_back( q );
+      }
+      active.clear();
+      size_t deepest = EffFeat;
+      while ( deepest > 0 && sleeping[deepest-1].empty() ){
+	--deepest;
+      }
+      if ( deepest == 0 ){
+	break;
+      }
+      CurPos = deepest-1;
+      best_distrib = IB->NextGraphTest( CurrentFV, CurPos );
+      // the path has changed from level CurPos on. Wake up the queries
+      // which sleep at that level, or deeper
+      for ( size_t l=CurPos; l < deepest; ++l ){
+	active.insert( active.end(), sleeping[l].begin(), sleeping[l].end() );
+	sleeping[l].clear();
+      }
+    }
+    for ( const auto& t : testers ){
+      node_visits += t->Visits();
+      delete t;
+    }
+    for ( size_t q=0; q < num; ++q ){
+      add_in_search_order( candidates[q], Insts[q]->FV, 0, *Bests[q] );
+    }
+  }
+
+  bool MBLClass::TestInstances( const vector<Instance *>& Insts,
+				InstanceBase_base *IB,
+				const vector<BestArray *>& Bests ){
+    // the batched counterpart of TestInstance(). Returns false when the
+    // current settings need the single instance version.
+    if ( doSamples()
+	 || GlobalMetric->isSimilarityMetric()
+	 || ( dense_ok && IB->IsDense() )
+	 || !sorted_features.empty()
+	 || search_budget > 0
+	 || search_deadline > 0 ){
+      return false;
+    }
+    test_instances( Insts, IB, Bests );
+    return true;
   }
 
   void MBLClass::TestInstance( const Instance& Inst,
@@ -2029,6 +2589,12 @@ namespace Timbl {
     if (  doSamples() ){
       test_instance_ex( Inst, SubTree, level );
     }
+    else if ( level == 0
+	      && dense_ok
+	      && SubTree->IsDense()
+	      && test_instance_dense( Inst, SubTree->denseBase() ) ){
+      return;
+    }
     else {
       if ( GlobalMetric->isSimilarityMetric( ) ){
 	test_instance_sim( Inst, SubTree, level );
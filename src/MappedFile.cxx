@@ -0,0 +1,119 @@
+/*
+  Copyright (c) 1998 - 2026
+  ILK   - Tilburg University
+  CLST  - Radboud University
+  CLiPS - University of Antwerp
+
+  This file is part of timbl
+
+  timbl is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  timbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/timbl/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include <fstream>
+#include <iterator>
+#include "config.h"
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "timbl/MappedFile.h"
+
+using namespace std;
+
+namespace Timbl {
+
+  MappedFile::MappedFile( const string& name ):
+    opened( false ),
+    map_base( 0 ),
+    map_length( 0 )
+  {
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+    int fd = open( name.c_str(), O_RDONLY );
+    if ( fd >= 0 ){
+      struct stat st;
+      if ( fstat( fd, &st ) == 0
+	   && S_ISREG( st.st_mode )
+	   && st.st_size > 0 ){
+	void *addr = mmap( 0, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	if ( addr != MAP_FAILED ){
+	  map_base = addr;
+	  map_length = st.st_size;
+	}
+      }
+      close( fd );
+    }
+    if ( map_base ){
+      char *begin = static_cast<char*>( map_base );
+      // PROT_READ is fine: a streambuf never writes in its get area
+      setg( begin, begin, begin + map_length );
+      opened = true;
+      return;
+    }
+#endif
+    // no mmap, (or an empty or special file): just read everything
+    ifstream is( name, ios::in | ios::binary );
+    if ( is ){
+      buffer.assign( istreambuf_iterator<char>( is ),
+		     istreambuf_iterator<char>() );
+      setg( buffer.data(), buffer.data(), buffer.data() + buffer.size() );
+      opened = true;
+    }
+  }
+
+  MappedFile::~MappedFile(){
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+    if ( map_base ){
+      munmap( map_base, map_length );
+    }
+#endif
+  }
+
+  MappedFile::pos_type MappedFile::seekoff( off_type off,
+					    ios_base::seekdir dir,
+					    ios_base::openmode which ){
+    if ( !(which & ios_base::in) ){
+      return pos_type( off_type(-1) );
+    }
+    char *target;
+    if ( dir == ios_base::beg ){
+      target = eback() + off;
+    }
+    else if ( dir == ios_base::cur ){
+      target = gptr() + off;
+    }
+    else {
+      target = egptr() + off;
+    }
+    if ( target < eback() || target > egptr() ){
+      return pos_type( off_type(-1) );
+    }
+    setg( eback(), target, egptr() );
+    return pos_type( target - eback() );
+  }
+
+  MappedFile::pos_type MappedFile::seekpos( pos_type pos,
+					    ios_base::openmode which ){
+    return seekoff( off_type(pos), ios_base::beg, which );
+  }
+
+}
@@ -337,10 +337,9 @@ namespace Timbl{
 
   inline bool FV_to_real( const FeatureValue *FV,
 			  double &result ){
-    if ( FV ){
-      if ( TiCC::stringTo<double>( FV->name(), result ) ){
-	return true;
-      }
+    if ( FV && FV->isNumeric() ){
+      result = FV->numericValue();
+      return true;
     }
     return false;
   }
@@ -269,6 +269,8 @@ namespace Timbl {
     _tieOk += in._tieOk;
     _tieFalse += in._tieFalse;
     _exact += in._exact;
+    _approx += in._approx;
+    _visits += in._visits;
   }
 
 }
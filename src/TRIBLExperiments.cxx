@@ -105,6 +105,7 @@ namespace Timbl {
       Warning( "no normalisation possible because a BeamSize is specified\n"
 	       "output is NOT normalized!" );
     }
+    search_cut_off = false;
     const ClassDistribution *ExResultDist = ExactMatch( Inst );
     if ( ExResultDist ){
       Distance = 0.0;
@@ -134,13 +135,17 @@ namespace Timbl {
 	}
       }
       else {
-	testInstance( Inst, SubTree, TRIBL_offset() );
-	bestArray.initNeighborSet( nSet );
+	bool spare_band = spare_neighbor_pays();
+	testInstance( Inst, SubTree, TRIBL_offset(), spare_band?1:0 );
+	bestArray.initNeighborSet( nSet, num_of_neighbors );
 	WClassDistribution *ResultDist = getBestDistribution();
 	Res = ResultDist->BestTarget( Tie, (RandomSeed() >= 0) );
+	count_search( Tie );
 	if ( Tie ){
 	  ++num_of_neighbors;
-	  testInstance( Inst, SubTree, TRIBL_offset() );
+	  if ( !spare_band ){
+	    testInstance( Inst, SubTree, TRIBL_offset() );
+	  }
 	  bestArray.addToNeighborSet( nSet, num_of_neighbors );
 	  WClassDistribution *ResultDist2 = getBestDistribution();
 	  bool Tie2 = false;
@@ -157,9 +162,9 @@ namespace Timbl {
 	  }
 	}
 	else {
+	  bestArray.trim( num_of_neighbors );
 	  bestResult.addDisposable( ResultDist, Res );
 	}
-	SubTree->CleanPartition( true );
 	Distance = getBestDistance();
       }
     }
@@ -180,6 +185,12 @@ namespace Timbl {
     if ( exact ){
       stats.addExact();
     }
+    if ( search_cut_off ){
+      nSet.setApproximate( true );
+      stats.addApproximate();
+    }
+    stats.addVisits( node_visits );
+    node_visits = 0;
     return Res;
   }
 
@@ -217,6 +228,7 @@ namespace Timbl {
 	       "output is NOT normalized!" );
     }
     bool Tie = false;
+    search_cut_off = false;
     const ClassDistribution *ExResultDist = ExactMatch( Inst );
     if ( ExResultDist ){
       Distance = 0.0;
@@ -230,13 +242,17 @@ namespace Timbl {
       IB_InstanceBase *SubTree
 	= InstanceBase->TRIBL2_test( Inst, TrResultDist, level );
       if ( SubTree ){
-	testInstance( Inst, SubTree, level );
-	bestArray.initNeighborSet( nSet );
+	bool spare_band = spare_neighbor_pays();
+	testInstance( Inst, SubTree, level, spare_band?1:0 );
+	bestArray.initNeighborSet( nSet, num_of_neighbors );
 	WClassDistribution *ResultDist1 = getBestDistribution();
 	Res = ResultDist1->BestTarget( Tie, (RandomSeed() >= 0) );
+	count_search( Tie );
 	if ( Tie ){
 	  ++num_of_neighbors;
-	  testInstance( Inst, SubTree, level );
+	  if ( !spare_band ){
+	    testInstance( Inst, SubTree, level );
+	  }
 	  bestArray.addToNeighborSet( nSet, num_of_neighbors );
 	  WClassDistribution *ResultDist2 = getBestDistribution();
 	  bool Tie2 = false;
@@ -254,9 +270,9 @@ namespace Timbl {
 	  }
 	}
 	else {
+	  bestArray.trim( num_of_neighbors );
 	  bestResult.addDisposable( ResultDist1, Res );
 	}
-	SubTree->CleanPartition( true );
 	match_depth = level;
 	Distance = getBestDistance();
       }
@@ -289,6 +305,12 @@ namespace Timbl {
     if ( exact ){
       stats.addExact();
     }
+    if ( search_cut_off ){
+      nSet.setApproximate( true );
+      stats.addApproximate();
+    }
+    stats.addVisits( node_visits );
+    node_visits = 0;
     return Res;
   }
 
@@ -33,6 +33,8 @@
 #include <numeric> // for accumulate()
 #include <iomanip>
 #include <cassert>
+#include <cstring>
+#include <type_traits>
 
 #include "ticcutils/StringOps.h"
 #include "ticcutils/PrettyPrint.h"
@@ -76,6 +78,66 @@ namespace Timbl {
     return (int)floor(randnum+0.5);
   }
 
+  static_assert( std::is_trivially_copyable<Vfield>::value,
+		 "VfieldList moves Vfields with memmove" );
+
+  VfieldList::VfieldList( const VfieldList& other ):
+    _size(0), _cap(INLINE_SIZE)
+  {
+    *this = other;
+  }
+
+  VfieldList& VfieldList::operator=( const VfieldList& other ){
+    if ( this != &other ){
+      _size = 0;
+      reserve( other._size );
+      if ( other._size > 0 ){
+	memcpy( static_cast<void *>( data() ),
+		other.data(),
+		other._size * sizeof(Vfield) );
+      }
+      _size = other._size;
+    }
+    return *this;
+  }
+
+  VfieldList::~VfieldList(){
+    if ( !is_inline() ){
+      ::operator delete( heap );
+    }
+  }
+
+  void VfieldList::reserve( size_t n ){
+    if ( n <= _cap ){
+      return;
+    }
+    Vfield *fresh = static_cast<Vfield *>( ::operator new( n * sizeof(Vfield) ) );
+    if ( _size > 0 ){
+      memcpy( static_cast<void *>( fresh ), data(), _size * sizeof(Vfield) );
+    }
+    if ( !is_inline() ){
+      ::operator delete( heap );
+    }
+    heap = fresh;
+    _cap = n;
+  }
+
+  VfieldList::iterator VfieldList::insert( iterator pos, const Vfield& vf ){
+    size_t off = pos - begin();
+    if ( _size == _cap ){
+      reserve( 2 * _cap );
+    }
+    Vfield *d = data();
+    if ( off < _size ){
+      memmove( static_cast<void *>( d + off + 1 ),
+	       d + off,
+	       ( _size - off ) * sizeof(Vfield) );
+    }
+    d[off] = vf;
+    ++_size;
+    return d + off;
+  }
+
   // distribution is kept sorted by value->Index(); these helpers locate or
   // position entries with a binary search.
   ClassDistribution::VDlist::iterator
@@ -270,6 +332,88 @@ namespace Timbl {
     Normalize();
   }
 
+  ClassDistribution *ClassDistribution::Copy( ) const {
+    // an exact, unshared copy, of the same type
+    ClassDistribution *res = clone();
+    res->distribution = distribution;
+    res->total_items = total_items;
+    return res;
+  }
+
+  unsigned int ClassDistribution::Owners() const {
+    unsigned int result;
+#pragma omp atomic read seq_cst
+    result = owners;
+    return result;
+  }
+
+  void ClassDistribution::AddOwner(){
+    // the nodes of a published version may drop their references in other
+    // threads. The caller always holds one already (or the node it copies
+    // does), so the count can't drop to 0 in between these steps
+    unsigned int now;
+#pragma omp atomic capture seq_cst
+    now = ++owners;
+    if ( now == 1 ){
+      // it was 0, which means 1 owner
+#pragma omp atomic update seq_cst
+      ++owners;
+    }
+  }
+
+  bool ClassDistribution::DropOwner(){
+    // returns true when the caller was the last owner, and should delete it
+    unsigned int left;
+#pragma omp atomic read seq_cst
+    left = owners;
+    if ( left == 0 ){
+      return true;
+    }
+#pragma omp atomic capture seq_cst
+    left = --owners;
+    return left == 0;
+  }
+
+  size_t ClassDistribution::HashValue() const {
+    size_t result = total_items;
+    if ( dynamic_cast<const WClassDistribution *>( this ) ){
+      result = ~result;
+    }
+    for ( const auto& vdf : distribution ){
+      result = result * 31 + vdf.Index();
+      result = result * 31 + vdf.Freq();
+    }
+    return result;
+  }
+
+  bool ClassDistribution::Equals( const ClassDistribution& other ) const {
+    // exactly the same content, including the weights and the type
+    if ( total_items != other.total_items
+	 || distribution.size() != other.distribution.size()
+	 || ( dynamic_cast<const WClassDistribution *>( this ) == 0 )
+	 != ( dynamic_cast<const WClassDistribution *>( &other ) == 0 ) ){
+      return false;
+    }
+    for ( size_t i=0; i < distribution.size(); ++i ){
+      const Vfield& a = distribution[i];
+      const Vfield& b = other.distribution[i];
+      if ( a.Value() != b.Value()
+	   || a.Freq() != b.Freq()
+	   || a.Weight() != b.Weight() ){
+	return false;
+      }
+    }
+    return true;
+  }
+
+  size_t ClassDistribution::NumBytes() const {
+    size_t result = sizeof(ClassDistribution);
+    if ( distribution.capacity() > VfieldList::INLINE_SIZE ){
+      result += distribution.capacity() * sizeof(Vfield);
+    }
+    return result;
+  }
+
   ClassDistribution *ClassDistribution::to_VD_Copy( ) const {
     ClassDistribution *res = new ClassDistribution();
     res->distribution.reserve( distribution.size() );
@@ -490,10 +634,16 @@ namespace Timbl {
     total_items += VD.total_items;
   }
 
+  inline size_t global_freq( const TargetValue *tv, const Targets *targets ){
+    return targets ? targets->Frequency( tv ) : tv->ValFreq();
+  }
+
   const TargetValue *ClassDistribution::BestTarget( bool& tie,
-						    bool do_rand ) const {
+						    bool do_rand,
+						    const Targets *targets ) const {
     // get the most frequent target from the distribution.
     // In case of a tie take the one which is GLOBALLY the most frequent,
+    // according to targets when given,
     // OR (if do_rand) take random one of the most frequents
     // and signal if this ties also!
     const TargetValue *best = NULL;
@@ -546,7 +696,8 @@ namespace Timbl {
 	  else {
 	    if ( pnt->Freq() == Max ) {
 	      tie = true;
-	      if ( pnt->Value()->ValFreq() > best->ValFreq() ){
+	      if ( global_freq( pnt->Value(), targets )
+		   > global_freq( best, targets ) ){
 		best = pnt->Value();
 	      }
 	    }
@@ -560,7 +711,8 @@ namespace Timbl {
   }
 
   const TargetValue *WClassDistribution::BestTarget( bool& tie,
-						     bool do_rand ) const {
+						     bool do_rand,
+						     const Targets *targets ) const {
     // get the most frequent target from the distribution.
     // In case of a tie take the one which is GLOBALLY the most frequent,
     // OR (if do_rand) take random one of the most frequents
@@ -611,7 +763,8 @@ namespace Timbl {
 	  else {
 	    if ( abs(It->Weight() - Max) < Epsilon ) {
 	      tie = true;
-	      if ( It->Value()->ValFreq() > best->ValFreq() ){
+	      if ( global_freq( It->Value(), targets )
+		   > global_freq( best, targets ) ){
 		best = It->Value();
 	      }
 	    }
@@ -653,6 +806,11 @@ namespace Timbl {
     if ( nextCh != '{' ){
       throw runtime_error( "missing '{' in distribution string." );
     }
+    else if ( look_ahead(is) == '}' ){
+      // an empty distribution, left behind by Decrement
+      is >> nextCh;
+      result = new ClassDistribution();
+    }
     else {
       int next;
       do {
@@ -727,6 +885,11 @@ namespace Timbl {
     if ( nextCh != '{' ){
       throw runtime_error( "missing '{' in distribution string." );
     }
+    else if ( look_ahead(is) == '}' ){
+      // an empty distribution, left behind by Decrement
+      is >> nextCh;
+      result = new ClassDistribution();
+    }
     else {
       int next;
       do {
@@ -819,6 +982,7 @@ namespace Timbl {
       values_array = t.values_array;
       reverse_values = t.reverse_values;
       target_hash = t.target_hash; // shared ??
+      frozen_freqs = t.frozen_freqs;
       is_reference =true;
     }
     return *this;
@@ -852,6 +1016,9 @@ namespace Timbl {
 
   TargetValue *Targets::ReverseLookup( size_t index ) const {
     auto const& it = reverse_values.find( index );
+    if ( it == reverse_values.end() ){
+      return 0;
+    }
     return it->second;
   }
 
@@ -891,6 +1058,30 @@ namespace Timbl {
     return result;
   }
 
+  size_t Targets::Frequency( const TargetValue *tv ) const {
+    // the frequency of tv, as it was at the time of the Snapshot
+    if ( frozen_freqs ){
+      size_t index = tv->Index();
+      return index < frozen_freqs->size() ? (*frozen_freqs)[index] : 0;
+    }
+    return tv->ValFreq();
+  }
+
+  void Targets::Snapshot( const Targets& t, Hash::UnicodeHash *hash ){
+    // a read-only copy of t, for a published version. The values are
+    // shared, but not their frequencies, which t goes on changing. And
+    // we need our own hash, as t adds new values to its hash
+    *this = t;
+    target_hash = hash;
+    auto freqs = make_shared<vector<size_t>>( hash->num_of_entries() + 1, 0 );
+    for ( const auto *tv : values_array ){
+      if ( tv->Index() < freqs->size() ){
+	(*freqs)[tv->Index()] = tv->ValFreq();
+      }
+    }
+    frozen_freqs = freqs;
+  }
+
   bool Targets::increment_value( TargetValue *TV ){
     bool result = false;
     if ( TV ){
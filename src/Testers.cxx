@@ -26,6 +26,8 @@
 */
 #include <vector>
 #include <string>
+#include <limits>
+#include <algorithm>
 #include <iosfwd>
 
 #include "timbl/Common.h"
@@ -43,6 +45,9 @@ namespace Timbl{
   //#define DBGTEST
   //#define DBGTEST_DOT
 
+  // relative margin on the lower bounds in DistanceTester::getDistance()
+  const double bound_slack = 1.0e-9;
+
   double overlapTestFunction::test( const FeatureValue *F,
 				    const FeatureValue *G,
 				    const Feature *Feat ) const {
@@ -97,7 +102,10 @@ namespace Timbl{
     offSet(0),
     FV(0),
     features(features.feats),
-    permutation(features.permutation)
+    permutation(features.permutation),
+    below_filters(0),
+    query_filters(0),
+    visits(0)
   {
     permFeatures.resize(_size,0);
 #ifdef DBGTEST
@@ -118,6 +126,9 @@ namespace Timbl{
     effSize = effective-oset;
     offSet = oset;
     FV = &inst.FV;
+    below_filters = 0;
+    query_filters = 0;
+    visits = 0;
   }
 
   DistanceTester::~DistanceTester(){
@@ -128,7 +139,10 @@ namespace Timbl{
 
   DistanceTester::DistanceTester( const Feature_List& features,
 				  int mvdmThreshold ):
-    TesterClass( features ){
+    TesterClass( features ),
+    mvdThreshold( mvdmThreshold ),
+    stamp( 0 )
+  {
 #ifdef DBGTEST
     cerr << "create a tester with threshold = " << mvdmThreshold << endl;
 #endif
@@ -157,12 +171,115 @@ namespace Timbl{
     // path for Overlap features.
     permTest.resize(_size,0);
     isOverlap.resize(_size,0);
+    hasTable.resize(_size,0);
     for ( size_t j=0; j < _size; ++j ){
       Feature *feat = permFeatures[j];
       permTest[j] = metricTest[permutation[j]];
       isOverlap[j] = ( feat && !feat->Ignore()
 		       && feat->getMetricType() == Overlap ) ? 1 : 0;
+      hasTable[j] = ( feat && !feat->Ignore()
+		      && feat->isStorableMetric() ) ? 1 : 0;
+    }
+    tables.resize(_size);
+    remaining.resize(_size+1, 0.0);
+    absent.resize(_size, 0.0);
+    absent_rest.resize(_size+1, 0.0);
+  }
+
+  double DistanceTester::lower_bound( const Instance& inst,
+				      size_t TrueF ) const {
+    // the smallest distance possible between the value of feature TrueF
+    // of inst and ANY value of that feature in the training data.
+    // A known value may be matched exactly, so this is only > 0 for
+    // unseen values for which the metric guarantees a minimal distance
+    const Feature *feat = permFeatures[TrueF];
+    const FeatureValue *F = inst.FV[TrueF];
+    if ( !feat || feat->Ignore() || !F
+	 || inst.VI[TrueF] != Instance::UnknownId ){
+      return 0.0;
+    }
+    double result = 0.0;
+    switch ( feat->getMetricType() ){
+    case Overlap:
+      result = 1.0;
+      break;
+    case ValueDiff:
+    case JeffreyDiv:
+    case JSDiv:
+    case Levenshtein:
+      // an unseen value is never in the matrix. the value difference
+      // metrics return 1.0 for values below the threshold, and
+      // the Levenshtein distance between 2 different strings is >= 1
+      if ( F->ValFreq() < feat->ClipFreq()
+	   && ( feat->getMetricType() == Levenshtein
+		|| F->ValFreq() < static_cast<size_t>(mvdThreshold) ) ){
+	result = 1.0;
+      }
+      break;
+    case Numeric: {
+      double scale = feat->Max() - feat->Min();
+      double val = F->numericValue();
+      if ( !F->isNumeric() ){
+	result = 1.0;
+      }
+      else if ( scale > 0.0 ){
+	if ( val < feat->Min() ){
+	  result = ( feat->Min() - val ) / scale;
+	}
+	else if ( val > feat->Max() ){
+	  result = ( val - feat->Max() ) / scale;
+	}
+      }
+      break;
+    }
+    default:
+      break;
+    }
+    return result * feat->Weight();
+  }
+
+  void DistanceTester::init( const Instance& inst,
+			     size_t effective,
+			     size_t oset ){
+    TesterClass::init( inst, effective, oset );
+    remaining[effSize] = 0.0;
+    absent_rest[effSize] = 0.0;
+    for ( size_t i=effSize; i > 0; --i ){
+      size_t TrueF = i-1+offSet;
+      remaining[i-1] = remaining[i] + lower_bound( inst, TrueF );
+      absent[i-1] = 0.0;
+      if ( isOverlap[TrueF] && inst.VI[TrueF] != Instance::UnknownId ){
+	absent[i-1] = permFeatures[TrueF]->Weight();
+      }
+      absent_rest[i-1] = absent_rest[i] + absent[i-1];
     }
+    // a new query value for every feature, so forget all table cells
+    if ( ++stamp == 0 ){
+      for ( auto& t : tables ){
+	fill( t.valid.begin(), t.valid.end(), 0 );
+      }
+      stamp = 1;
+    }
+  }
+
+  double DistanceTester::table_distance( size_t TrueF,
+					 const FeatureValue *G ){
+    // the same as permTest[TrueF]->test(), but each value of the feature
+    // is computed only once for the current instance
+    size_t id = G->valueId();
+    if ( id == std::numeric_limits<size_t>::max() ){
+      return permTest[TrueF]->test( (*FV)[TrueF], G, permFeatures[TrueF] );
+    }
+    distTable& t = tables[TrueF];
+    if ( id >= t.valid.size() ){
+      t.valid.resize( id+1, 0 );
+      t.dist.resize( id+1, 0.0 );
+    }
+    if ( t.valid[id] != stamp ){
+      t.dist[id] = permTest[TrueF]->test( (*FV)[TrueF], G, permFeatures[TrueF] );
+      t.valid[id] = stamp;
+    }
+    return t.dist[id];
   }
 
   size_t DistanceTester::test( const vector<FeatureValue *>& G,
@@ -181,11 +298,16 @@ namespace Timbl{
 	// the feature weight -- no virtual metric dispatch needed.
 	result = ( (*FV)[TrueF] == G[i] ) ? 0.0 : permFeatures[TrueF]->Weight();
       }
+      else if ( hasTable[TrueF] ){
+	result = table_distance( TrueF, G[i] );
+      }
       else {
 	result = permTest[TrueF]->test( (*FV)[TrueF], G[i], permFeatures[TrueF] );
       }
       distances[i+1] = distances[i] + result;
-      if ( distances[i+1] > Threshold ){
+      ++visits;
+      if ( DistanceTester::getDistance( i+1 ) > Threshold
+	   || beyond_subtree( i, Threshold ) ){
 #ifdef DBGTEST
 	cerr << "threshold reached at " << i << " distance="
 	     << distances[i+1] << endl;
@@ -199,16 +321,44 @@ namespace Timbl{
     return effSize;
   }
 
+  bool DistanceTester::beyond_subtree( size_t i, double Threshold ) const {
+    // is every path below the node at level i out of reach? For each
+    // feature below, the Bloom filter of the node tells if the value of
+    // the instance may be there. If it is certainly not, that feature
+    // adds at least absent[j]. Unlike getDistance(), this is a bound for
+    // the subtree of this node, not for its siblings.
+    if ( !below_filters
+	 || distances[i+1] + remaining[i+1] + absent_rest[i+1] <= Threshold ){
+      return false;
+    }
+    uint64_t filter = (*below_filters)[i];
+    double extra = 0.0;
+    for ( size_t j=i+1; j < effSize; ++j ){
+      if ( absent[j] > 0.0 && !( filter & (*query_filters)[j] ) ){
+	extra += absent[j];
+      }
+    }
+    return extra > 0.0
+      && ( distances[i+1] + remaining[i+1] + extra ) * ( 1.0 - bound_slack )
+      > Threshold;
+  }
+
   double DistanceTester::getDistance( size_t pos ) const{
+    // the distance over the first pos features, plus the lower bound for
+    // the rest. So it is exact for pos == effSize, and otherwise it bounds
+    // every instance that shares those pos values.
+    if ( remaining[pos] > 0.0 ){
+      // take off a tiny fraction, so rounding can never prune an exact tie
+      return ( distances[pos] + remaining[pos] ) * ( 1.0 - bound_slack );
+    }
     return distances[pos];
   }
 
   inline bool FV_to_real( const FeatureValue *FV,
 			  double &result ){
-    if ( FV ){
-      if ( TiCC::stringTo<double>( FV->name(), result ) ){
-	return true;
-      }
+    if ( FV && FV->isNumeric() ){
+      result = FV->numericValue();
+      return true;
     }
     return false;
   }
@@ -249,6 +399,7 @@ namespace Timbl{
       denom2 += innerProduct( G[i], G[i] ) * W;
       result += innerProduct( (*FV)[TrueF], G[i] ) * W;
     }
+    visits += effSize;
     double denom = sqrt( denom1 * denom2 );
     distances[effSize] = result/ (denom + Common::Epsilon);
 #ifdef DBGTEST
@@ -270,6 +421,7 @@ namespace Timbl{
       double result = innerProduct( (*FV)[TrueF], G[i] );
       result *= permFeatures[TrueF]->Weight();
       distances[i+1] = distances[i] + result;
+      ++visits;
 #ifdef DBGTEST
       cerr << "gewogen result " << result << endl;
       cerr << "dot::test() distance[" << i+1 << "]=" <<  distances[i+1] << endl;
@@ -113,8 +113,11 @@ inline void usage_full(void){
   cerr << "-w f:n    : read Weight n from file 'f'" << endl;
   cerr << "-b n      : number of lines used for bootstrapping (IB2 only)"
        << endl;
+  cerr << "--cache=<num> : remember the results of the 'n' most recently"
+       << "\n                tested distinct instances" << endl;
 #ifdef HAVE_OPENMP
-  cerr << "--clones=<num> : use 'n' threads for parallel testing" << endl;
+  cerr << "--clones=<num> : use 'n' threads for parallel testing"
+       << "\n                 and for building and pruning the trees" << endl;
 #endif
   cerr << "--Diversify: rescale weight (see docs)" << endl;
   cerr << "-d val    : weight neighbors as function of their distance:"
@@ -127,6 +130,12 @@ inline void usage_full(void){
   cerr << "     ED:a:b : Exponential Decay with factor a and b (no whitespace!)"
        << endl;
   cerr << "-k n      : k nearest neighbors (default n = 1)" << endl;
+  cerr << "--bestfirst : search the nearest values first, for features with"
+       << "\n              a value difference metric (MVDM, Jeffrey, Jensen-Shannon)"
+       << endl;
+  cerr << "--budget=n : approximate search: stop looking for neighbors after"
+       << "\n              n visits of the InstanceBase" << endl;
+  cerr << "--budget=nus : idem, after n microseconds" << endl;
   cerr << "-q n      : TRIBL threshold at level n" << endl;
   cerr << "-L n      : MVDM threshold at level n" << endl;
   cerr << "-R n      : solve ties at random with seed n" << endl;
@@ -221,6 +230,10 @@ inline void usage_full(void){
        << "            (necessary for using +v db with IGTree, but wastes memory otherwise)"
        << endl;
   cerr << "+H or -H  : write hashed trees (default +H)" << endl;
+  cerr << "--binary  : write trees in a binary format, which loads much faster"
+       << endl;
+  cerr << "--freeze  : use a compact read-only layout of the tree for testing"
+       << endl;
   cerr << "-M n      : size of MaxBests Array" << endl;
   cerr << "-N n      : Number of features (default "
        << TimblAPI::Default_Max_Feats() << ")" << endl;
@@ -245,6 +258,11 @@ inline void usage_full(void){
   cerr << "+x or -x  : Do or don't use the exact match shortcut " << endl
        << "            (IB1 and IB2 only, default is -x)"
        << endl;
+  cerr << "--exactindex : look up exact matches in a hash index, with one probe"
+       << endl;
+  cerr << "--dense   : search all instances at once, with a numeric matrix" << endl
+       << "            (IB1 only, with numeric features or the -mC or -mD metric)"
+       << endl;
 }
 
 inline void usage(void){
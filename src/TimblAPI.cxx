@@ -364,6 +364,41 @@ namespace Timbl {
     return Valid() && pimpl->Decrement( TiCC::UnicodeFromUTF8(s) );
   }
 
+  bool TimblAPI::Publish(){
+    // make all Increments and Decrements so far visible to new readers
+    return Valid() && pimpl->Publish();
+  }
+
+  TimblAPI *TimblAPI::NewReader() const {
+    // a TimblAPI for one classifying thread, on the last Published version.
+    // returns 0 when nothing is Published yet
+    TimblAPI *result = 0;
+    if ( Valid() ){
+      TimblExperiment *exp = pimpl->NewReader();
+      if ( exp ){
+	result = new TimblAPI();
+	result->pimpl = exp;
+	result->i_am_fine = true;
+      }
+    }
+    return result;
+  }
+
+  bool TimblAPI::Refresh(){
+    // let a reader move on to the last Published version, if there is a
+    // newer one. The old version is freed when its last reader has gone.
+    if ( !Valid() || !pimpl->Outdated() ){
+      return false;
+    }
+    TimblExperiment *exp = pimpl->NewReader();
+    if ( !exp ){
+      return false;
+    }
+    delete pimpl;
+    pimpl = exp;
+    return true;
+  }
+
   bool TimblAPI::Expand( const string& s ){
     return Valid() && pimpl->Expand( s );
   }
@@ -545,6 +580,11 @@ namespace Timbl {
     return Valid() && pimpl->Classify( s, cls, dist, f );
   }
 
+  bool TimblAPI::Classify( const vector<string>& in,
+			   vector<string>& cls ){
+    return Valid() && pimpl->Classify( in, cls );
+  }
+
   size_t TimblAPI::matchDepth() const {
     if ( Valid() ){
       return pimpl->matchDepth();
@@ -29,7 +29,10 @@
 #include <vector>
 #include <map>
 #include <fstream>
+#include <sstream>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 
 #include <cassert>
 #include <sys/time.h>
@@ -47,6 +50,7 @@
 #include "timbl/neighborSet.h"
 #include "timbl/BestArray.h"
 #include "timbl/IBtree.h"
+#include "timbl/MappedFile.h"
 #include "timbl/MBLClass.h"
 #include "timbl/GetOptClass.h"
 #include "timbl/TimblExperiment.h"
@@ -54,6 +58,7 @@
 #include "ticcutils/Timer.h"
 #include "ticcutils/PrettyPrint.h"
 #include "ticcutils/CommandLine.h"
+#include "ticcutils/UniHash.h"
 
 #ifdef HAVE_OPENMP
 #include <omp.h>
@@ -69,7 +74,7 @@ namespace Timbl {
   const string timbl_short_opts = "a:b:B:c:C:d:De:f:F:G::hHi:I:k:l:L:m:M:n:N:o:O:p:P:q:QR:s::t:T:u:U:v:Vw:W:xX:Z%";
   const string timbl_long_opts = ",Beam:,clones:,Diversify,occurrences:,"
     "sloppy::,silly::,Threshold:,Treeorder:,matrixin:,matrixout:,"
-    "version,help,limit:,prune";
+    "version,help,limit:,prune,freeze,binary,bestfirst,budget:,exactindex,cache:,dense";
   const string timbl_serv_short_opts = "C:d:G::k:l:L:p:Qv:x";
   const string timbl_indirect_opts = "d:e:G:k:L:m:o:p:QR:t:v:w:x%";
 
@@ -195,6 +200,65 @@ namespace Timbl {
     // silently do nothing when dist == 0;
   }
 
+  const resultLRU::entry *resultLRU::find( const string& key ){
+    auto const& It = index.find( key );
+    if ( It == index.end() ){
+      ++misses;
+      return 0;
+    }
+    ++hits;
+    // move it to the front, the iterators stay valid
+    entries.splice( entries.begin(), entries, It->second );
+    return &(*It->second);
+  }
+
+  void resultLRU::store( const string& key,
+			 const TargetValue *target,
+			 const ClassDistribution *dist,
+			 double distance,
+			 bool exact,
+			 bool tie ){
+    if ( capacity == 0
+	 || index.find( key ) != index.end() ){
+      return;
+    }
+    if ( entries.size() >= capacity ){
+      // drop the least recently used
+      index.erase( entries.back().key );
+      delete entries.back().dist;
+      entries.pop_back();
+    }
+    entries.push_front( entry{ key, target, dist->to_WVD_Copy(),
+			       distance, exact, tie } );
+    index[key] = entries.begin();
+  }
+
+  void resultLRU::clear(){
+    // drop all results, but keep the hit counts
+    for ( const auto& e : entries ){
+      delete e.dist;
+    }
+    entries.clear();
+    index.clear();
+  }
+
+  void resultLRU::merge_stats( const resultLRU& in ){
+    hits += in.hits;
+    misses += in.misses;
+  }
+
+  size_t resultLRU::NumBytes() const {
+    // an estimate of the memory in use
+    size_t result = index.bucket_count() * sizeof(void*);
+    for ( const auto& e : entries ){
+      result += sizeof(entry) + 2*sizeof(void*)     // the list node
+	+ sizeof(std::string) + 3*sizeof(void*)     // the index node
+	+ 2*e.key.capacity()
+	+ sizeof(WClassDistribution) + e.dist->size() * sizeof(Vfield);
+    }
+    return result;
+  }
+
   void TimblExperiment::normalizeResult(){
     bestResult.prepare();
     bestResult.normalize();
@@ -210,15 +274,46 @@ namespace Timbl {
     confusionInfo( 0 ),
     match_depth(-1),
     last_leaf(true),
+    searches( 0 ),
+    tied_searches( 0 ),
     estimate( 0 ),
-    numOfThreads( 1 )
+    numOfThreads( 1 ),
+    batch_best( 0 ),
+    result_cache( 0 ),
+    copies_built( false )
   {
     Weighting = GR_w;
   }
 
+  class SnapshotChannel {
+    // the hand-over point between a writing experiment and its readers.
+    // 'current' is only accessed with atomic_load() and atomic_store()
+  public:
+    ~SnapshotChannel(){
+      // the versions are gone, except the current one. Which goes first,
+      // as it uses the values a deleted writer left us
+      current.reset();
+      for ( const auto *v : values ){
+	delete v;
+      }
+      for ( const auto *h : hashes ){
+	delete h;
+      }
+    }
+    shared_ptr<const TimblExperiment> current;
+    mutex reader_lock;
+    vector<ValueClass *> values;
+    vector<Hash::UnicodeHash *> hashes;
+  };
+
   TimblExperiment::~TimblExperiment() {
+    if ( channel && !isReader() ){
+      // the published versions use our values
+      hand_over_values( channel->values, channel->hashes );
+    }
     delete OptParams;
     delete confusionInfo;
+    delete result_cache;
   }
 
   TimblExperiment& TimblExperiment::operator=( const TimblExperiment&in ){
@@ -235,6 +330,8 @@ namespace Timbl {
       match_depth = -1;
       estimate = in.estimate;
       numOfThreads = in.numOfThreads;
+      delete result_cache; // every copy caches its own results
+      result_cache = 0;
     }
     return *this;
   }
@@ -266,6 +363,82 @@ namespace Timbl {
     return result;
   }
 
+  bool TimblExperiment::Publish(){
+    // make the current state of this experiment available to readers as a
+    // new, immutable version. The version shares the InstanceBase and the
+    // values with us: what we change after this is copied first (see
+    // InstanceBase_base::Share() and Feature::Snapshot()), so we can go on
+    // Incrementing. Readers keep using the version they started with,
+    // until they move on using NewReader()
+    if ( ExpInvalid() ){
+      return false;
+    }
+    else if ( isReader() ){
+      Warning( "unable to Publish, this is a reader" );
+      return false;
+    }
+    else if ( Algorithm() != IB1_a && Algorithm() != IB2_a ){
+      Warning( "Publish is only supported for the IB1 and IB2 algorithms" );
+      return false;
+    }
+    else if ( IBStatus() == IB_Stat::Invalid ){
+      Warning( "unable to Publish, No InstanceBase available" );
+      return false;
+    }
+    if ( !ConfirmOptions() ){
+      return false;
+    }
+    // bring the statistics, weights and matrices up to date
+    initExperiment();
+    if ( ExpInvalid() ){
+      return false;
+    }
+    if ( !channel ){
+      channel = make_shared<SnapshotChannel>();
+    }
+    TimblExperiment *version = clone();
+    *version = *this;
+    version->OptParams = OptParams->Clone( 0 );
+    version->snapshot_from( *this );
+    version->InstanceBase->CleanPartition( false );
+    version->InstanceBase = InstanceBase->Share( version->ibCount );
+    version->is_synced = true;
+    shared_ptr<const TimblExperiment> published( version );
+    atomic_store( &channel->current, published );
+    return true;
+  }
+
+  TimblExperiment *TimblExperiment::NewReader() const {
+    // create an experiment for ONE thread, that classifies using the
+    // latest version that is Published by the writer (or by the writer
+    // of this reader). It never blocks on the writer.
+    // returns 0 when nothing has been Published yet
+    if ( !channel ){
+      return 0;
+    }
+    shared_ptr<const TimblExperiment> current
+      = atomic_load( &channel->current );
+    if ( !current ){
+      return 0;
+    }
+    // readers are created one at a time, which is rare enough.
+    // Classifying doesn't need this lock
+    lock_guard<mutex> guard( channel->reader_lock );
+    TimblExperiment *result = current->clone();
+    *result = *current;
+    result->OptParams = current->OptParams->Clone( 0 );
+    result->channel = channel;
+    result->snapshot = current;
+    result->initExperiment();
+    return result;
+  }
+
+  bool TimblExperiment::Outdated() const {
+    // is there a newer version then the one this reader uses?
+    return isReader()
+      && atomic_load( &channel->current ) != snapshot;
+  }
+
   void TimblExperiment::initExperiment( bool all_vd ){
     if ( !ExpInvalid() ){
       match_depth = NumOfFeatures();
@@ -276,8 +449,17 @@ namespace Timbl {
 	if ( Verbosity(ADVANCED_STATS) ){
 	  confusionInfo = new ConfusionMatrix( targets.num_of_values() );
 	}
+	// the settings or the InstanceBase may have changed
+	delete result_cache;
+	result_cache = 0;
+	if ( result_cache_size > 0 ){
+	  result_cache = new resultLRU( result_cache_size );
+	}
 	initDecay();
-	calculate_fv_entropy( true );
+	if ( !isReader() ){
+	  // a reader shares the values with its writer, it may not touch them
+	  calculate_fv_entropy( true );
+	}
 	if (!is_copy ){
 	  if ( ib2_offset != 0 ){
 	    //
@@ -305,11 +487,23 @@ namespace Timbl {
 	  if ( do_diversify ){
 	    diverseWeights();
 	  }
+	  if ( ib2_offset == 0 ){
+	    // IB2 is still adding instances, the copies would be outdated
+	    // at once
+	    build_read_copies( false );
+	  }
+	  if ( do_exact_index ){
+	    index_instancebase();
+	  }
 	}
 	srand( random_seed );
 	initTesters();
 	MBL_init = true;
       }
+      else if ( !is_copy && do_exact_index ){
+	// a Decrement may have dropped the index
+	index_instancebase();
+      }
     }
   }
 
@@ -495,8 +689,11 @@ namespace Timbl {
     return os;
   }
 
-  bool TimblExperiment::learnFromFileIndex( const fileIndex& fi,
-					    istream& datafile ){
+  InstanceBase_base *TimblExperiment::buildFromFileIndex( const fileIndex& fi,
+							  istream& datafile,
+							  unsigned long int& cnt ){
+    // build a separate InstanceBase from the lines in fi.
+    // Its nodes are counted in cnt
     InstanceBase_base *outInstanceBase = 0;
     for ( const auto& fit : fi ){
       for ( const auto& sit : fit.second ){
@@ -505,14 +702,15 @@ namespace Timbl {
 	UnicodeString Buffer;
 	nextLine( datafile, Buffer );
 	chopLine( Buffer );
-	// Progress update.
+	// Progress update. (clones don't know the global count)
 	//
-	if ( ( stats.dataLines() % Progress() ) == 0 ){
+	if ( !is_copy
+	     && ( stats.dataLines() % Progress() ) == 0 ){
 	  time_stamp( "Learning:  ", stats.dataLines() );
 	}
 	chopped_to_instance( TrainWords );
 	if ( !outInstanceBase ){
-	  outInstanceBase = InstanceBase->clone();
+	  outInstanceBase = InstanceBase->clone( cnt );
 	}
 	//		  cerr << "add instance " << &CurrInst << endl;
 	if ( !outInstanceBase->AddInstance( CurrInst ) ){
@@ -521,6 +719,14 @@ namespace Timbl {
 	}
       }
     }
+    return outInstanceBase;
+  }
+
+  bool TimblExperiment::learnFromFileIndex( const fileIndex& fi,
+					    istream& datafile ){
+    InstanceBase_base *outInstanceBase = buildFromFileIndex( fi,
+							     datafile,
+							     ibCount );
     if ( outInstanceBase ){
       if ( !InstanceBase->MergeSub( outInstanceBase ) ){
 	FatalError( "Merging InstanceBases failed. PANIC" );
@@ -531,6 +737,92 @@ namespace Timbl {
     return true;
   }
 
+#ifdef HAVE_OPENMP
+  bool TimblExperiment::learnFromMultiIndex( const fileDoubleIndex& fIndex ){
+    if ( numOfThreads < 2 || fIndex.size() < 2 ){
+      ifstream datafile( CurrentDataFile, ios::in);
+      for ( const auto& mit : fIndex ){
+	if ( !learnFromFileIndex( mit.second, datafile ) ){
+	  return false;
+	}
+      }
+      return true;
+    }
+    // every partition (all lines with the same first feature value) is
+    // built in a private InstanceBase, with its own node counter, by one
+    // of the clones. Afterwards they are merged in index order, which gives
+    // the same tree as the sequential loop above.
+    omp_set_num_threads( numOfThreads );
+    vector<const fileIndex*> parts;
+    vector<size_t> part_lines;
+    for ( const auto& mit : fIndex ){
+      parts.push_back( &mit.second );
+      size_t lines = 0;
+      for ( const auto& fit : mit.second ){
+	lines += fit.second.size();
+      }
+      part_lines.push_back( lines );
+    }
+    vector<InstanceBase_base*> subs( parts.size(), 0 );
+    vector<unsigned long int> counts( parts.size(), 0 );
+    vector<TimblExperiment*> exps( numOfThreads, 0 );
+    vector<ifstream> datafiles( numOfThreads );
+    for ( int i=0; i < numOfThreads; ++i ){
+      exps[i] = clone();
+      *exps[i] = *this;
+      exps[i]->stats.clear();
+      datafiles[i].open( CurrentDataFile, ios::in );
+    }
+    // the lines done are counted by all threads, but only the master
+    // thread reports them: time_stamp() is not meant for worker threads.
+    size_t done = 0;
+    size_t reported = 0;
+#pragma omp parallel for schedule( dynamic ) shared( subs, counts, done, reported )
+    for ( size_t p=0; p < parts.size(); ++p ){
+      int t = omp_get_thread_num();
+      subs[p] = exps[t]->buildFromFileIndex( *parts[p],
+					     datafiles[t],
+					     counts[p] );
+      size_t now;
+#pragma omp atomic capture
+      { done += part_lines[p]; now = done; }
+      if ( t == 0
+	   && !Verbosity(SILENT)
+	   && ( reported / Progress() ) != ( now / Progress() ) ){
+	time_stamp( "Learning:  ", now );
+	reported = now;
+      }
+    }
+    for ( const auto& exp : exps ){
+      stats.merge( exp->stats );
+      delete exp;
+    }
+    bool result = true;
+    for ( size_t p=0; p < subs.size(); ++p ){
+      if ( subs[p] ){
+	if ( result
+	     && !InstanceBase->MergeSub( subs[p] ) ){
+	  FatalError( "Merging InstanceBases failed. PANIC" );
+	  result = false;
+	}
+	ibCount += counts[p];
+	delete subs[p];
+      }
+    }
+    return result;
+  }
+#else
+  bool TimblExperiment::learnFromMultiIndex( const fileDoubleIndex& fIndex ){
+    ifstream datafile( CurrentDataFile, ios::in);
+    for ( const auto& mit : fIndex ){
+      if ( !learnFromFileIndex( mit.second, datafile ) ){
+	return false;
+      }
+    }
+    return true;
+  }
+#endif
+
   bool TimblExperiment::ClassicLearn( const string& FileName,
 				      bool warnOnSingleTarget ){
     bool result = true;
@@ -560,6 +852,7 @@ namespace Timbl {
       if ( ExpInvalid() ){
 	return false;
       }
+      InstanceBase->Threads( numOfThreads );
       if ( EffectiveFeatures() < 2 ) {
 	fileIndex fmIndex;
 	//      TiCC::Timer t;
@@ -597,13 +890,7 @@ namespace Timbl {
 	    Info( "\nPhase 3: Learning from Datafile: " + CurrentDataFile );
 	    time_stamp( "Start:     ", 0 );
 	  }
-	  // Open the file.
-	  //
-	  ifstream datafile( CurrentDataFile, ios::in);
-	  //
-	  for ( const auto& mit : fIndex ){
-	    learnFromFileIndex( mit.second, datafile );
-	  }
+	  learnFromMultiIndex( fIndex );
 	}
       }
       if ( !Verbosity(SILENT) ){
@@ -653,6 +940,10 @@ namespace Timbl {
       Warning( "unable to Increment, No InstanceBase available" );
       result = false;
     }
+    else if ( isReader() ){
+      Warning( "unable to Increment, this is a reader" );
+      result = false;
+    }
     else if ( !Chop( InstanceString ) ){
       Error( "Couldn't convert to Instance: "
 	     + TiCC::UnicodeToUTF8(InstanceString) );
@@ -661,6 +952,7 @@ namespace Timbl {
     else {
       chopped_to_instance( TrainLearnWords );
       MBL_init = false;
+      clear_result_cache();
       bool happy = InstanceBase->AddInstance( CurrInst );
       if ( !happy ){
 	Warning( "deviating exemplar weight in:\n" +
@@ -683,6 +975,10 @@ namespace Timbl {
       Warning( "unable to Decrement, No InstanceBase available" );
       result = false;
     }
+    else if ( isReader() ){
+      Warning( "unable to Decrement, this is a reader" );
+      result = false;
+    }
     else {
       if ( !Chop( InstanceString ) ){
 	Error( "Couldn't convert to Instance: "
@@ -691,6 +987,7 @@ namespace Timbl {
       }
       else {
 	chopped_to_instance( TestWords );
+	clear_result_cache();
 	HideInstance( CurrInst );
       }
     }
@@ -739,6 +1036,7 @@ namespace Timbl {
       }
       else {
 	MBL_init = false;
+	clear_result_cache();
 	if ( !Verbosity(SILENT) ) {
 	  Info( "Phase 2: Expanding from Datafile: " + FileName );
 	  time_stamp( "Start:     ", 0 );
@@ -812,6 +1110,7 @@ namespace Timbl {
 	result = false;    // No more input
       }
       else {
+	clear_result_cache();
 	if ( !Verbosity(SILENT) ) {
 	  Info( "Phase 2: Removing using Datafile: " + FileName );
 	  time_stamp( "Start:     ", 0 );
@@ -994,6 +1293,19 @@ namespace Timbl {
     os << "Seconds taken: " << secsUsed << " (";
     os << setprecision(2);
     os << stats.dataLines() / secsUsed << " p/s)" << endl;
+    if ( stats.visitedNodes() > 0 ){
+      os << "Nodes visited: " << stats.visitedNodes() << " ("
+	 << stats.visitedNodes() / (double)max( stats.dataLines(), 1U )
+	 << " per instance)" << endl;
+    }
+    if ( result_cache ){
+      size_t lookups = result_cache->Hits() + result_cache->Misses();
+      os << "Result cache : " << result_cache->Hits() << " hits on "
+	 << lookups << " lookups (" << setprecision(2)
+	 << ( lookups ? 100.0 * result_cache->Hits() / lookups : 0.0 )
+	 << "%), " << result_cache->size() << " entries, "
+	 << result_cache->NumBytes() << " bytes" << endl;
+    }
     os << setprecision(oldPrec);
   }
 
@@ -1009,6 +1321,10 @@ namespace Timbl {
       os << ", of which " << stats.exactMatches() << " exact matches " ;
     }
     os << endl;
+    if ( stats.approximateResults() != 0 ){
+      os << stats.approximateResults() << " of them were found by an "
+	 << "incomplete (budgeted) search" << endl;
+    }
     int totalTies =  stats.tiedCorrect() + stats.tiedFailure();
     if ( totalTies > 0 ){
       if ( totalTies == 1 ) {
@@ -1058,6 +1374,10 @@ namespace Timbl {
 
   bool TimblExperiment::showBestNeighbors( ostream& outfile ) const {
     if ( Verbosity( NEAR_N | ALL_K) ){
+      if ( search_cut_off ){
+	// the same mark as in a neighborSet
+	outfile << "# approximate" << endl;
+      }
       outfile << bestArray;
       return true;
     }
@@ -1341,6 +1661,7 @@ namespace Timbl {
 	    stats = stats_keep;
 	    if ( ResultTarget != CurrInst.TV ) {
 	      chopped_to_instance( TrainLearnWords );
+	      clear_result_cache();
 	      bool happy = InstanceBase->AddInstance( CurrInst );
 	      if ( !happy ){
 		Warning( "deviating exemplar weight in line #" +
@@ -1573,6 +1894,9 @@ namespace Timbl {
       if (Verbosity(CONFIDENCE) ){
 	result["confidence"] = confidence();
       }
+      if ( search_cut_off ){
+	result["approximate"] = true;
+      }
     }
     else {
       result = last_error;
@@ -1582,8 +1906,18 @@ namespace Timbl {
 
   json TimblExperiment::classify_to_JSON( const vector<string>& instances ) {
     json result = json::array();
+    vector<UnicodeString> lines;
+    lines.reserve( instances.size() );
     for ( const auto& i : instances ){
-      json tmp = classify_to_JSON( i );
+      lines.push_back( TiCC::UnicodeFromUTF8(i) );
+    }
+    vector<BestArray *> bests;
+    search_batch( lines, bests );
+    for ( size_t i=0; i < instances.size(); ++i ){
+      batch_best = bests[i];
+      json tmp = classify_to_JSON( instances[i] );
+      batch_best = 0;
+      delete bests[i];
       result.push_back( tmp );
     }
     if ( result.size() != instances.size() ){
@@ -1628,6 +1962,88 @@ namespace Timbl {
     return false;
   }
 
+  bool TimblExperiment::Classify( const vector<string>& Lines,
+				  vector<string>& Results ){
+    // classify a batch of lines. Results gets one class per line, or an
+    // empty string for a line that couldn't be classified.
+    // For IB1 and IB2 the neighbours of the whole batch are searched
+    // together, see search_batch()
+    Results.clear();
+    vector<UnicodeString> lines;
+    lines.reserve( Lines.size() );
+    for ( const auto& line : Lines ){
+      lines.push_back( TiCC::UnicodeFromUTF8(line) );
+    }
+    vector<BestArray *> bests;
+    search_batch( lines, bests );
+    bool result = true;
+    for ( size_t i=0; i < lines.size(); ++i ){
+      batch_best = bests[i];
+      double distance;
+      const TargetValue *targ = classifyString( lines[i], distance );
+      batch_best = 0;
+      delete bests[i];
+      if ( targ ){
+	Results.push_back( targ->name_string() );
+      }
+      else {
+	Results.push_back( "" );
+	result = false;
+      }
+    }
+    return result;
+  }
+
+  void TimblExperiment::search_batch( const vector<UnicodeString>& lines,
+				      vector<BestArray *>& bests ){
+    // find the nearest neighbours for a batch of lines in one go.
+    // bests gets a filled BestArray for every line that needs a search,
+    // and 0 for the rest (exact matches, bad lines, or when batching isn't
+    // possible) which are then handled one by one by LocalClassify()
+    bests.assign( lines.size(), 0 );
+    if ( ( algorithm != IB1_a && algorithm != IB2_a )
+	 || lines.size() < 2 ){
+      return;
+    }
+    vector<Instance *> insts( lines.size(), 0 );
+    for ( size_t i=0; i < lines.size(); ++i ){
+      // checkLine() is needed once, to initialize the experiment.
+      // For the other lines we only chop, so the warnings about bad lines
+      // are given only once, later on.
+      if ( ( Initialized || checkLine( lines[i] ) )
+	   && Chop( lines[i] ) ){
+	chopped_to_instance( TestWords );
+	insts[i] = new Instance( NumOfFeatures() );
+	insts[i]->swap( CurrInst );
+      }
+    }
+    if ( Initialized ){
+      initExperiment();
+      vector<Instance *> batch;
+      vector<BestArray *> batch_bests;
+      for ( size_t i=0; i < lines.size(); ++i ){
+	if ( insts[i] && !ExactMatch( *insts[i] ) ){
+	  bests[i] = new BestArray();
+	  bests[i]->init( num_of_neighbors, MaxBests,
+			  Verbosity(NEAR_N), Verbosity(DISTANCE),
+			  Verbosity(DISTRIB) );
+	  batch.push_back( insts[i] );
+	  batch_bests.push_back( bests[i] );
+	}
+      }
+      if ( !batch.empty()
+	   && !TestInstances( batch, InstanceBase, batch_bests ) ){
+	for ( auto& b : bests ){
+	  delete b;
+	  b = 0;
+	}
+      }
+    }
+    for ( const auto& inst : insts ){
+      delete inst;
+    }
+  }
+
   bool TimblExperiment::Classify( const UnicodeString& Line,
 				  UnicodeString& Result ) {
     UnicodeString dist;
@@ -1637,79 +2053,146 @@ namespace Timbl {
 
   void TimblExperiment::testInstance( const Instance& Inst,
 				      InstanceBase_base *base,
-				      size_t offset ) {
+				      size_t offset,
+				      size_t spare ) {
+    // search the num_of_neighbors nearest neighbors, plus 'spare' extra
+    // ones which may be used to resolve ties without searching again
     initExperiment();
-    bestArray.init( num_of_neighbors, MaxBests,
+    bestArray.init( num_of_neighbors + spare, MaxBests,
 		    Verbosity(NEAR_N), Verbosity(DISTANCE),
 		    Verbosity(DISTRIB) );
     TestInstance( Inst, base, offset );
   }
 
+  bool TimblExperiment::spare_neighbor_pays() const {
+    // searching one neighbor more makes every search somewhat slower,
+    // but saves a complete second search when there is a Tie.
+    // so only do it when Ties are frequent
+    return tied_searches * 3 > searches;
+  }
+
+  void TimblExperiment::count_search( bool Tie ){
+    ++searches;
+    if ( Tie ){
+      ++tied_searches;
+    }
+    if ( searches >= 4096 ){
+      // forget the far past, so we adapt to changing test data
+      searches /= 2;
+      tied_searches /= 2;
+    }
+  }
+
   const TargetValue *TimblExperiment::LocalClassify( const Instance& Inst,
 						     double& Distance,
 						     bool& exact ){
     bool recurse = true;
     bool Tie = false;
+    bool spare_band = false;
     exact = false;
     if ( !bestResult.reset( beamSize, normalisation, norm_factor, targets ) ){
       Warning( "no normalisation possible because a BeamSize is specified\n"
 	       "output is NOT normalized!" );
     }
-    const ClassDistribution *ExResultDist = ExactMatch( Inst );
-    WClassDistribution *ResultDist = 0;
+    search_cut_off = false;
     nSet.clear();
     const TargetValue *Res;
-    if ( ExResultDist ){
-      Distance = 0.0;
-      recurse = !Do_Exact();
-      // no retesting when exact match and the user ASKED for them..
-      Res = ExResultDist->BestTarget( Tie, (RandomSeed() >= 0) );
-      //
-      // add the exact match to bestArray. It should be taken into account
-      // for Tie resolution. this fixes bug 44
-      //
-      bestArray.init( num_of_neighbors, MaxBests,
-		      Verbosity(NEAR_N), Verbosity(DISTANCE),
-		      Verbosity(DISTRIB) );
-      bestArray.addResult( Distance, ExResultDist, get_org_input() );
-      bestArray.initNeighborSet( nSet );
+    string key;
+    const resultLRU::entry *cached = 0;
+    if ( cache_key( Inst, key ) ){
+      cached = result_cache->find( key );
+    }
+    if ( cached ){
+      // we have seen this instance before, no need to search again
+      Res = cached->target;
+      Distance = cached->distance;
+      exact = cached->exact;
+      Tie = cached->tie;
+      bestResult.addDisposable( cached->dist->to_WVD_Copy(), Res );
     }
     else {
-      testInstance( Inst, InstanceBase );
-      bestArray.initNeighborSet( nSet );
-      ResultDist = getBestDistribution( );
-      Res = ResultDist->BestTarget( Tie, (RandomSeed() >= 0) );
-      Distance = getBestDistance();
-    }
-    if ( Tie && recurse ){
-      bool Tie2 = true;
-      ++num_of_neighbors;
-      testInstance( Inst, InstanceBase );
-      bestArray.addToNeighborSet( nSet, num_of_neighbors );
-      WClassDistribution *ResultDist2 = getBestDistribution();
-      const TargetValue *Res2 = ResultDist2->BestTarget( Tie2, (RandomSeed() >= 0) );
-      --num_of_neighbors;
-      if ( !Tie2 ){
-	Res = Res2;
-	delete ResultDist;
-	ResultDist = ResultDist2;
+      const ClassDistribution *ExResultDist = ExactMatch( Inst );
+      WClassDistribution *ResultDist = 0;
+      if ( ExResultDist ){
+	Distance = 0.0;
+	recurse = !Do_Exact();
+	// no retesting when exact match and the user ASKED for them..
+	Res = ExResultDist->BestTarget( Tie, (RandomSeed() >= 0), &targets );
+	//
+	// add the exact match to bestArray. It should be taken into account
+	// for Tie resolution. this fixes bug 44
+	//
+	bestArray.init( num_of_neighbors, MaxBests,
+			Verbosity(NEAR_N), Verbosity(DISTANCE),
+			Verbosity(DISTRIB) );
+	bestArray.addResult( Distance, ExResultDist, get_org_input() );
+	bestArray.initNeighborSet( nSet );
       }
       else {
-	delete ResultDist2;
+	if ( batch_best ){
+	  // the neighbours are already found by search_batch()
+	  bestArray.swap( *batch_best );
+	  batch_best = 0;
+	}
+	else {
+	  // when Ties are frequent, keep one extra neighbor around, so a
+	  // Tie can be resolved from the same search
+	  spare_band = spare_neighbor_pays();
+	  testInstance( Inst, InstanceBase, 0, spare_band?1:0 );
+	}
+	bestArray.initNeighborSet( nSet, num_of_neighbors );
+	ResultDist = getBestDistribution( );
+	Res = ResultDist->BestTarget( Tie, (RandomSeed() >= 0), &targets );
+	Distance = getBestDistance();
+	count_search( Tie );
+      }
+      if ( spare_band && !( Tie && recurse ) ){
+	bestArray.trim( num_of_neighbors );
+      }
+      if ( Tie && recurse ){
+	bool Tie2 = true;
+	++num_of_neighbors;
+	if ( !spare_band ){
+	  testInstance( Inst, InstanceBase );
+	}
+	bestArray.addToNeighborSet( nSet, num_of_neighbors );
+	WClassDistribution *ResultDist2 = getBestDistribution();
+	const TargetValue *Res2 = ResultDist2->BestTarget( Tie2, (RandomSeed() >= 0), &targets );
+	--num_of_neighbors;
+	if ( !Tie2 ){
+	  Res = Res2;
+	  delete ResultDist;
+	  ResultDist = ResultDist2;
+	}
+	else {
+	  delete ResultDist2;
+	}
       }
-    }
 
-    exact = fabs(Distance) < Epsilon ;
-    if ( ResultDist ){
-      bestResult.addDisposable( ResultDist, Res );
-    }
-    else {
-      bestResult.addConstant( ExResultDist, Res );
-      exact = exact || Do_Exact();
+      exact = fabs(Distance) < Epsilon ;
+      if ( ResultDist ){
+	bestResult.addDisposable( ResultDist, Res );
+      }
+      else {
+	bestResult.addConstant( ExResultDist, Res );
+	exact = exact || Do_Exact();
+      }
+      if ( !key.empty() && !search_cut_off ){
+	result_cache->store( key, Res,
+			     ResultDist ? ResultDist : ExResultDist,
+			     Distance, exact, Tie );
+      }
     }
     if ( exact ){
       stats.addExact();
     }
+    if ( search_cut_off ){
+      // the search was cut short by the SEARCH_BUDGET or SEARCH_DEADLINE
+      nSet.setApproximate( true );
+      stats.addApproximate();
+    }
+    stats.addVisits( node_visits );
+    node_visits = 0;
     if ( confusionInfo ){
       confusionInfo->Increment( Inst.TV, Res );
     }
@@ -1750,8 +2233,10 @@ namespace Timbl {
   }
 
   const neighborSet *TimblExperiment::LocalClassify( const Instance& Inst ){
+    search_cut_off = false;
     testInstance( Inst, InstanceBase );
     bestArray.initNeighborSet( nSet );
+    nSet.setApproximate( search_cut_off );
     nSet.setShowDistance( Verbosity(DISTANCE) );
     nSet.setShowDistribution( Verbosity(DISTRIB) );
     return &nSet;
@@ -1962,6 +2447,9 @@ namespace Timbl {
   void threadBlock::finalize(){
     for ( size_t i=1; i < size; ++i ){
       exps[0].exp->stats.merge( exps[i].exp->stats );
+      if ( exps[0].exp->result_cache && exps[i].exp->result_cache ){
+	exps[0].exp->result_cache->merge_stats( *exps[i].exp->result_cache );
+      }
       if ( exps[0].exp->confusionInfo ){
 	exps[0].exp->confusionInfo->merge( exps[i].exp->confusionInfo );
       }
@@ -1975,6 +2463,7 @@ namespace Timbl {
     bool result = false;
     if ( initTestFiles( FileName, OutFile ) ){
       initExperiment();
+      build_read_copies( true );
       stats.clear();
       showTestingInfo( *mylog );
       if ( numOfThreads > 1 ){
@@ -2035,6 +2524,7 @@ namespace Timbl {
     bool result = false;
     if ( initTestFiles( FileName, OutFile ) ){
       initExperiment();
+      build_read_copies( true );
       stats.clear();
       showTestingInfo( *mylog );
       // Start time.
@@ -2101,6 +2591,7 @@ namespace Timbl {
     bool result = false;
     if ( initTestFiles( FileName, OutFile ) ){
       initExperiment();
+      build_read_copies( true );
       stats.clear();
       showTestingInfo( *mylog );
       // Start time.
@@ -2513,15 +3004,17 @@ namespace Timbl {
   bool TimblExperiment::ReadInstanceBase( const string& FileName ){
     bool result = false;
     if ( ConfirmOptions() ){
-      ifstream infile( FileName, ios::in );
-      if ( !infile ) {
+      MappedFile mapped( FileName );
+      if ( !mapped.is_open() ) {
 	Error( "can't open: " + FileName );
       }
       else {
 	if ( !Verbosity(SILENT) ){
 	  Info( "Reading Instance-Base from: " + FileName );
 	}
+	istream infile( &mapped );
 	if ( GetInstanceBase( infile ) ){
+	  InstanceBase->Threads( numOfThreads );
 	  if ( !Verbosity(SILENT) ){
 	    IBInfo( cout );
 	    writePermutation( cout );
@@ -2574,6 +3067,96 @@ namespace Timbl {
     return true;
   }
 
+  void TimblExperiment::build_read_copies( bool test_run ){
+    // build the frozen and the dense copies of the InstanceBase, when asked
+    // for. The first setup does this, and so does every test run on a file.
+    // A tree that changes in between (IB2, Increment, Decrement) drops its
+    // copies, and is searched linked until the next test run: rebuilding
+    // them after every change would cost O(N) per instance.
+    if ( copies_built && !test_run ){
+      return;
+    }
+    bool report = !copies_built && !Verbosity(SILENT);
+    if ( do_freeze ){
+      freeze_instancebase( report );
+    }
+    if ( do_dense ){
+      dense_instancebase( !copies_built );
+    }
+    copies_built = true;
+  }
+
+  void TimblExperiment::freeze_instancebase( bool report ){
+    // switch to the flat, read-only layout of the InstanceBase for testing.
+    // a no-op when it is frozen already.
+    if ( InstanceBase && !InstanceBase->IsFrozen() ){
+      if ( InstanceBase->Freeze()
+	   && report ){
+	const FrozenTree *ft = InstanceBase->frozenBase();
+	Info( "Froze InstanceBase: " + TiCC::toString(ft->size())
+	      + " nodes (" + TiCC::toString(ft->NumBytes()) + " bytes)" );
+      }
+    }
+  }
+
+  void TimblExperiment::index_instancebase(){
+    // add a hash index on the full paths of the InstanceBase, for one probe
+    // exact match lookups. a no-op when it is indexed already.
+    if ( InstanceBase && !InstanceBase->IsExactIndexed() ){
+      if ( InstanceBase->IndexExact()
+	   && !Verbosity(SILENT) ){
+	Info( "Indexed InstanceBase: "
+	      + TiCC::toString(InstanceBase->exactIndexSize())
+	      + " exact match paths" );
+      }
+    }
+  }
+
+  void TimblExperiment::dense_instancebase( bool report ){
+    // add a dense matrix of the full paths of the InstanceBase, which is
+    // searched brute force. Only for IB1 with numeric or similarity metrics
+    if ( !InstanceBase || InstanceBase->IsDense() ){
+      return;
+    }
+    if ( ( Algorithm() != IB1_a && Algorithm() != CV_a )
+	 || !dense_searchable() ){
+      if ( report ){
+	Warning( "--dense is ignored: it needs IB1 with only Numeric or "
+		 "Euclidean features, or the Cosine or DotProduct metric" );
+      }
+      return;
+    }
+    if ( InstanceBase->MakeDense()
+	 && report
+	 && !Verbosity(SILENT) ){
+      const DenseBase *db = InstanceBase->denseBase();
+      Info( "Dense InstanceBase: " + TiCC::toString(db->rows())
+	    + " rows (" + TiCC::toString(db->NumBytes()) + " bytes)" );
+    }
+  }
+
+  bool TimblExperiment::cache_key( const Instance& Inst,
+				   string& key ) const {
+    // the key of Inst in the result_cache: the value ids of the features
+    // that matter. Instances with unknown values are not cached, and neither
+    // are results that may differ per call or that need the neighbors.
+    key.clear();
+    if ( !result_cache
+	 || RandomSeed() >= 0
+	 || Verbosity(NEAR_N|ALL_K) ){
+      return false;
+    }
+    size_t len = EffectiveFeatures();
+    for ( size_t i=0; i < len; ++i ){
+      if ( Inst.VI[i] == Instance::UnknownId ){
+	return false;
+      }
+    }
+    key.assign( reinterpret_cast<const char *>( Inst.VI.data() ),
+		len * sizeof(uint32_t) );
+    return true;
+  }
+
   bool TimblExperiment::build_file_index( const string& file_name,
 					  fileIndex& fmIndex ){
     bool result = true;
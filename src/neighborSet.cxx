@@ -37,7 +37,8 @@ namespace Timbl {
   using namespace std;
   using namespace Common;
 
-  neighborSet::neighborSet(): showDistance(false),showDistribution(false){}
+  neighborSet::neighborSet(): showDistance(false),showDistribution(false),
+			      approximate(false){}
 
   neighborSet::~neighborSet(){
     clear();
@@ -46,6 +47,7 @@ namespace Timbl {
   neighborSet::neighborSet( const neighborSet& in ){
     showDistance = in.showDistance;
     showDistribution = in.showDistribution;
+    approximate = false;
     merge( in );
   }
 
@@ -64,6 +66,7 @@ namespace Timbl {
   }
 
   void neighborSet::clear(){
+    approximate = false;
     distances.clear();
     for ( auto const& db : distributions ){
       delete db;
@@ -95,6 +98,7 @@ namespace Timbl {
     // reserve enough space to avoid reallocations
     // reallocation invalidates pointers!
     reserve( size() + s.size() );
+    approximate = approximate || s.approximate;
     auto dit1 = distances.begin();
     auto dit2 = s.distances.begin();
     auto dis1 = distributions.begin();
@@ -199,6 +203,9 @@ namespace Timbl {
   }
 
   ostream& operator<<( ostream& os, const neighborSet& set ){
+    if ( set.approximate ){
+      os << "# approximate" << endl;
+    }
     for ( unsigned int i=0; i < set.size(); ++i ){
       os << "# k=" << i+1;
       if ( set.showDistribution ){